@@ -36,11 +36,12 @@ void B_Tree::init(){
 		nodes[i].right	= (2*i+2 < modules_N ? 2*i+2 : NIL);
 	}
 	nodes[0].parent = NIL;
+
 	best_sol.clear();
-	last_sol.clear();
 	clear();
 
 	normalize_cost(10);
+	keep_sol(); // normalize_cost() perturbed the tree;
 } 
 
 //---------------------------------------------------------------------------
@@ -71,14 +72,14 @@ void B_Tree::testing(){
 	Solution E;
 
 	do{
-		n = rand()%modules_N;
-		p = rand()%modules_N;
+		n = rand_int()%modules_N;
+		p = rand_int()%modules_N;
 
 		while(n==nodes_root)		// n is not root
-			n = rand()%modules_N;
+			n = rand_int()%modules_N;
 
 		while(n==p||nodes[n].parent==p||nodes[p].parent==n)	// n != p & n.parent != p
-			p = rand()%modules_N;
+			p = rand_int()%modules_N;
    
 		Node &node = nodes[n];
 		Node &parent = nodes[p];
@@ -101,25 +102,21 @@ void B_Tree::show_tree()
 
 
 	// (1) the tree;
-	printf("\nBtree graph:\n");
-	cout << "Root: " << nodes_root << endl;
-	printf("	ID:\tleft\tparent\tright\trotate\tflip\n");
+	fprintf(_log, "\nBtree graph:\n");
+	fprintf(_log, "Root: %d\n", nodes_root);
+	fprintf(_log, "	ID:\tleft\tparent\tright\trotate\tflip\n");
 	for(int i=0; i < modules_N; i++){
-		cout << "	 " << nodes[i].id << ":\t";
-		cout << nodes[i].left << "\t";
-		cout << nodes[i].parent << "\t";
-		cout << nodes[i].right << "\t";
-		cout << nodes[i].rotate << "\t";
-		cout << nodes[i].flip << endl;
+		fprintf(_log, "	 %d:\t%d\t%d\t%d\t%d\t%d\n", nodes[i].id, nodes[i].left,
+			nodes[i].parent, nodes[i].right, nodes[i].rotate, nodes[i].flip);
 	}
 
-	printf("\nPhysical locations: ID Name [symbol] ('SW' corner)-('NE' corner)\n");
+	fprintf(_log, "\nPhysical locations: ID Name [symbol] ('SW' corner)-('NE' corner)\n");
 	for (int i=0; i < modules_N; i++) {
-		printf("%d\t%s\t[%c] (%d,%d)-(%d,%d)\n", i, modules[i].name, 48+i,
+		fprintf(_log, "%d\t%s\t[%c] (%d,%d)-(%d,%d)\n", i, _netlist->modules[i].name, 48+i,
 			   modules_info[i].x, modules_info[i].y, modules_info[i].rx,
 			   modules_info[i].ry);
 	}
-	printf("\n");
+	fprintf(_log, "\n");
 	max_x=Width;
 	max_y=Height;
 
@@ -153,7 +150,7 @@ void B_Tree::show_tree()
 	}
 
 	// () apply and record the routers on top of the drawing;
-	int ary=(int) ceil(sqrt(modules_N));
+	int ary=max(2, (int) ceil(sqrt(modules_N))); // 2 if a single module;
 	for (int y=ary-1;y>=0;y--) {
 		for (int x=0;x<ary;x++) {
 			chip[39-int(round(39*y/(ary-1)))][int(round(39*x/(ary-1)))]='*';//used char. 177 in windows
@@ -161,9 +158,9 @@ void B_Tree::show_tree()
 	}
 	// () the actual printing out of the floorplan rectangles and routers;
 	for (i=0;i<40;i++) {
-		printf("%s\n",chip[i]);
+		fprintf(_log, "%s\n",chip[i]);
 	}
-	cout << "Total size: " << max_x << "x" << max_y << "\n\n";
+	fprintf(_log, "Total size: %gx%g\n\n", max_x, max_y);
 }
 
 //---------------------------------------------------------------------------
@@ -172,36 +169,30 @@ void B_Tree::show_tree()
 
 void B_Tree::packing()
 {
-
-	stack<int> S;
-
 	clear();
-	int p = nodes_root;
 
-	place_module(p,NIL);
-	Node &n = nodes[p];
-	if(n.right != NIL) S.push(n.right);
-	if(n.left  != NIL) S.push(n.left);
-
-	// inorder traverse
-	while(!S.empty()){
-		p = S.top();
-		S.pop();
+	// () preorder traverse; Width, Height are the largest right and top
+	// sides of all modules;
+	int max_x = 0, max_y = 0;
+	_dfs_stack.clear();
+	_dfs_stack.push_back(nodes_root);
+	while(!_dfs_stack.empty()){
+		int p = _dfs_stack.back();
+		_dfs_stack.pop_back();
 		Node &n = nodes[p];
 
-		assert(n.parent != NIL);
-		bool is_left = (nodes[n.parent].left == n.id);
-		place_module(p,n.parent,is_left);
-
-		if(n.right != NIL)		S.push(n.right);
-		if(n.left  != NIL)		S.push(n.left);
-	}
+		if (p == nodes_root) {
+			place_module(p,NIL);
+		} else {
+			assert(n.parent != NIL);
+			bool is_left = (nodes[n.parent].left == n.id);
+			place_module(p,n.parent,is_left);
+		}
+		max_x = max(max_x, modules_info[p].rx);
+		max_y = max(max_y, modules_info[p].ry);
 
-	// () compute Width, Height;
-	double max_x=-1,max_y=-1;
-	for (int p=contour_root; p != NIL; p=contour[p].front) {
-		max_x = max(max_x,double(modules_info[p].rx));	
-		max_y = max(max_y,double(modules_info[p].ry));
+		if(n.right != NIL)		_dfs_stack.push_back(n.right);
+		if(n.left  != NIL)		_dfs_stack.push_back(n.left);
 	}
 
 	Width  = max_x;
@@ -209,6 +200,8 @@ void B_Tree::packing()
 	Area   = Height*Width;
 
 	FPlan::packing(); // for wirelength;
+	if (_noc_weight > 0)
+		update_noc_estimate();
 }
 
 void B_Tree::place_module(int mod,int abut,bool is_left)
@@ -219,8 +212,8 @@ void B_Tree::place_module(int mod,int abut,bool is_left)
 	mod_mf.rotate       = nodes[mod].rotate;
 	mod_mf.flip         = nodes[mod].flip;
 
-	int w = modules[mod].width;
-	int h = modules[mod].height;
+	int w = _netlist->modules[mod].width;
+	int h = _netlist->modules[mod].height;
 	if(nodes[mod].rotate)
 		swap(w,h);
   
@@ -236,8 +229,8 @@ void B_Tree::place_module(int mod,int abut,bool is_left)
 	int p;	 // trace contour from p
 
 	if(is_left){	// left
-		int abut_width = (nodes[abut].rotate ? modules[abut].height : 
-						  modules[abut].width);
+		int abut_width = (nodes[abut].rotate ? _netlist->modules[abut].height : 
+						  _netlist->modules[abut].width);
 		mod_mf.x  = modules_info[abut].x + abut_width;
 		mod_mf.rx = mod_mf.x + w;
 		p = contour[abut].front;
@@ -308,6 +301,8 @@ void B_Tree::place_module(int mod,int abut,bool is_left)
 
 void B_Tree::wire_nodes(int parent,int child,DIR edge){
 	assert(parent!=NIL);
+	node_changed(parent);
+	node_changed(child);
 	(edge==LEFT? nodes[parent].left: nodes[parent].right) = child;
 	if(child!=NIL) nodes[child].parent = nodes[parent].id;
 }
@@ -325,11 +320,11 @@ int B_Tree::child(int node,DIR d){
 void B_Tree::get_solution(Solution &sol){
 	sol.nodes_root = nodes_root;
 	sol.nodes = nodes;
-	sol.cost = getCost();
 }
 
 void B_Tree::keep_sol(){
-	get_solution(last_sol);
+	_nodes_journal.clear();
+	_nodes_root_kept = nodes_root;
 }
 
 void B_Tree::keep_best(){
@@ -337,8 +332,13 @@ void B_Tree::keep_best(){
 }
 
 void B_Tree::recover(){
-	recover(last_sol);
-	// recover_partial();
+	// undo the journaled changes in reverse order;
+	for(int l = _nodes_journal.size() - 1; l >= 0; l--){
+		const Node &m = _nodes_journal[l];
+		nodes[m.id] = m;
+	}
+	_nodes_journal.clear();
+	nodes_root = _nodes_root_kept;
 }
 
 void B_Tree::recover_best(){
@@ -348,25 +348,7 @@ void B_Tree::recover_best(){
 void B_Tree::recover(Solution &sol){
 	nodes_root = sol.nodes_root;
 	nodes = sol.nodes;
-}
-
-void B_Tree::recover_partial(){
-	if(changed_root != NIL)
-		nodes_root = changed_root;
-  
-	for(int i=0; i < changed_nodes.size(); i++){
-		Node &n = changed_nodes[i];
-		nodes[n.id] = n;
-	}
-}
-
-void B_Tree::add_changed_nodes(int n){
-	if(n==NIL) return;
-
-	for(int i=0; i < changed_nodes.size(); i++)
-		if(changed_nodes[i].id == n)
-			return;
-	changed_nodes.push_back(nodes[n]);
+	keep_sol(); // the journal was of the replaced tree;
 }
 
 //---------------------------------------------------------------------------
@@ -377,14 +359,14 @@ void B_Tree::perturb(){
 	int p,n;
 	int swap_limit,swap_trials=0;
 
-	n = rand()%modules_N;
+	n = rand_int()%modules_N;
 	swap_limit=modules_N*50;
-	//	changed_nodes.clear();
-	//	changed_root = NIL;
 
 
-	if ( ROTATE_RATE > rand_01() ) {
-		//	  changed_nodes.push_back(nodes[n]);
+	// a single module (e.g., alone on a layer of a 3D stack) can only
+	// be rotated;
+	if ( modules_N < 2 || ROTATE_RATE > rand_01() ) {
+		node_changed(n);
 		nodes[n].rotate = !nodes[n].rotate;
 		if(rand_bool()) nodes[n].flip = !nodes[n].flip;
 	}
@@ -392,7 +374,7 @@ void B_Tree::perturb(){
 
 		if ( SWAP_RATE > rand_01() ) {
 			do{
-				p = rand()%modules_N;
+				p = rand_int()%modules_N;
 				//VITOR: Added to avoid a deadlock when there are no cores available
 				//(everybody is a son of 'n', is his parent in the tree, or p hits n himself)
 				//printf("	%d	%d-parent:%d,%d-parent:%d\n	 ",swap_trials,n,nodes[n].parent,p,nodes[p].parent);
@@ -401,21 +383,15 @@ void B_Tree::perturb(){
 				}
 			}while( (n==p) || (nodes[n].parent==p) || (nodes[p].parent==n) );
 
-			//		changed_nodes.push_back(nodes[p]);
-			//		changed_nodes.push_back(nodes[n]);
-
 			if (swap_trials<=swap_limit) {
 				swap_node(nodes[p],nodes[n]);
 			}
 
 		}else{
 			do{
-				p = rand()%modules_N;
+				p = rand_int()%modules_N;
 			}while(n==p);
 
-			//		changed_nodes.push_back(nodes[p]);
-			//		changed_nodes.push_back(nodes[n]);
-
 			delete_node(nodes[n]);
 			insert_node(nodes[p],nodes[n]);
 		}
@@ -423,43 +399,43 @@ void B_Tree::perturb(){
 }
 
 void B_Tree::swap_node(Node &n1, Node &n2){
+	node_changed(n1.id);
+	node_changed(n2.id);
 
 	if(n1.left!=NIL){	 
-		//add_changed_nodes(n1.left);
+		node_changed(n1.left);
 		nodes[n1.left].parent  = n2.id;
 	}
 	if(n1.right!=NIL){
-		//add_changed_nodes(n1.right);
+		node_changed(n1.right);
 		nodes[n1.right].parent = n2.id;	 
 	}
 	if(n2.left!=NIL){
-		//add_changed_nodes(n2.left);
+		node_changed(n2.left);
 		nodes[n2.left].parent  = n1.id;
 	}
 	if(n2.right!=NIL){
-		//add_changed_nodes(n2.right);
+		node_changed(n2.right);
 		nodes[n2.right].parent = n1.id;	 
 	}
 
 	if(n1.parent != NIL){
-		//add_changed_nodes(n1.parent);
+		node_changed(n1.parent);
 		if(nodes[n1.parent].left==n1.id)
 			nodes[n1.parent].left  = n2.id;
 		else
 			nodes[n1.parent].right = n2.id; 
 	}else{
-		changed_root = n1.id;
 		nodes_root = n2.id;
 	}
 
 	if(n2.parent != NIL){
-		//add_changed_nodes(n2.parent);
+		node_changed(n2.parent);
 		if(nodes[n2.parent].left==n2.id)
 			nodes[n2.parent].left  = n1.id;
 		else
 			nodes[n2.parent].right = n1.id; 
 	}else{
-		//	  changed_root = n2.id;
 		nodes_root = n1.id;
 	}
 
@@ -469,11 +445,13 @@ void B_Tree::swap_node(Node &n1, Node &n2){
 }
 
 void B_Tree::insert_node(Node &parent, Node &node){
+	node_changed(parent.id);
+	node_changed(node.id);
 	node.parent = parent.id;
 	bool edge = rand_bool();
 
 	if(edge){
-		//add_changed_nodes(parent.left);
+		node_changed(parent.left);
 		node.left  = parent.left;
 		node.right = NIL;
 		if(parent.left!=NIL)
@@ -482,7 +460,7 @@ void B_Tree::insert_node(Node &parent, Node &node){
 		parent.left = node.id;
 
 	}else{
-		//add_changed_nodes(parent.right);
+		node_changed(parent.right);
 		node.left  = NIL;
 		node.right = parent.right;
 		if(parent.right!=NIL)
@@ -497,13 +475,15 @@ void B_Tree::delete_node(Node &node){
 	int subchild = NIL;	// child's subtree
 	int subparent= NIL; 
 
+	node_changed(node.id);
+
 	if(!node.isleaf()){
 		bool left= rand_bool();			// choose a child to pull up
 		if(node.left ==NIL) left=false;
 		if(node.right==NIL) left=true;
 
-		//add_changed_nodes(node.left);
-		//add_changed_nodes(node.right);
+		node_changed(node.left);
+		node_changed(node.right);
 
 		if(left){
 			child = node.left;			// child will never be NIL
@@ -523,15 +503,14 @@ void B_Tree::delete_node(Node &node){
 				nodes[child].left = node.left;
 			}
 		}
-		//add_changed_nodes(subchild);
+		node_changed(subchild);
 		nodes[child].parent = node.parent;
 	}
 
 	if(node.parent == NIL){			// root
-		//	  changed_root = nodes_root;
 		nodes_root = child;
 	}else{					// let parent connect to child
-		//add_changed_nodes(node.parent);
+		node_changed(node.parent);
 		if(node.id == nodes[node.parent].left)
 			nodes[node.parent].left	 = child;
 		else
@@ -547,7 +526,7 @@ void B_Tree::delete_node(Node &node){
 			Node &p = nodes[subparent];
 
 			if(p.left==NIL || p.right==NIL){
-				//add_changed_nodes(p.id);
+				node_changed(p.id);
 
 				sc.parent = p.id;
 				if(p.left==NIL) p.left = sc.id;
@@ -21,7 +21,12 @@ class SFRA;
 
 // I should get rid of these globals;
 char line[100],t1[40],t2[40];
-ifstream fs;
+
+// weight of the area outside the fixed outline in getCost(); kept small
+// so that the adaptive annealing schedule does not cool down slower;
+// the annealing prefers anyway the solutions inside the outline when it
+// keeps the best one;
+#define OUTLINE_PENALTY 0.25
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -31,7 +36,9 @@ ifstream fs;
 ////////////////////////////////////////////////////////////////////////////////
 
 FPlan::~FPlan() {
-	fs.close();
+	if ( _own_netlist) {
+		delete _own_netlist;
+	}
 }
 
 FPlan::FPlan(float calpha=1)
@@ -40,13 +47,94 @@ FPlan::FPlan(float calpha=1)
 	norm_wire = 1;
 	cost_alpha = calpha;
 	_sfra = 0; // has to be set by calling set_sfra_host();
+	_netlist = 0; // has to be set by calling set_netlist();
+	_own_netlist = 0;
+	modules_N = 0;
+	TotalArea = 0;
+	Width = 0;
+	Height = 0;
+	_rand_state = 1;
+	_log = stdout;
+	_outline = 0;
+	_stack_weight = 0;
+	_stack_width = 0;
+	_stack_height = 0;
+	_noc_weight = 0;
+	_noc_ary = 0;
+	_noc_valid = false;
+	_noc_link = 0;
+	_noc_hops = 0;
+	norm_noc_link = 1;
+	norm_noc_hops = 1;
+}
+
+FPlan::FPlan(const FPlan &fp)
+{
+	// the copy shares the netlist of fp; only the placement state
+	// is duplicated;
+	Area = fp.Area;
+	WireLength = fp.WireLength;
+	TotalArea = fp.TotalArea;
+	_netlist = fp._netlist;
+	_own_netlist = 0;
+	norm_area = fp.norm_area;
+	norm_wire = fp.norm_wire;
+	cost_alpha = fp.cost_alpha;
+	_sfra = fp._sfra;
+	modules_N = fp.modules_N;
+	modules_info = fp.modules_info;
+	Width = fp.Width;
+	Height = fp.Height;
+	_rand_state = fp._rand_state;
+	_log = fp._log;
+	_outline = fp._outline;
+	_stack_weight = fp._stack_weight;
+	_stack_width = fp._stack_width;
+	_stack_height = fp._stack_height;
+	_noc_weight = fp._noc_weight;
+	_noc_ary = fp._noc_ary;
+	_noc_flows = fp._noc_flows;
+	_noc_order = fp._noc_order;
+	_noc_router = fp._noc_router;
+	_noc_router_used = fp._noc_router_used;
+	_noc_dx = fp._noc_dx;
+	_noc_dy = fp._noc_dy;
+	_noc_cols = fp._noc_cols;
+	_noc_link_of = fp._noc_link_of;
+	_noc_valid = fp._noc_valid;
+	_noc_rows = fp._noc_rows;
+	_noc_link = fp._noc_link;
+	_noc_hops = fp._noc_hops;
+	norm_noc_link = fp.norm_noc_link;
+	norm_noc_hops = fp.norm_noc_hops;
+}
+
+void FPlan::set_netlist( const NETLIST *netlist)
+{
+	_netlist = netlist;
+	modules_N = netlist->modules_N;
+	TotalArea = netlist->TotalArea;
+	modules_info.resize(modules_N);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// NETLIST
+//
+////////////////////////////////////////////////////////////////////////////////
+
+NETLIST::NETLIST()
+{
+	modules_N = 0;
+	TotalArea = 0;
 	// reset the id of the root module to -1; this will mean that
 	// there is no root module with pins and global nets to be used 
 	// for WL calculations; this will be the case of subfloorplans only;
 	root_module.id = -1;
+	nets_start.push_back(0);
 }
 
-void FPlan::inflate_core( int id, int routers)
+void NETLIST::inflate_core( int id, int routers)
 {
 	// expand the dimensions of a core as if a certain number of routers 
 	// were being implemented inside it (in the same plane);
@@ -74,12 +162,39 @@ void FPlan::clear()
 
 double FPlan::getCost()
 {
+	double cost;
 	if(cost_alpha==1)
-		return cost_alpha*(Area/norm_area);
+		cost = cost_alpha*(Area/norm_area);
 	else if(cost_alpha < 1e-4)
-		return (WireLength/norm_wire);
+		cost = (WireLength/norm_wire);
 	else
-		return cost_alpha*(Area/norm_area)+(1-cost_alpha)*(WireLength/norm_wire);
+		cost = cost_alpha*(Area/norm_area)+(1-cost_alpha)*(WireLength/norm_wire);
+	if(_outline > 0)
+		cost += OUTLINE_PENALTY * getOutlineViolation();
+	if(_stack_weight > 0)
+		cost += getStackPenalty(Width, Height);
+	if(_noc_weight > 0)
+		cost += _noc_weight * 0.5 * (_noc_link/norm_noc_link + _noc_hops/norm_noc_hops);
+	return cost;
+}
+
+double FPlan::getOutlineViolation()
+{
+	// area of the floorplan outside the fixed outline, relative to the
+	// area of the cores;
+	double inside = fmin(Width, _outline) * fmin(Height, _outline);
+	return (Width * Height - inside) / TotalArea;
+}
+
+double FPlan::getStackPenalty(double width, double height)
+{
+	// area outside the outline of the other layers, relative to the area
+	// of the cores; the layers of a stack that match their outlines have
+	// a smaller footprint;
+	if(_stack_weight <= 0)
+		return 0;
+	double inside = fmin(width, _stack_width) * fmin(height, _stack_height);
+	return _stack_weight * (width * height - inside) / TotalArea;
 }
 
 float FPlan::getDeadSpace()
@@ -90,17 +205,156 @@ float FPlan::getDeadSpace()
 void FPlan::normalize_cost(int t)
 {
 	norm_area=norm_wire=0;
+	norm_noc_link=norm_noc_hops=0;
 
 	for (int i=0; i < t; i++) {
 		perturb();
 		packing(); // Note: B_Tree has packing() too;
 		norm_area += Area;
 		norm_wire += WireLength;
+		norm_noc_link += _noc_link; // 0 if no NoC-aware cost;
+		norm_noc_hops += _noc_hops;
 	}
   
 	norm_area /= t;
 	norm_wire /= t;
-	printf("normalize area=%.0f, wire=%.0f\n", norm_area, norm_wire);
+	fprintf(_log, "normalize area=%.0f, wire=%.0f\n", norm_area, norm_wire);
+	norm_noc_link = (norm_noc_link > 0) ? norm_noc_link / t : 1;
+	norm_noc_hops = (norm_noc_hops > 0) ? norm_noc_hops / t : 1;
+	if (_noc_weight > 0) {
+		fprintf(_log, "normalize noc link=%.0f, hops=%.0f\n", norm_noc_link, norm_noc_hops);
+	}
+}
+
+void FPlan::set_noc_cost( float weight, int ary)
+{
+	_noc_weight = weight;
+	_noc_ary = ary;
+	_noc_flows.clear();
+	_noc_order.clear();
+	if ( weight <= 0) {
+		return;
+	}
+
+	// flows are the communications between cores, as for the latency
+	// estimator; cores with more traffic pick their router first;
+	vector<double> traffic( modules_N, 0.0);
+	for ( int i = 0; i < modules_N; i++) {
+		for ( int j = i + 1; j < modules_N; j++) {
+			double volume = _netlist->_connection[i][j] + _netlist->_connection[j][i];
+			if ( volume > 0) {
+				Noc_Flow flow;
+				flow.src = i;
+				flow.des = j;
+				flow.volume = volume;
+				_noc_flows.push_back( flow);
+				traffic[i] += volume;
+				traffic[j] += volume;
+			}
+		}
+	}
+	for ( int i = 0; i < modules_N; i++) {
+		_noc_order.push_back( i);
+	}
+	for ( int i = 1; i < modules_N; i++) { // stable insertion sort;
+		int id = _noc_order[i];
+		int k = i;
+		for ( ; k > 0 && traffic[ _noc_order[k-1]] < traffic[id]; k--) {
+			_noc_order[k] = _noc_order[k-1];
+		}
+		_noc_order[k] = id;
+	}
+	_noc_router.resize( modules_N);
+	_noc_link_of.resize( modules_N);
+	_noc_valid = false;
+	_noc_router_used.resize( ary * ary);
+	_noc_dx.resize( ary);
+	_noc_dy.resize( ary);
+	_noc_cols.resize( ary);
+	_noc_rows.resize( ary);
+}
+
+void FPlan::sort_noc_lines( const vector<double> &dist, vector<int> &lines)
+{
+	// insertion sort; the mesh has only a few rows and columns;
+	for ( int g = 0; g < dist.size(); g++) {
+		int k = g;
+		for ( ; k > 0 && dist[ lines[k-1]] > dist[g]; k--) {
+			lines[k] = lines[k-1];
+		}
+		lines[k] = g;
+	}
+}
+
+void FPlan::update_noc_estimate()
+{
+	// greedy approximation of the routers assignment done for simulation
+	// (SFRA::assign_routers_to_cores): no Hungarian, every core just takes
+	// the nearest free router; the distance between a router and its
+	// nearest corner is the sum of the distances to the nearest vertical
+	// and to the nearest horizontal side of the core, which are computed
+	// once per core for all the columns and rows of the mesh; rows and
+	// columns are then visited nearest first, so that the search stops
+	// as soon as no closer router can be found;
+	int ary = _noc_ary;
+	double pitch = ( ary > 1) ? min( Width, Height) / ( ary - 1) : 0;
+	fill( _noc_router_used.begin(), _noc_router_used.end(), 0);
+	bool routers_changed = !_noc_valid;
+	_noc_valid = true;
+
+	for ( int k = 0; k < modules_N; k++) {
+		int id = _noc_order[k];
+		const Module_Info &mi = modules_info[id];
+		for ( int g = 0; g < ary; g++) {
+			_noc_dx[g] = min( fabs( mi.x - pitch * g), fabs( mi.rx - pitch * g));
+			_noc_dy[g] = min( fabs( mi.y - pitch * g), fabs( mi.ry - pitch * g));
+		}
+		sort_noc_lines( _noc_dx, _noc_cols);
+		sort_noc_lines( _noc_dy, _noc_rows);
+		int best_j = -1;
+		double best_dist = 0;
+		for ( int yi = 0; yi < ary; yi++) {
+			int y = _noc_rows[yi];
+			if ( best_j >= 0 && _noc_dy[y] + _noc_dx[ _noc_cols[0]] >= best_dist) {
+				break;
+			}
+			for ( int xi = 0; xi < ary; xi++) {
+				int x = _noc_cols[xi];
+				int j = x + y * ary;
+				double dist = _noc_dx[x] + _noc_dy[y];
+				if ( best_j >= 0 && dist >= best_dist) {
+					break;
+				}
+				if ( !_noc_router_used[j]) {
+					best_j = j;
+					best_dist = dist;
+					break; // the rest of this row is farther;
+				}
+			}
+		}
+		_noc_router_used[best_j] = 1;
+		if ( _noc_router[id] != best_j) {
+			_noc_router[id] = best_j;
+			routers_changed = true;
+		}
+		_noc_link_of[id] = best_dist;
+	}
+	_noc_link = 0;
+	for ( int id = 0; id < modules_N; id++) {
+		_noc_link += _noc_link_of[id];
+	}
+
+	// hops of the XY (minimal) routes between the routers of every flow;
+	if ( !routers_changed) {
+		return;
+	}
+	_noc_hops = 0;
+	for ( int f = 0; f < _noc_flows.size(); f++) {
+		int a = _noc_router[ _noc_flows[f].src];
+		int b = _noc_router[ _noc_flows[f].des];
+		_noc_hops += _noc_flows[f].volume *
+			( abs( a % ary - b % ary) + abs( a / ary - b / ary));
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -115,7 +369,7 @@ char *tail(char *str)
 	return str;
 }
 
-void FPlan::read( char *file, float scale)
+void NETLIST::read( char *file, float scale, SFRA *sfra)
 {
 	// testcase file has .fp extension; open it and read module by module;
 	char fp_file[256];
@@ -123,8 +377,8 @@ void FPlan::read( char *file, float scale)
 	strcat(fp_file,".fp");
 
 	filename = fp_file; 
-	fs.open(fp_file);
-	if (fs==NULL)
+	ifstream fs(fp_file);
+	if (fs.fail())
 		error("Error:\tUnable to open file: %s",fp_file);
 	fs.clear(); // needed for a big loop in Windows;
 
@@ -152,15 +406,15 @@ void FPlan::read( char *file, float scale)
 			final = true;
 	
 		// (b) dimension;
-		read_dimension(mod,scale);
+		read_dimension(fs,mod,scale);
 
 		// (c) pins of this module;	  
-		read_IO_list(mod,final);
+		read_IO_list(fs,mod,final);
 
 		// (d) if this was the last module, which is the "TYPE PARENT;" one,
 		// then read in one shot only the actual network;
 		if (final) {
-			read_network();
+			read_network(fs);
 			break;
 		}
 	}
@@ -213,15 +467,14 @@ void FPlan::read( char *file, float scale)
 	root_module = modules.back();
 	modules.pop_back(); // exclude the parent module;
 	modules_N = modules.size();	 
-	modules_info.resize(modules_N);
-	modules.resize(modules_N);
 
-	// () create the actual list of nets as arrays of pin pointers; here we
+	// () create the actual list of nets as arrays of pins; here we
 	// also create nets for example for the 3 VSS,VDD,GND due to the last 
 	// parent module (which itself is removed from the list of modules);
 	// these 3 nets VSS,VDD,GND are global nets; should not be used in any 
 	// of the subfloorplans;
-	create_network();
+	create_network(sfra);
+	fs.close();
 
 	TotalArea = 0;
 	for (int i=0; i < modules_N; i++) {
@@ -229,7 +482,7 @@ void FPlan::read( char *file, float scale)
 	}
 }
 
-void FPlan::read_dimension(Module &mod,float scale)
+void NETLIST::read_dimension(ifstream &fs,Module &mod,float scale)
 {
 	// read dimensions of this module;
 	// example:
@@ -257,7 +510,7 @@ void FPlan::read_dimension(Module &mod,float scale)
 	fs >> t1 >> t2;
 }
 
-void FPlan::read_IO_list(Module &mod,bool parent=false)
+void NETLIST::read_IO_list(ifstream &fs,Module &mod,bool parent=false)
 {
 	// read IO pins of this module: create its list of Pins;
 	// example:
@@ -294,7 +547,7 @@ void FPlan::read_IO_list(Module &mod,bool parent=false)
 	fs.getline(line,100);
 }
 
-void FPlan::read_network()
+void NETLIST::read_network(ifstream &fs)
 {
 	// called only once;
 	// example:
@@ -343,24 +596,44 @@ void FPlan::read_network()
 	}
 }
 
-void FPlan::create_network()
+void NETLIST::create_nets()
 {
-
-	// (0) part 1: create actual list of nets as lists of pin pointers 
-	// (pins that were created during module creation);
-	network.resize(net_table.size());
-
+	// create actual list of nets as lists of pins (copies of the pins that
+	// were created during module creation); first count the pins of every
+	// net, then place them;
+	int nets_N = net_table.size();
+	nets_start.assign(nets_N+1, 0);
 	for (int i=0; i < modules_N; i++){
 		for(int j=0; j < modules[i].pins.size(); j++){
-			Pin &p = modules[i].pins[j];
-			network[p.net].push_back(&p);
+			nets_start[ modules[i].pins[j].net + 1] ++;
 		}
 	}
+	for (int j=0; j < root_module.pins.size(); j++){
+		nets_start[ root_module.pins[j].net + 1] ++;
+	}
+	for (int i=0; i < nets_N; i++) {
+		nets_start[i+1] += nets_start[i];
+	}
 
+	vector<int> next_pin( nets_start.begin(), nets_start.end() - 1);
+	nets_pins.resize( nets_start[nets_N]);
+	for (int i=0; i < modules_N; i++){
+		for(int j=0; j < modules[i].pins.size(); j++){
+			const Pin &p = modules[i].pins[j];
+			nets_pins[ next_pin[p.net]++] = p;
+		}
+	}
 	for (int j=0; j < root_module.pins.size(); j++){
-		Pin &p = root_module.pins[j];
-		network[p.net].push_back(&p);
+		const Pin &p = root_module.pins[j];
+		nets_pins[ next_pin[p.net]++] = p;
 	}
+}
+
+void NETLIST::create_network( SFRA *sfra)
+{
+
+	// (0) part 1: create actual list of nets as lists of pins;
+	create_nets();
 
 
 
@@ -370,11 +643,11 @@ void FPlan::create_network()
 		_connection[i].resize(modules_N+1);
 		fill(_connection[i].begin(), _connection[i].end(), 0);
 	}
-	for (int i=0; i < network.size(); i++) {
-		for (int j=0; j < network[i].size()-1; j++) {
-			int p = network[i][j]->mod; // module id of j-th pin of i-th net index;
-			for (int k=j+1; k < network[i].size(); k++) {
-				int q = network[i][k]->mod; // module id of k-th pin of i-th net index;
+	for (int i=0; i < nets_count(); i++) {
+		for (int j=0; j < net_pins_count(i)-1; j++) {
+			int p = net_pin(i,j).mod; // module id of j-th pin of i-th net index;
+			for (int k=j+1; k < net_pins_count(i); k++) {
+				int q = net_pin(i,k).mod; // module id of k-th pin of i-th net index;
 				// if p is the source of any arc and q is its destination
 				// then record the comm volume as the _connection[p][q];
 				bool pq_is_an_arc = false;
@@ -403,7 +676,7 @@ void FPlan::create_network()
 	// creation; create test case (files output)
 	// must be done in Linux so the text files follow the UNIX standard
 	// (google for "ifstream tellg UNIX Windows bug")
-	if ( _sfra->testcase_creation() == true) {
+	if ( sfra->testcase_creation() == true) {
 		double TOTAL_CYCLES_COUNT = 1000000.0; // initially was 10000.0;
 		vector<INJECTION > injections;
 		INJECTION temp_inj;
@@ -415,7 +688,7 @@ void FPlan::create_network()
 		// at around 50%; be carefull not to overflow variables
 		float multiplier;
 		
-		multiplier = _sfra->testcase_multiplier();
+		multiplier = sfra->testcase_multiplier();
 		srand(1);
 		vector<pair<int,int > > printed;
 		pair<int,int> temp;
@@ -496,7 +769,7 @@ void FPlan::create_network()
 
 }
 
-void FPlan::print_connections_between_modules()
+void NETLIST::print_connections_between_modules()
 {
 	vector< pair<int, int> > printed;
 	pair<int, int> temp;
@@ -561,70 +834,55 @@ void FPlan::print_connections_between_modules()
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-void FPlan::scaleIOPad()
-{
-	float px = Width/float(root_module.width);
-	float py = Height/float(root_module.height);
-	
-	for (int i=0; i < root_module.pins.size(); i++){
-		Pin &p = root_module.pins[i];
-		p.ax = int(px * p.x);
-		p.ay = int(py * p.y);
-	}	   
-}
-
 double FPlan::calcWireLength( bool include_root_module)
 {
 	// if include_root_module is false then WL is computed w/o
 	// considering nets connected to the root_module; default it's true;
 
 	// (1) if the root_module exists, then scale its own pin locations too;
-	if ( root_module.id >= 0) {
-		scaleIOPad();
+	// otherwise, the pins of the root_module (if any, 3D layers 2 and up) are fixed;
+	const Module &root_module = _netlist->root_module;
+	bool scale_io_pads = ( root_module.id >= 0);
+	float px = 1, py = 1;
+	if ( scale_io_pads) {
+		px = Width/float(root_module.width);
+		py = Height/float(root_module.height);
 	}
 
-	// (2) accumulate WL;
+	// (2) accumulate WL; absolute positions of pins are computed on the
+	// fly from the placement of their modules;
 	WireLength = 0;
-	// compute absolute positions for all pins of all modules;
-	for (int i=0; i < modules_N; i++) {	
-		int mx = modules_info[i].x;
-		int my = modules_info[i].y;
-		bool rotate = modules_info[i].rotate;
-		int w = modules[i].width;
-
-		for (int j=0; j < modules[i].pins.size(); j++) {
-			Pin &p = modules[i].pins[j];
-
-			if (!rotate) {	  
-				p.ax = p.x+mx; p.ay = p.y+my;
-			} else { // Y' = W - X, X' = Y
-				p.ax = p.y+mx; p.ay = (w-p.x)+my;
-			} 
-		}
-	}
-
-	for (int i=0; i < network.size(); i++) {	   
+	int nets_N = _netlist->nets_count();
+	for (int i=0; i < nets_N; i++) {	   
 		int max_x= INT_MIN, max_y= INT_MIN;		 
 		int min_x= INT_MAX, min_y= INT_MAX;		 
 
-		assert( network[i].size() > 0);
-		bool is_root_module_net = false;
-		for (int j=0; j < network[i].size(); j++) {
-			Pin &p = *network[i][j];
-			//if ( !include_root_module) {
-			//	if ( p.mod == root_module.id) {
-			//		is_root_module_net = true;
-			//		break;
-			//	}
-			//}
-			max_x = max(max_x, p.ax); max_y = max(max_y, p.ay);
-			min_x = min(min_x, p.ax); min_y = min(min_y, p.ay);
+		assert( _netlist->net_pins_count(i) > 0);
+		const Pin *pins = &_netlist->nets_pins[ _netlist->nets_start[i]];
+		const Pin *pins_end = &pins[ _netlist->net_pins_count(i)];
+		for ( ; pins != pins_end; pins++) {
+			const Pin &p = *pins;
+			int ax, ay;
+			if ( p.mod >= 0 && p.mod < modules_N) {
+				const Module_Info &mi = modules_info[p.mod];
+				if (!mi.rotate) {	  
+					ax = p.x+mi.x; ay = p.y+mi.y;
+				} else { // Y' = W - X, X' = Y
+					ax = p.y+mi.x; ay = (_netlist->modules[p.mod].width-p.x)+mi.y;
+				} 
+			} else if ( scale_io_pads) {
+				ax = int(px * p.x);
+				ay = int(py * p.y);
+			} else {
+				ax = p.x; ay = p.y;
+			}
+			max_x = max(max_x, ax); max_y = max(max_y, ay);
+			min_x = min(min_x, ax); min_y = min(min_y, ay);
 		}
-		//if ( is_root_module_net) continue;
 		//printf("%d %d %d %d\n",max_x,min_x,max_y,min_y);
 		// Note: here we weight the 1/2 perimeter wirelength of this net
 		// with its communication volume;
-		WireLength += ( _communications_volume[i] ) * // weight;
+		WireLength += ( _netlist->_communications_volume[i] ) * // weight;
 			( (max_x-min_x)+(max_y-min_y) );
 	}
 	return WireLength;
@@ -647,19 +905,19 @@ void FPlan::get_module_center_coordinates(
 
 void FPlan::show_modules()
 {
-	cout << endl;
-	for (int i=0; i < modules.size(); i++) {
-		cout << "Module " << i << ": " << modules[i].name << endl;
-		cout << "  Width = " << modules[i].width;
-		cout << "  Height= " << modules[i].height << endl;
-		cout << "  Area  = " << modules[i].area << endl;
+	fprintf(_log, "\n");
+	for (int i=0; i < _netlist->modules.size(); i++) {
+		fprintf(_log, "Module %d: %s\n", i, _netlist->modules[i].name);
+		fprintf(_log, "  Width = %d", _netlist->modules[i].width);
+		fprintf(_log, "  Height= %d\n", _netlist->modules[i].height);
+		fprintf(_log, "  Area  = %d\n", _netlist->modules[i].area);
 		
-		cout << "  Pins (" << modules[i].pins.size() << "), nets: ";;
-		for (int j=0; j < modules[i].pins.size(); j++) {
-			cout << " " << modules[i].pins[j].net;
-			//cout << modules[i].pins[j].x << " " << modules[i].pins[j].y << endl;
+		fprintf(_log, "  Pins (%d), nets: ", int(_netlist->modules[i].pins.size()));
+		for (int j=0; j < _netlist->modules[i].pins.size(); j++) {
+			fprintf(_log, " %d", _netlist->modules[i].pins[j].net);
+			//cout << _netlist->modules[i].pins[j].x << " " << _netlist->modules[i].pins[j].y << endl;
 		}
-		cout << endl;	
+		fprintf(_log, "\n");	
 	}
 }
 
@@ -691,14 +949,14 @@ void FPlan::list_information()
 	}
 	---*/
 
-	cout << "Num of Module  = " << modules_N << endl;
-	cout << "Height         = " << Height << endl;
-	cout << "Width          = " << Width << endl;
-	cout << "Aspect ratio   = " << ((Height >= Width)?(Height/Width):(Width/Height)) << endl;
-	cout << "Area (H*W)     = " << Area << endl;
-	cout << "Wire Length    = " << calcWireLength( true) << endl;
-	cout << "Used Area      = " << TotalArea << endl;
-	printf( "Dead Space (%) = %.2f\n", getDeadSpace());
+	fprintf(_log, "Num of Module  = %d\n", modules_N);
+	fprintf(_log, "Height         = %g\n", Height);
+	fprintf(_log, "Width          = %g\n", Width);
+	fprintf(_log, "Aspect ratio   = %g\n", ((Height >= Width)?(Height/Width):(Width/Height)));
+	fprintf(_log, "Area (H*W)     = %g\n", Area);
+	fprintf(_log, "Wire Length    = %g\n", calcWireLength( true));
+	fprintf(_log, "Used Area      = %g\n", TotalArea);
+	fprintf(_log, "Dead Space (%%) = %.2f\n", getDeadSpace());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -714,28 +972,44 @@ void error(char *msg,char *msg2)
 	throw 1;
 }
 
-bool rand_bool()
-{
-	return bool(rand()%2);
-}
-
-float rand_01()
-{
-	return float(rand()%10000)/10000;
-}
-
 ////////////////////////////////////////////////////////////////////////////////
 //
 // subfloorplans
 // functions related to creating sub-floorplans from a top level
-// floorplan which has been partitioned and has modules in partition 0 or 1;
-// partition_id dictates what IP/cores are to form the sub-floorplan;
+// floorplan which has been partitioned and has modules in partitions 0, 1,
+// ..., one per layer; partition_id dictates what IP/cores are to form the
+// sub-floorplan;
 //
 ////////////////////////////////////////////////////////////////////////////////
 
 void FPlan::create_subfloorplan( int sub_floorplan_id, FPlan *fp_p, 
 	vector<int> partition) 
 {
+	// the subfloorplan owns its netlist; it is recreated for every
+	// attempt because the partition may change;
+	if ( _own_netlist) {
+		delete _own_netlist;
+	}
+	_own_netlist = new NETLIST();
+	_own_netlist->create_subfloorplan( sub_floorplan_id, fp_p->netlist(), partition);
+	set_netlist( _own_netlist);
+}
+
+void FPlan::create_subfloorplan_on_layer( int sub_floorplan_id,
+	FPlan *fp_toplevel, FPlan *fp_p1, vector<int> partition)	
+{
+	if ( _own_netlist) {
+		delete _own_netlist;
+	}
+	_own_netlist = new NETLIST();
+	_own_netlist->create_subfloorplan_on_layer( sub_floorplan_id,
+		fp_toplevel->netlist(), fp_p1, partition);
+	set_netlist( _own_netlist);
+}
+
+void NETLIST::create_subfloorplan( int sub_floorplan_id, const NETLIST *fp_p, 
+	vector<int> &partition) 
+{
 
 	Module dummy_mod;
 
@@ -764,7 +1038,7 @@ void FPlan::create_subfloorplan( int sub_floorplan_id, FPlan *fp_p,
 	}
 	// a temporary array for recording if a top-level net is preserved
 	// inside the subfloorplan or not;
-	int t_network_N = fp_p->network.size();
+	int t_network_N = fp_p->nets_count();
 	vector<int> top_net_preserved;
 	for ( int i=0; i < t_network_N; i++) {
 		top_net_preserved.push_back( -1);
@@ -797,7 +1071,7 @@ void FPlan::create_subfloorplan( int sub_floorplan_id, FPlan *fp_p,
 			// with the corrected ids according to the magic numbers;
 			//printf("\nModule: %d", i);
 			for (int j=0; j < fp_p->modules[i].pins.size(); j++) {
-				Pin &t_p = fp_p->modules[i].pins[j];
+				const Pin &t_p = fp_p->modules[i].pins[j];
 				int net_id = fp_p->modules[i].pins[j].net;
 				// if this top-level net has the other terminal (all nets
 				// in the appl. task graph have only two terminals, src and dest),
@@ -849,24 +1123,15 @@ void FPlan::create_subfloorplan( int sub_floorplan_id, FPlan *fp_p,
 			stringstream my_ss;
 			my_ss << i;
 			int sub_fp_net_id = net_table[ my_ss.str()]; 
-			_communications_volume[sub_fp_net_id] = fp_p->communications_volume(i);
+			_communications_volume[sub_fp_net_id] = fp_p->_communications_volume[i];
 			//printf("\ncomm_volume[%d]: %d",sub_fp_net_id,_communications_volume[sub_fp_net_id]);
 		}
 	}
 
 
 	// (4) create network of subfloorplan;
-	// create actual list of nets as lists of pin pointers 
-	// (pins that were created during module creation);
 	modules_N = modules.size(); // record final number of modules of subfloorplan;
-	modules_info.resize(modules_N); // allocate mem for modules_info - used during SA;
-	network.resize(net_table.size());
-	for (int i=0; i < modules_N; i++){
-		for(int j=0; j < modules[i].pins.size(); j++){
-			Pin &p = modules[i].pins[j];
-			network[p.net].push_back(&p);
-		}
-	}
+	create_nets();
 
 
 	TotalArea = 0;
@@ -879,9 +1144,12 @@ void FPlan::create_subfloorplan( int sub_floorplan_id, FPlan *fp_p,
 	//show_modules();
 }
 
-void FPlan::create_subfloorplan_layer2(
-	FPlan *fp_toplevel, FPlan *fp_p1, vector<int> partition)	
+void NETLIST::create_subfloorplan_on_layer( int sub_floorplan_id,
+	const NETLIST *fp_toplevel, FPlan *fp_p1, vector<int> &partition)	
 {
+	// the subfloorplan of the layer of partition sub_floorplan_id (1 or
+	// more), after layer 1 (partition 0) was floorplanned by fp_p1; nets
+	// to the modules of any other layer, not floorplanned yet, are left out;
 	Module dummy_mod;
 
 
@@ -910,7 +1178,7 @@ void FPlan::create_subfloorplan_layer2(
 			topid_to_subid_1[ i] = counter_i_1;
 			subid_to_topid_1.push_back( i);
 			counter_i_1 ++;
-		} else if ( partition[i] == 1) {
+		} else if ( partition[i] == sub_floorplan_id) {
 			topid_to_subid_2[ i] = counter_i_2;
 			subid_to_topid_2.push_back( i);
 			counter_i_2 ++;
@@ -919,8 +1187,8 @@ void FPlan::create_subfloorplan_layer2(
 	int modules_N_1 = counter_i_1;
 	int modules_N_2 = counter_i_2;
 	// a temporary array for recording if a top-level net is preserved
-	// inside the subfloorplan 2, on layer 2, or not;
-	int network_N_toplevel = fp_toplevel->network.size();
+	// inside this subfloorplan or not;
+	int network_N_toplevel = fp_toplevel->nets_count();
 	vector<int> top_net_preserved;
 	for ( int i=0; i < network_N_toplevel; i++) {
 		top_net_preserved.push_back( -1);
@@ -943,11 +1211,11 @@ void FPlan::create_subfloorplan_layer2(
 	root_module.x = 0;
 	root_module.y = 0;	
 
-	// now add the actual modules in partition "1";
+	// now add the actual modules in partition "sub_floorplan_id";
 	counter_i_2 = 0;
 	for ( int i=0; i < modules_N_toplevel; i++) {
 
-		if ( partition[ i] == 1) {
+		if ( partition[ i] == sub_floorplan_id) {
 
 			// () create module of subfloorplan;
 			modules.push_back( dummy_mod);
@@ -968,7 +1236,7 @@ void FPlan::create_subfloorplan_layer2(
 			// with the corrected ids according to the magic numbers;
 			//printf("\nModule: %d", i);
 			for (int j=0; j < fp_toplevel->modules[i].pins.size(); j++) {
-				Pin &p_toplevel = fp_toplevel->modules[i].pins[j];
+				const Pin &p_toplevel = fp_toplevel->modules[i].pins[j];
 				int net_id = fp_toplevel->modules[i].pins[j].net;
 				// if this top-level net has the other terminal (all nets
 				// in the appl. task graph have only two terminals, src and dest),
@@ -980,10 +1248,15 @@ void FPlan::create_subfloorplan_layer2(
 				//printf("\n net_id: %d src: %d des: %d", net_id, src_id,des_id);
 				assert( i == src_id || i == des_id);
 				int other_i = (i == src_id) ? des_id : src_id;
+				if ( partition[ other_i] != sub_floorplan_id &&
+					partition[ other_i] != 0) {
+					// the other pin is on a layer not floorplanned yet;
+					continue;
+				}
 
 
 				// here, we copy every pin anyway, irrespective of if the other
-				// pin of the net is in same partition or not;
+				// pin of the net is in same partition or layer 1;
 				Pin p;
 				p.mod = counter_i_2;
 				p.x = p_toplevel.x; p.y = p_toplevel.y;
@@ -1001,7 +1274,7 @@ void FPlan::create_subfloorplan_layer2(
 				mod.pins.push_back( p); // record new pin to subfloorplan 2 module mod;
 
 
-				if ( partition[ other_i] != 1) {
+				if ( partition[ other_i] == 0) {
 					// the other pin is of a module from subfloorplan 1 on layer 1;
 					// we add it here as a pin of PARENT (ie root_module) of this
 					// subfloorplan 2; this pin has fixed coordinates and will act
@@ -1018,8 +1291,6 @@ void FPlan::create_subfloorplan_layer2(
 					fp_p1->get_module_center_coordinates( mod_i, pin_ax, pin_ay);
 					p_fixed.x = pin_ax;
 					p_fixed.y = pin_ay;
-					p_fixed.ax = pin_ax;
-					p_fixed.ay = pin_ay;
 					p_fixed.net = net_table[ my_ss.str()];
 					root_module.pins.push_back( p_fixed); // record this new pin to subfloorplan module mod;
 				}
@@ -1039,29 +1310,16 @@ void FPlan::create_subfloorplan_layer2(
 			stringstream my_ss;
 			my_ss << i;
 			int sub_fp_net_id = net_table[ my_ss.str()]; 
-			_communications_volume[sub_fp_net_id] = fp_toplevel->communications_volume(i);
+			_communications_volume[sub_fp_net_id] = fp_toplevel->_communications_volume[i];
 			//printf("\ncomm_volume[%d]: %d",sub_fp_net_id,_communications_volume[sub_fp_net_id]);
 		}
 	}
 
 
-	// (4) create network of subfloorplan;
-	// create actual list of nets as lists of pin pointers 
-	// (pins that were created during module creation);
+	// (4) create network of subfloorplan; it includes also the pins of
+	// the root_module with all its pins fixed;
 	modules_N = modules.size(); // record final number of modules of subfloorplan;
-	modules_info.resize(modules_N); // allocate mem for modules_info - used during SA;
-	network.resize(net_table.size());
-	for (int i=0; i < modules_N; i++) {
-		for (int j=0; j < modules[i].pins.size(); j++) {
-			Pin &p = modules[i].pins[j];
-			network[p.net].push_back( &p);
-		}
-	}
-	// add also the pins of the root_module with all its pins fixed;
-	for (int j=0; j < root_module.pins.size(); j++) {
-		Pin &p = root_module.pins[j];
-		network[p.net].push_back( &p);
-	}
+	create_nets();
 
 
 	TotalArea = 0;
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <assert.h>
 #include <cmath>
+#include <sys/time.h>
 #include "fp_sa.h"
 
 using namespace std;
@@ -13,6 +14,33 @@ using namespace std;
 //
 ////////////////////////////////////////////////////////////////////////////////
 
+// with a fixed outline, any solution inside it is better than all the
+// solutions outside it; without outline, all solutions fit;
+static bool better_than_best( double cost, bool fits, double best, bool best_fits)
+{
+	if ( fits != best_fits) {
+		return fits;
+	}
+	return ( cost < best);
+}
+
+static double wall_seconds()
+{
+	struct timeval tv;
+	gettimeofday( &tv, 0);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+// equilibrium detection: a temperature ends, after at least
+// SA_MIN_MOVES_RATIO * N moves, as soon as the mean cost of the current
+// solution over the last window of N / SA_EQUILIBRIUM_WINDOWS moves is
+// within SA_EQUILIBRIUM_TOL of the one over the window before (the chain
+// reached equilibrium at this temperature); the local search stage ends
+// at its first temperature that does not improve the best solution;
+#define SA_EQUILIBRIUM_WINDOWS 4
+#define SA_EQUILIBRIUM_TOL 0.005
+#define SA_MIN_MOVES_RATIO 0.5
+
 // initial original version:
 // double SA_Floorplan(FPlan &fp, int k, int local, float term_T) {...}
 //
@@ -24,115 +52,403 @@ using namespace std;
 void SA_FLOORPLANING::run_SA_Floorplaning()
 {
 	// I should make it return the runtime it takes;
+	start_SA_Floorplaning();
+	while ( anneal_temperature()) {}
+	finish_SA_Floorplaning();
+}
 
-	int MT, uphill, reject;
-	double pre_cost, best,cost;
-	float d_cost,reject_rate;
-  
-	int N = _times * _fp_p->size(); // _times used to be argument "k";
-	float P = 0.9;
-	float T, actual_T = 1;
+void SA_FLOORPLANING::start_SA_Floorplaning()
+{
+	_N = _times * _fp_p->size(); // _times used to be argument "k";
+	_P = 0.9;
+	_actual_T = 1;
 	double avg = _init_avg;
-	float conv_rate = 1;
+	_conv_rate = 1;
 
-	double estimate_avg = 0.08 / _avg_ratio;
-	cout << "Estimate Average Delta Cost = " << estimate_avg << endl;
+	_estimate_avg = 0.08 / _avg_ratio;
+	FILE *out = _fp_p->log();
+	fprintf(out, "Estimate Average Delta Cost = %g\n", _estimate_avg);
 
 	if ( _local == 0) {
-		avg = estimate_avg;
+		avg = _estimate_avg;
 	}
 	
-	T = avg / log(P);  
+	_T = avg / log(_P);  
   
 	// get inital solution
 	_fp_p->packing();
 	_fp_p->keep_sol();	
 	_fp_p->keep_best();
-	pre_cost = best = _fp_p->getCost();
+	_pre_cost = _best = _fp_p->getCost();
+	_best_fits = _fp_p->fits_outline();
+	_best_width = _fp_p->Width;
+	_best_height = _fp_p->Height;
   
-	int good_num=0,bad_num=0;
-	double total_cost=0;
-	int count=0;
-	ofstream of("/tmp/btree_debug");
-
-	do {
-		count++;
-		total_cost = 0;
-		MT=uphill=reject=0;
-		if ( _verbose) {
-			printf("Iteration %d, T= %.2f\n", count, actual_T);
-		}
-		vector<double> chain; 
+	_good_num = _bad_num = 0;
+	_count = 0;
+	_of.open(_debug_file);
+	_local_stage = _local;
+	_window = max( _N / SA_EQUILIBRIUM_WINDOWS, 1);
+	_total_moves = 0;
+	_start_time = wall_seconds();
+}
+
+bool SA_FLOORPLANING::anneal_temperature()
+{
+	int MT, uphill, reject;
+	double cost;
+	float d_cost;
+	FILE *out = _fp_p->log();
+
+	_count++;
+	MT=uphill=reject=0;
+	if ( _verbose) {
+		fprintf(out, "Iteration %d, T= %.2f\n", _count, _actual_T);
+	}
+	vector<double> chain; 
+	bool improved = false;
+	double window_cost = 0, last_window_mean = -1;
  
-		for (; uphill < N && MT < 2*N; MT++) {
-			_fp_p->perturb();
-			_fp_p->packing();
-			cost = _fp_p->getCost(); 
-			d_cost = cost - pre_cost;
-			float p = exp(d_cost/T);
+	while ( uphill < _N && MT < 2*_N) {
+		_fp_p->perturb();
+		_fp_p->packing();
+		cost = _fp_p->getCost(); 
+		d_cost = cost - _pre_cost;
+		float p = exp(d_cost/_T);
 	   
 
-			chain.push_back(cost);
-
-			if ( d_cost <=0 || rand_01() < p ) {
-				_fp_p->keep_sol();
-				pre_cost = cost;
-
-				if ( d_cost > 0){		  
-					uphill++, bad_num++;
-					of << d_cost << ": " << p << endl;
-				} else if(d_cost < 0)  good_num++;
-
-				// keep best solution
-				if ( cost < best){
-					_fp_p->keep_best();
-					best = cost;
-					if ( _verbose) {
-						printf("   ==>	Cost= %f, Area= %.6f, ", best, _fp_p->getArea()*1e-6);
-						printf("Wire= %.3f\n", _fp_p->getWireLength()*1e-3);
-					}
-					assert(_fp_p->getArea() >= _fp_p->getTotalArea());
+		chain.push_back(cost);
+
+		if ( d_cost <=0 || _fp_p->rand_01() < p ) {
+			_fp_p->keep_sol();
+			_pre_cost = cost;
+
+			if ( d_cost > 0){		  
+				uphill++, _bad_num++;
+				_of << d_cost << ": " << p << endl;
+			} else if(d_cost < 0)  _good_num++;
+
+			// keep best solution
+			if ( better_than_best( cost, _fp_p->fits_outline(), _best, _best_fits)){
+				_fp_p->keep_best();
+				_best = cost;
+				_best_fits = _fp_p->fits_outline();
+				_best_width = _fp_p->Width;
+				_best_height = _fp_p->Height;
+				improved = true;
+				if ( _verbose) {
+					fprintf(out, "   ==>	Cost= %f, Area= %.6f, ", _best, _fp_p->getArea()*1e-6);
+					fprintf(out, "Wire= %.3f\n", _fp_p->getWireLength()*1e-3);
 				}
+				assert(_fp_p->getArea() >= _fp_p->getTotalArea());
 			}
-			else {
-				reject++;
-				_fp_p->recover();
+		}
+		else {
+			reject++;
+			_fp_p->recover();
+		}
+		MT++;
+
+		if ( _equilibrium) {
+			window_cost += _pre_cost;
+			if ( MT % _window == 0) {
+				double window_mean = window_cost / _window;
+				window_cost = 0;
+				if ( MT >= SA_MIN_MOVES_RATIO * _N && last_window_mean >= 0 &&
+					fabs( window_mean - last_window_mean) <= SA_EQUILIBRIUM_TOL * last_window_mean) {
+					break;
+				}
+				last_window_mean = window_mean;
+			}
+		}
+	}
+	_total_moves += MT;
+	//	 cout << T << endl;
+	double sv = std_var(chain);
+	float r_t = exp( _lambda * _T / sv);
+	_T = r_t*_T;
+
+
+	if ( _equilibrium && _count > 1 && _count < _local_stage && !improved) {
+		_local_stage = _count;
+	}
+	// After apply local-search, start to use normal SA
+	if ( _count == _local_stage){
+		_T = _estimate_avg/ log(_P);
+		_T *= pow(0.9, _local);		// smothing the annealing schedule
+		_actual_T = exp(_estimate_avg/_T);
+	}
+	if ( _count > _local_stage){
+		_actual_T = exp(_estimate_avg/_T);
+		_conv_rate = 0.95;
+	}
+
+	_reject_rate = float(reject)/MT;
+	if ( _verbose) {
+		fprintf(out, "  T= %.2f, r= %.2f, reject= %.2f, moves= %d, best Cost= %f\n\n",
+			_actual_T, r_t, _reject_rate, MT, _best);
+	}
+		
+	return ( _reject_rate < _conv_rate && _actual_T > _term_temp);
+}
+
+void SA_FLOORPLANING::finish_SA_Floorplaning()
+{
+	FILE *out = _fp_p->log();
+	if (_reject_rate >= _conv_rate)
+		fprintf(out, "\n	 Convergent!\n");
+	else if (_actual_T <= _term_temp)
+		fprintf(out, "\n Cooling Enough!\n");
+
+	fprintf(out, "\n good = %d, bad=%d\n", _good_num, _bad_num);
+	double run_time = wall_seconds() - _start_time;
+	fprintf(out, " temperatures = %d, moves = %ld, %.0f moves/sec\n\n",
+		_count, _total_moves, _total_moves / fmax( run_time, 1e-6));
+	_of.close();
+
+	_fp_p->recover_best();
+	_fp_p->packing();
+
+}
+
+// parallel tempering: between two rounds of exchanges every replica makes
+// PT_MOVES_PER_SWAP moves per module; there are PT_SWAPS_PER_TIMES rounds
+// per unit of _times, which makes every replica do about as many moves
+// as run_SA_Floorplaning() does; the hottest replica accepts an average
+// uphill move with probability PT_HOT_ACCEPT and the coldest one with
+// PT_COLD_ACCEPT (tuned on ami33 and ami49);
+#define PT_MOVES_PER_SWAP 2
+#define PT_SWAPS_PER_TIMES 30
+#define PT_HOT_ACCEPT 0.5
+#define PT_COLD_ACCEPT 0.05
+
+void SA_FLOORPLANING::run_floorplaning()
+{
+	if ( _replicas_count > 1) {
+		run_PT_Floorplaning();
+	} else {
+		run_SA_Floorplaning();
+	}
+}
+
+int SA_FLOORPLANING::metropolis_moves( FPlan *fp, double T, int moves,
+	double &cost, double &best, bool &best_fits)
+{
+	int accepted = 0;
+	for ( int m = 0; m < moves; m++) {
+		fp->perturb();
+		fp->packing();
+		double new_cost = fp->getCost();
+		double d_cost = new_cost - cost;
+		if ( d_cost <= 0 || fp->rand_01() < exp( -d_cost / T)) {
+			fp->keep_sol();
+			cost = new_cost;
+			accepted ++;
+			// keep best solution
+			if ( better_than_best( cost, fp->fits_outline(), best, best_fits)) {
+				fp->keep_best();
+				best = cost;
+				best_fits = fp->fits_outline();
 			}
+		} else {
+			fp->recover();
 		}
-		//	 cout << T << endl;
-		double sv = std_var(chain);
-		float r_t = exp( _lambda * T / sv);
-		T = r_t*T;
+	}
+	return accepted;
+}
+
+void SA_FLOORPLANING::run_PT_Floorplaning()
+{
+	int K = _replicas_count;
+	int moves = PT_MOVES_PER_SWAP * _fp_p->size();
+	int rounds = PT_SWAPS_PER_TIMES * _times;
+	FILE *out = _fp_p->log();
 
+	// (1) temperatures ladder; as in run_SA_Floorplaning(), an uphill move
+	// costs estimate_avg on average; temperatures between the hottest and
+	// the coldest one are spaced geometrically;
+	double estimate_avg = 0.08 / _avg_ratio;
+	double T_hot = -estimate_avg / log( PT_HOT_ACCEPT);
+	double T_cold = -estimate_avg / log( PT_COLD_ACCEPT);
+	vector<double> T( K);
+	for ( int t = 0; t < K; t++) {
+		T[t] = T_cold * pow( T_hot / T_cold, double(t) / (K - 1));
+	}
+	fprintf(out, "Parallel tempering: %d replicas, T= %g ... %g\n", K, T_cold, T_hot);
 
-		// After apply local-search, start to use normal SA
-		if ( count == _local){
-			T = estimate_avg/ log(P);
-			T *= pow(0.9, _local);		// smothing the annealing schedule
-			actual_T = exp(estimate_avg/T);
+	// (2) replicas; _fp_p is one of them; the others draw their random
+	// numbers streams from the one of _fp_p;
+	_fp_p->packing();
+	_fp_p->keep_sol();
+	_fp_p->keep_best();
+	vector<FPlan *> replicas( K);
+	vector<double> cost( K), best( K);
+	vector<char> best_fits( K);
+	replicas[0] = _fp_p;
+	for ( int r = 1; r < K; r++) {
+		replicas[r] = _fp_p->clone();
+		replicas[r]->set_rand_seed( _fp_p->rand_int());
+	}
+	for ( int r = 0; r < K; r++) {
+		cost[r] = best[r] = replicas[r]->getCost();
+		best_fits[r] = replicas[r]->fits_outline();
+	}
+	// replica annealed at temperature T[t]; exchanges swap these entries
+	// instead of copying solutions;
+	vector<int> at_temperature( K);
+	for ( int t = 0; t < K; t++) {
+		at_temperature[t] = t;
+	}
+	vector<long> accepted( K, 0);
+	vector<long> exchanges( K, 0);
+
+	// (3) rounds of concurrent annealing, each followed by exchanges;
+	function<void(int)> anneal = [&]( int t) {
+		int r = at_temperature[t];
+		bool fits = best_fits[r];
+		accepted[t] += metropolis_moves( replicas[r], T[t], moves, cost[r], best[r], fits);
+		best_fits[r] = fits;
+	};
+	double start_time = wall_seconds();
+	for ( int round = 0; round < rounds; round++) {
+		if ( _thread_pool) {
+			_thread_pool->run( K, anneal);
+		} else {
+			for ( int t = 0; t < K; t++) anneal( t);
 		}
-		if ( count > _local){
-			actual_T = exp(estimate_avg/T);
-			conv_rate = 0.95;
+
+		// neighbors t and t+1 exchange their solutions with probability
+		// min( 1, exp( (1/T[t] - 1/T[t+1]) * (cost(t) - cost(t+1)))); even
+		// pairs try on even rounds and odd pairs on odd rounds;
+		for ( int t = round % 2; t + 1 < K; t += 2) {
+			int r1 = at_temperature[t];
+			int r2 = at_temperature[t+1];
+			double delta = ( 1/T[t] - 1/T[t+1]) * ( cost[r1] - cost[r2]);
+			if ( delta >= 0 || _fp_p->rand_01() < exp( delta)) {
+				at_temperature[t] = r2;
+				at_temperature[t+1] = r1;
+				exchanges[t] ++;
+			}
 		}
 
-		reject_rate = float(reject)/MT;
-		if ( _verbose) {
-			printf("  T= %.2f, r= %.2f, reject= %.2f\n\n", actual_T, r_t, reject_rate);
+		if ( _verbose && ( round + 1) % ( 10 * PT_SWAPS_PER_TIMES) == 0) {
+			double best_cost = best[0];
+			for ( int r = 1; r < K; r++) {
+				best_cost = fmin( best_cost, best[r]);
+			}
+			fprintf(out, "Round %d, best Cost= %f, cold Cost= %f\n", round + 1,
+				best_cost, cost[ at_temperature[0]]);
 		}
-		
-	} while (reject_rate < conv_rate && actual_T > _term_temp);
+	}
 
-	if (reject_rate >= conv_rate)
-		cout << "\n	 Convergent!\n";
-	else if (actual_T <= _term_temp)
-		cout << "\n Cooling Enough!\n";
+	if ( _verbose) {
+		for ( int t = 0; t < K; t++) {
+			fprintf(out, "  T= %g, accept= %.2f", T[t],
+				double(accepted[t]) / ( double(rounds) * moves));
+			if ( t + 1 < K) {
+				fprintf(out, ", exchanges with next= %.2f",
+					double(exchanges[t]) / ( double(rounds) / 2));
+			}
+			fprintf(out, "\n");
+		}
+	}
 
-	printf("\n good = %d, bad=%d\n\n", good_num, bad_num);
+	// (4) the best solution of all replicas becomes the one of _fp_p;
+	int best_r = 0;
+	for ( int r = 1; r < K; r++) {
+		if ( better_than_best( best[r], best_fits[r], best[best_r], best_fits[best_r])) {
+			best_r = r;
+		}
+	}
+	if ( best_r != 0) {
+		_fp_p->take_best( replicas[best_r]);
+	}
+	double run_time = wall_seconds() - start_time;
+	long total_moves = long(K) * rounds * moves;
+	fprintf(out, "\n best Cost= %f (replica %d)\n", best[best_r], best_r);
+	fprintf(out, " moves = %ld, %.0f moves/sec\n\n",
+		total_moves, total_moves / fmax( run_time, 1e-6));
+	for ( int r = 1; r < K; r++) {
+		delete replicas[r];
+	}
 
 	_fp_p->recover_best();
 	_fp_p->packing();
+}
+
+void SA_FLOORPLANING::set_stack_outline( float weight, double width, double height)
+{
+	// the current and the best solutions are costed again with the new
+	// outline, so that the annealing goes on comparing like with like;
+	_best -= _fp_p->getStackPenalty( _best_width, _best_height);
+	_fp_p->set_stack_outline( weight, width, height);
+	_best += _fp_p->getStackPenalty( _best_width, _best_height);
+	_pre_cost = _fp_p->getCost();
+	if ( _verbose) {
+		fprintf(_fp_p->log(), "Stack outline= %.0f x %.0f, Cost= %f\n",
+			width, height, _pre_cost);
+	}
+}
 
+void SA_FLOORPLANING::run_co_annealing( const vector<SA_FLOORPLANING *> &layers,
+	float weight, THREAD_POOL *thread_pool)
+{
+	// every layer is annealed by run_SA_Floorplaning(), one temperature
+	// at a time; all the layers anneal their next temperature
+	// concurrently; then, every layer still annealing gets the outline
+	// of the others, the largest width and height of their current
+	// solutions (of their best ones once they are done); the outlines
+	// are exchanged only between temperatures, in layer order, so that
+	// the results do not depend on the number of threads;
+	int L = layers.size();
+	vector<char> annealing( L, 1);
+	int annealing_count = L;
+	function<void(int)> start = [&]( int l) {
+		layers[l]->start_SA_Floorplaning();
+	};
+	function<void(int)> anneal = [&]( int l) {
+		if ( !annealing[l]) {
+			return;
+		}
+		FPlan *fp = layers[l]->_fp_p;
+		if ( layers[l]->anneal_temperature()) {
+			// a rejected last move left the outline of that move;
+			fp->packing();
+			fp->keep_sol();
+		} else {
+			layers[l]->finish_SA_Floorplaning();
+			annealing[l] = 0;
+		}
+	};
+	if ( thread_pool) {
+		thread_pool->run( L, start);
+	} else {
+		for ( int l = 0; l < L; l++) start( l);
+	}
+	while ( annealing_count > 0) {
+		for ( int l = 0; l < L; l++) {
+			if ( !annealing[l]) {
+				continue;
+			}
+			double width = 0, height = 0;
+			for ( int m = 0; m < L; m++) {
+				if ( m != l) {
+					width = fmax( width, layers[m]->_fp_p->Width);
+					height = fmax( height, layers[m]->_fp_p->Height);
+				}
+			}
+			layers[l]->set_stack_outline( weight, width, height);
+		}
+		if ( thread_pool) {
+			thread_pool->run( L, anneal);
+		} else {
+			for ( int l = 0; l < L; l++) anneal( l);
+		}
+		annealing_count = 0;
+		for ( int l = 0; l < L; l++) {
+			annealing_count += annealing[l];
+		}
+	}
 }
 
 // not used, and still using "FPlan &fp" instead of a pointer;
@@ -157,7 +473,7 @@ double SA_FLOORPLANING::std_var(vector<double> &chain)
 	}
 	var = sqrt(sum/(N-1));
 	if ( _verbose) {
-		printf("  m=%.4f ,v=%.4f\n",m,var);
+		fprintf(_fp_p->log(), "  m=%.4f ,v=%.4f\n",m,var);
 	}
 	return var;
 }
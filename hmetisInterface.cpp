@@ -1,8 +1,11 @@
+#include "config.h"
 #include <iostream>
+#include <cstring>
 #include "malloc.h"
 #include "stdlib.h"
 
 #include "hmetisInterface.h"
+#include "sfra_partition.h"
 
 // am schimbat interfata clasica cu asta mai recenta de la Wonjoon;
 // void  HMETIS_PartRecursive(int, int, float*, int*, int*, float*,
@@ -122,6 +125,7 @@ MetisIntfc::MetisIntfc( int num_modules, int num_nets)
 {
 	// Initialize hmetis related variables
 	ubfactor_ = 0;
+	thread_pool_ = 0;
 	nparts_ = 0;
 	options_.resize(9);   
 	SetDefaults();
@@ -303,6 +307,7 @@ int MetisIntfc::SetUBFactor( const char* optionName, float optionValue)
 		}
 		ubfactor_ = optionValue;
 	}
+	return 1;
 }
 
 int MetisIntfc::SetOption(const char* optionName, int optionValue)
@@ -589,6 +594,29 @@ int MetisIntfc::Partition(int numPartitions)
 	}
 
 	nparts_ = numPartitions;
+#ifndef USE_HMETIS
+	// same problem, solved by the multilevel partitioner of sfra; Nruns
+	// runs, each with a V-cycle if Vcycle is not 0;
+	MULTILEVEL_PARTITIONER partitioner;
+	partitioner.initialize( nvtxs_, nparts_);
+	for (int i=0; i<nvtxs_; i++) {
+		partitioner.set_vertex_weight( i, vwgts_[i]);
+		if (options_[6] == 1 && part_[i] >= 0) {
+			partitioner.set_fixed( i, part_[i]);
+		}
+	}
+	for (int ii=0; ii<nhedges_; ii++) {
+		partitioner.add_net( eptr_[ii+1] - eptr_[ii], &eind_[ eptr_[ii]], hewgts_[ii]);
+	}
+	partitioner.set_ubfactor( ubfactor_);
+	partitioner.set_runs( options_[1]);
+	partitioner.set_vcycles( options_[4] > 0 ? 1 : 0);
+	edgecut_ = partitioner.run( (options_[7] < 0) ? 1 : options_[7], thread_pool_);
+	for (int i=0; i<nvtxs_; i++) {
+		part_[i] = partitioner.part_of( i);
+	}
+	return 1;
+#else
 	//int *vwgts_array = CreateIntArray(vwgts_);
 	float *vwgts_array = CreateFloatArray(vwgts_);
 	int *eptr_array = CreateIntArray(eptr_);
@@ -626,6 +654,7 @@ int MetisIntfc::Partition(int numPartitions)
 	DeleteIntArray(part_array);
 
 	return 1;
+#endif
 }
 
 int MetisIntfc::EvaluateBipartitionBasedCuts(void)
@@ -4,6 +4,11 @@
 // this should be commented out if the code is to be compiled on windowz;
 #define BUILD_WITH_GUI
 
+// the 3D partitioning is done by the built-in multilevel partitioner
+// (sfra_partition.cpp); define this to use the prebuilt hMetis library
+// instead, which must then be linked too (see HMETIS_LIB in Makefile);
+//#define USE_HMETIS
+
 // both btree and vnoc code-bases (these two come from two different
 // code implementations) have now length unit in um
 #define BTREE_TO_VNOC_SCALE_MULTIPLIER 1
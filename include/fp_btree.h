@@ -60,6 +60,10 @@ class B_Tree : public FPlan
 	virtual void keep_best();	 
 	virtual void recover();
 	virtual void recover_best();
+	virtual FPlan *clone() const { return new B_Tree( *this); }
+	virtual void take_best( FPlan *fp) {
+		best_sol = static_cast<B_Tree *>( fp)->best_sol;
+	}
 	// debuging
 	void testing();
 
@@ -75,7 +79,12 @@ class B_Tree : public FPlan
 	void wire_nodes(int parent,int child,DIR edge);
 	int child(int node,DIR d);
 	bool legal_tree(int p,int n,int &num);
-	void add_changed_nodes(int n);
+	// record that node n is about to change; its old value is journaled
+	// for recover();
+	void node_changed(int n) {
+		if (n == NIL) return;
+		_nodes_journal.push_back(nodes[n]);
+	}
   
 	// SA permutating operation
 	void swap_node(Node &n1, Node &n2);
@@ -91,24 +100,26 @@ class B_Tree : public FPlan
 	int nodes_root;
 	vector<Node> nodes;	  
 
+	vector<int> _dfs_stack; // of packing(), kept to reuse its memory;
+
+	// old values of the nodes changed since the last keep_sol(), in the
+	// order they were changed; recover() plays them back in reverse
+	// instead of copying the whole tree;
+	vector<Node> _nodes_journal;
+	int _nodes_root_kept;
+
  
  private:		 
 	struct Solution{
 		int nodes_root;
 		vector<Node> nodes;
-		double cost;
-		Solution() { cost = 1; }
-		void clear() { cost = 1, nodes.clear(); }
+		void clear() { nodes.clear(); }
 	};
   
 	void get_solution(Solution &sol);
 	void recover(Solution &sol);
-	void recover_partial();
 
-	Solution best_sol, last_sol;
-	// for partial recover
-	vector<Node> changed_nodes;
-	int changed_root;	 
+	Solution best_sol;
 };
 
 #endif
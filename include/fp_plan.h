@@ -8,6 +8,8 @@
 #include <fstream>
 #include <map>
 #include <cstdio>
+#include <cstdlib>
+#include <cmath>
 
 using namespace std;
 
@@ -19,13 +21,9 @@ struct Pin{
 	int mod;
 	int net;
 	int x,y;	// relative position
-	int ax,ay;	// absolute position
 	Pin(int x_=-1,int y_=-1){ x=x_,y=y_; }
 };
 typedef vector<Pin> Pins;
-typedef Pin* Pin_p;
-typedef vector<Pin_p> Net;
-typedef vector<Net > Nets;
 
 enum Module_Type { MT_Hard, MT_Soft, MT_Reclinear, MT_Buffer };
 
@@ -48,23 +46,40 @@ struct Module_Info{
 
 typedef vector<Module_Info> Modules_Info;
 
+// communication between two cores, as seen by the NoC-aware cost;
+struct Noc_Flow{
+	int src, des;
+	double volume;
+};
+
+class FPlan;
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// FPlan
+// NETLIST
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-class FPlan {
- protected:
-	double Area;
-	int WireLength;
-	double TotalArea;
-	
+// the modules and nets of a testcase as read from its .fp file (or as
+// carved out of a top-level netlist for the subfloorplans of 3D); it is
+// parsed only once and then shared, read-only, by all the floorplans
+// annealed for that testcase; a floorplan keeps only its own placement
+// state (modules_info, the tree, etc.) so that it is cheap to create and
+// to copy;
+//
+// nets are index based: the pins of net i are stored contiguously in
+// nets_pins[ nets_start[i] ... nets_start[i+1]-1], as copies of the pins
+// of the modules; pin.mod is the index of the module in modules; pins of
+// the root module have mod outside [0, modules_N);
+
+class NETLIST {
+ public:
+	Modules modules;
 	Module root_module;
-	Nets network;
-	double norm_area, norm_wire;
-	float cost_alpha;
+	int modules_N;
+	double TotalArea;
+	vector<int> nets_start;
+	vector<Pin> nets_pins;
 	vector<vector<int> > _connection;
 	// sources and destinations as node indices of tasks from
 	// the task communication graph;
@@ -79,38 +94,151 @@ class FPlan {
 	map<string,int> net_table;
 	string filename;
 
+ public:
+	NETLIST();
+	~NETLIST() {}
+
+	void read( char *file, float scale, SFRA *sfra);
+	// function used for inflating IP cores for 2D situations;
+	void inflate_core( int id, int routers);
+	// functions related to creating sub-floorplans from 
+	// a top level floorplan;
+	void create_subfloorplan( int sub_floorplan_id, const NETLIST *netlist_p,
+		vector<int> &partition);
+	void create_subfloorplan_on_layer( int sub_floorplan_id,
+		const NETLIST *netlist_toplevel, FPlan *fp_p1, vector<int> &partition);
+
+	int nets_count() const { return int(nets_start.size()) - 1; }
+	int net_pins_count( int i) const { return nets_start[i+1] - nets_start[i]; }
+	const Pin &net_pin( int i, int j) const { return nets_pins[ nets_start[i] + j]; }
+
+ private:
+	void read_dimension( ifstream &fs, Module&,float);
+	void read_IO_list( ifstream &fs, Module&,bool parent);
+	void read_network( ifstream &fs);
+	void create_network( SFRA *sfra);
+	void create_nets();
+	void print_connections_between_modules(); // debug;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// FPlan
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class FPlan {
+ protected:
+	double Area;
+	int WireLength;
+	double TotalArea;
+	
+	// shared, read-only; _own_netlist is set only for subfloorplans, which
+	// create their own netlist, and is deleted with this floorplan; copies
+	// of a floorplan share its netlist but never own it;
+	const NETLIST *_netlist;
+	NETLIST *_own_netlist;
+	double norm_area, norm_wire;
+	float cost_alpha;
+
+	// every floorplan has its own stream of random numbers and prints
+	// into its own log (stdout by default), so that several floorplans
+	// can be annealed at the same time;
+	unsigned int _rand_state;
+	FILE *_log;
+
+	// side of the fixed square outline; the area of the floorplan outside
+	// it is penalized by getCost(); 0 if there is no outline;
+	double _outline;
+	// outline of the other layers of a 3D stack co-annealed with this
+	// floorplan, i.e., their largest width and height; the area of the
+	// floorplan outside it is penalized by getCost() with _stack_weight,
+	// 0 if the floorplan is not co-annealed;
+	float _stack_weight;
+	double _stack_width, _stack_height;
+
+	// NoC-aware cost: after every packing, every core is hooked up, in
+	// _noc_order, to the free router of the _noc_ary x _noc_ary mesh
+	// (spread over the smaller side of the floorplan, as for simulation)
+	// nearest to one of its corners; _noc_link is the total length of
+	// these extra-links and _noc_hops the communication weighted hop
+	// distance between the routers of all flows; _noc_weight is 0 if
+	// this cost is not used;
+	float _noc_weight;
+	int _noc_ary;
+	vector<Noc_Flow> _noc_flows;
+	vector<int> _noc_order;
+	vector<int> _noc_router; // router of every core, x + y * _noc_ary;
+	vector<double> _noc_link_of; // extra-link length of every core;
+	bool _noc_valid; // false until the first estimate;
+	vector<char> _noc_router_used;
+	vector<double> _noc_dx, _noc_dy; // distances of the core to columns/rows;
+	vector<int> _noc_cols, _noc_rows; // columns/rows, nearest first;
+	double _noc_link, _noc_hops;
+	double norm_noc_link, norm_noc_hops;
+
  public:
 	SFRA *_sfra;
 	// these should not be public; should encapsulate them;
 	int modules_N;	  
 	Modules_Info modules_info;
-	Modules modules;
 	double Width,Height;
 
 
  public:
 	FPlan(float calpha);
-	~FPlan();
+	FPlan(const FPlan &fp);
+	virtual ~FPlan();
 
 	SFRA *sfra() { return _sfra; }
 	void set_sfra_host(SFRA *sfra) { _sfra = sfra; }
-	// function used for inflating IP cores for 2D situations;
-	void inflate_core( int id, int routers);
+	// attach this floorplan to an already read netlist; replaces read();
+	void set_netlist( const NETLIST *netlist);
+	const NETLIST *netlist() const { return _netlist; }
+	void set_alpha( float calpha) { cost_alpha = calpha; }
+	void set_rand_seed( unsigned int seed) { _rand_state = seed; }
+	int rand_int() { return rand_r( &_rand_state); }
+	bool rand_bool() { return bool(rand_int()%2); }
+	float rand_01() { return float(rand_int()%10000)/10000; }
+	FILE *log() { return _log; }
+	void set_log( FILE *log) { _log = log; }
+	// fixed outline: a square with whitespace more area than the cores;
+	// a floorplan inside it has an aspect ratio under 1 + whitespace;
+	// whitespace 0 removes the outline;
+	void set_outline( float whitespace) {
+		_outline = ( whitespace > 0) ? sqrt( ( 1 + whitespace) * TotalArea) : 0;
+	}
+	double outline() const { return _outline; }
+	bool fits_outline() const {
+		return ( _outline == 0 || ( Width <= _outline && Height <= _outline));
+	}
+	// outline of the other layers of a 3D stack; weight 0 removes it;
+	void set_stack_outline( float weight, double width, double height) {
+		_stack_weight = weight;
+		_stack_width = width;
+		_stack_height = height;
+	}
+	// the term of getCost() for a floorplan width x height;
+	double getStackPenalty( double width, double height);
+	// adds weight x the NoC estimate, for an ary x ary mesh, to getCost();
+	// weight 0 removes it; has to be called after set_netlist();
+	void set_noc_cost( float weight, int ary);
+	double noc_link() const { return _noc_link; }
+	double noc_hops() const { return _noc_hops; }
 	int get_connection( int i, int j) {
 		assert( i >= 0 && i < modules_N);
 		assert( j >= 0 && j < modules_N);
-		return _connection[i][j];
+		return _netlist->_connection[i][j];
 	}
 	int get_module_area( int i) {
 		assert( i >= 0 && i < modules_N);
-		return modules[i].area;
+		return _netlist->modules[i].area;
 	}
 	int communications_volume( int i) {
-		assert( i >= 0 && i < _communications_volume.size());
-		return _communications_volume[i];
+		assert( i >= 0 && i < _netlist->_communications_volume.size());
+		return _netlist->_communications_volume[i];
 	}
 	
-	void read(char*,float);
 	virtual void init()		=0;
 	virtual void packing();
 	virtual void perturb()	=0;	   
@@ -118,14 +246,19 @@ class FPlan {
 	virtual void keep_best()	=0;
 	virtual void recover()	=0;
 	virtual void recover_best() =0;
+	// replicas of a floorplan annealed at other temperatures, sharing
+	// its netlist; take_best() makes the best solution of fp, one of
+	// these replicas, the best one of this floorplan;
+	virtual FPlan *clone() const =0;
+	virtual void take_best( FPlan *fp) =0;
 	virtual double getCost();
 
 	// functions related to creating sub-floorplans from 
 	// a top level floorplan;
 	void create_subfloorplan( int sub_floorplan_id, FPlan *fp_p,
 		vector<int> partition);
-	void create_subfloorplan_layer2( FPlan *fp_toplevel, FPlan *fp_p1,
-		vector<int> partition);
+	void create_subfloorplan_on_layer( int sub_floorplan_id,
+		FPlan *fp_toplevel, FPlan *fp_p1, vector<int> partition);
 
 	void get_module_center_coordinates( 
 		int mod_i, int &pin_ax, int &pin_ay);
@@ -137,6 +270,7 @@ class FPlan {
 	double getWidth()	  { return Width;	  }
 	double getHeight()	  { return Height;	  }
 	float  getDeadSpace();
+	double getOutlineViolation();
 
 	// information
 	void list_information();
@@ -144,22 +278,18 @@ class FPlan {
 	void normalize_cost(int);
 	
  private:
-	void read_dimension(Module&,float);
-	void read_IO_list(Module&,bool parent);
-	void read_network();
-	void create_network();	 
-	void print_connections_between_modules(); // debug;
+	FPlan &operator=(const FPlan &); // not implemented;
 
  protected:
 	void clear();
 	double calcWireLength( bool include_root_module = false);
-	void scaleIOPad();
+	// NoC estimate of the current placement; called by packing();
+	void update_noc_estimate();
+	static void sort_noc_lines( const vector<double> &dist, vector<int> &lines);
 };
 
 
 void error(char *msg,char *msg2="");
-bool rand_bool();
-float rand_01();
 	  
 // this class is used only for testcase creation; basically
 // for generating all the trace files that contain packets to
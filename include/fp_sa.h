@@ -2,7 +2,9 @@
 #define sa_btreeH
 
 #include <config.h>
+#include <cstring>
 #include "fp_plan.h"
+#include "sfra_threads.h"
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -26,6 +28,28 @@ class SA_FLOORPLANING {
 	// next two are always with default values; not really changed currently by user;
 	int _hill_climb_stage;
 	float _init_avg;
+	// every uphill move is dumped here; attempts annealed at the same
+	// time need different files;
+	char _debug_file[256];
+	// if more than 1, run_floorplaning() uses parallel tempering with this
+	// many replicas, annealed concurrently on _thread_pool;
+	int _replicas_count;
+	THREAD_POOL *_thread_pool;
+	// if true, the moves per temperature and the local search stage are
+	// cut short once the annealing reaches equilibrium or stops improving;
+	bool _equilibrium;
+	// state of run_SA_Floorplaning() between temperatures;
+	int _N;
+	float _P, _T, _actual_T, _conv_rate, _reject_rate;
+	double _estimate_avg;
+	double _pre_cost, _best;
+	bool _best_fits;
+	double _best_width, _best_height;
+	int _good_num, _bad_num;
+	int _count, _local_stage, _window;
+	long _total_moves;
+	double _start_time;
+	ofstream _of;
 
  public:
 	FPlan *_fp_p;
@@ -45,6 +69,10 @@ class SA_FLOORPLANING {
 		_hill_climb_stage = 7;
 		_init_avg = 0.00001;
 		_verbose = true;
+		strcpy( _debug_file, "/tmp/btree_debug");
+		_replicas_count = 1;
+		_thread_pool = 0;
+		_equilibrium = false;
 	}
 	SA_FLOORPLANING( FPlan *fp_p, int times, int local, float term_temp) {
 		_fp_p = fp_p;
@@ -59,6 +87,10 @@ class SA_FLOORPLANING {
 		_hill_climb_stage = 7;
 		_init_avg = 0.00001;
 		_verbose = true;
+		strcpy( _debug_file, "/tmp/btree_debug");
+		_replicas_count = 1;
+		_thread_pool = 0;
+		_equilibrium = false;
 	}
 	~SA_FLOORPLANING() {}
 
@@ -71,11 +103,48 @@ class SA_FLOORPLANING {
 	void set_lambda(float val) { _lambda = val; }
 	void set_alpha(float val) { _alpha = val; }
 	void set_fp_scale(float val) { _fp_scale = val; }
+	void set_debug_file(const char *name) { strcpy( _debug_file, name); }
+	void set_equilibrium(bool v) { _equilibrium = v; }
+	void set_replicas(int count, THREAD_POOL *thread_pool) {
+		_replicas_count = count;
+		_thread_pool = thread_pool;
+	}
 
+	// runs run_PT_Floorplaning() if replicas were set, else
+	// run_SA_Floorplaning();
+	void run_floorplaning();
 	void run_SA_Floorplaning();
+	// run_SA_Floorplaning() one temperature at a time: start, then
+	// anneal_temperature() until it returns false, then finish;
+	void start_SA_Floorplaning();
+	bool anneal_temperature();
+	void finish_SA_Floorplaning();
+	// in between temperatures, the outline of the other layers of a 3D
+	// stack (see FPlan::set_stack_outline()); the floorplan must hold
+	// its current solution, packed;
+	void set_stack_outline( float weight, double width, double height);
+	// co-annealing of the layers of a 3D stack: each one is annealed by
+	// run_SA_Floorplaning(), all of them concurrently on thread_pool, one
+	// temperature at a time; between temperatures every layer gets the
+	// outline of the others, weighted by weight in its cost;
+	static void run_co_annealing( const vector<SA_FLOORPLANING *> &layers,
+		float weight, THREAD_POOL *thread_pool);
+	// parallel tempering (replica exchange): _replicas_count copies of
+	// the floorplan, each annealed at its own fixed temperature, which
+	// periodically try to exchange their solutions with their neighbors
+	// on the temperatures ladder;
+	void run_PT_Floorplaning();
 	// some utils functions;
 	double mean( vector<double> &chain);
 	double std_var(vector<double> &chain);
+
+ private:
+	// "moves" Metropolis moves of fp at temperature T; cost is the cost
+	// of the current solution of fp and best the cost of its best one,
+	// which fits the outline if best_fits; returns the number of accepted
+	// moves;
+	int metropolis_moves( FPlan *fp, double T, int moves,
+		double &cost, double &best, bool &best_fits);
 };
 
 #endif
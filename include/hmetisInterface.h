@@ -63,6 +63,8 @@ extern "C"
 
 typedef std::map<int,int> IntMapType;
 
+class THREAD_POOL;
+
 class MetisIntfc
 {
  private:
@@ -111,6 +113,8 @@ class MetisIntfc
 	// int ubfactor_; // old;
 	float ubfactor_; // new;
 	vector<int> options_; // size of 9
+	// runs of the built-in partitioner are done on it, if set;
+	THREAD_POOL *thread_pool_;
 
 	// --- data used to set-up the hyper-graph;
 	int net_counter;
@@ -154,7 +158,10 @@ class MetisIntfc
 	void setModWeight(int modIdNumber, float weight); // new;
 	// void setNetWeight(int netIdNumber, int weight); // old;
 	void setNetWeight(int netIdNumber, float weight);
-	int Partition(int numPartitions); // the real call to hMetis partitioner!
+	// the real call to hMetis partitioner! or, unless USE_HMETIS is
+	// defined, to the built-in MULTILEVEL_PARTITIONER;
+	int Partition(int numPartitions);
+	void SetThreadPool(THREAD_POOL *pool) { thread_pool_ = pool; }
 	// viewing the results
 	int getModPartition(int modIdNumber);
 	// debug;
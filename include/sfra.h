@@ -4,10 +4,18 @@
 #include "vnoc_topology.h"
 #include "fp_btree.h"
 #include <utility>
+#include <cstring>
+#include <map>
+#include <atomic>
 #include "hmetisInterface.h"
+#include "vnoc_energy.h"
+#include "sfra_threads.h"
 
 using namespace std;
 
+class RESULTS_CACHE;
+class CACHE_KEY;
+
 
 // corners of IP/cores will be "hooked up" to routers of the NoC;
 enum CORNER_NAME { SW, SE, NW, NE };
@@ -92,6 +100,7 @@ class ROUTER_ASSIGNMENT {
 	void assign(int x, int y, int id, CORNER_NAME corner, double extralink);
 	int assigned(int x, int y);
 	CORNER_NAME corner_used(int x, int y);
+	double extralink(int x, int y) { return _array_extralinks[x][y]; }
 	pair<int, int> core_id_to_router_xy(int id);
 	CORNER_NAME corner_used_by_id(int id);
 	double extralink_by_id(int id);
@@ -113,8 +122,28 @@ class RESULT {
 	double latency;
 	double packets_per_cycle;
 	int buffer_multiplier; // the buffers size (if multiplied);
+	// tail of the flit latency distribution;
+	double latency_p50;
+	double latency_p95;
+	double latency_p99;
+	double latency_max;
+	// per source-destination flow statistics and throughput (flits/cycle)
+	// of every physical port; port p of router r is at r * ports_count + p;
+	vector<FLOW_STATISTICS> flows;
+	vector<double> ports_throughput;
+	int ports_count;
+	// filled only if an energy technology file was given (see energy:);
+	// total energy (pJ), per flit delivered (pJ) and average power (mW);
+	double energy;
+	double energy_per_flit;
+	double avg_power;
  public:
-	RESULT() {}
+	RESULT() { 
+		latency_p50 = 0.0; latency_p95 = 0.0;
+		latency_p99 = 0.0; latency_max = 0.0;
+		ports_count = 0;
+		energy = 0.0; energy_per_flit = 0.0; avg_power = 0.0;
+	}
 	~RESULT() {}	
 };
 
@@ -130,6 +159,45 @@ class ONE_OF_THE_BEST_FLOOR_PLANS
 	long WireLength;
 	long modules_N;
 	vector<RESULTS> results; // we use a list as a buffer size sweep is done;
+	// average flit latency predicted by LATENCY_ESTIMATOR when the bests
+	// list is pre-screened before simulation (see n_sim:);
+	double estimated_latency;
+ public:
+	ONE_OF_THE_BEST_FLOOR_PLANS() { estimated_latency = 0.0; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// PIPELINED_SIMULATIONS
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// routers assignment and simulations of a floorplan that went into the
+// bests list while other attempts were still annealing (see pipeline);
+// what they print waits in logs, to be printed when the floorplan is
+// simulated in the sequential flow;
+
+class PIPELINED_SIMULATIONS {
+ public:
+	ROUTER_ASSIGNMENT *router_assignment;
+	ROUTERS_DISTRIBUTION *router_distribution;
+	FILE *assignment_log;
+	// one per simulation point (see SFRA::simulation_points());
+	vector<FILE *> logs;
+	vector<RESULT> results;
+	// tasks of the task graph; they are cancelled, and the simulations
+	// running see cancelled, if the floorplan is evicted from the bests
+	// list;
+	vector<int> tasks;
+	atomic<bool> cancelled;
+ public:
+	PIPELINED_SIMULATIONS() {
+		router_assignment = 0;
+		router_distribution = 0;
+		assignment_log = 0;
+		cancelled = false;
+	}
+	~PIPELINED_SIMULATIONS();
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -226,6 +294,8 @@ class APPLICATION_ARC {
 ////////////////////////////////////////////////////////////////////////////////
 
 class SFRA;
+class HUNGARIAN_ONE;
+class SA_FLOORPLANING;
 
 class APPLICATION_GRAPH {
  private:
@@ -239,8 +309,11 @@ class APPLICATION_GRAPH {
 	MetisIntfc *_hmetis_interface;
 
  public:
-	APPLICATION_GRAPH() { _nodes_count = 0; _arcs_count = 0; }
-	~APPLICATION_GRAPH() {}
+	APPLICATION_GRAPH() {
+		_nodes_count = 0; _arcs_count = 0;
+		_sfra = 0; _hmetis_interface = 0;
+	}
+	~APPLICATION_GRAPH() { if ( _hmetis_interface) delete _hmetis_interface; }
 	
 	void set_host( SFRA *sfra) { _sfra = sfra; }
 	SFRA *sfra() { return _sfra; }	
@@ -285,9 +358,9 @@ class APPLICATION_GRAPH {
 	}
 	void print_application_graph();
 	// hMetis related;
-	void init_hmetis_interface();
+	void init_hmetis_interface( int num_partitions = 2);
 	void get_hmetis_results();
-	void print_graph_partitions();
+	void print_graph_partitions( int num_partitions = 2);
 	bool run_partitioning( int num_partitions = 2); // by default do bi-partitioning;
 	int get_node_partition( int i) {
 		//assert(i >= 0 && i < _nodes_count);
@@ -299,6 +372,36 @@ class APPLICATION_GRAPH {
 	}
 };
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// TESTCASE_INPUTS
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// parsed inputs of the testcases: their netlists, read from the .fp files
+// (also with the cores inflated for 2D), and their trace files; every
+// SFRA has its own, unless it runs in a batch, whose experiments share
+// one (see batch:), so that every testcase is parsed once per process;
+// may be used concurrently;
+
+class TESTCASE_INPUTS {
+ private:
+	mutex _mutex;
+	// by testcase file, scale and testcase creation multiplier;
+	map<string, NETLIST *> _netlists;
+	map<string, NETLIST *> _netlists_2d;
+	TRACES _traces;
+
+ public:
+	TESTCASE_INPUTS() {}
+	~TESTCASE_INPUTS();
+
+	// netlist of the testcase of sfra, read at first call;
+	const NETLIST *netlist( SFRA *sfra, char *inputfile, float scale,
+		bool inflated_for_2d);
+	TRACES *traces() { return &_traces; }
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // SFRA - means simultaneous floorplaning and router assignment;
@@ -315,6 +418,25 @@ class SFRA {
 	float _lambda;
 	float _alpha;
 	float _fp_scale;
+	// if > 1, floorplans are annealed with parallel tempering instead;
+	int _replicas;
+	// if true, every annealing temperature ends once the cost reaches
+	// equilibrium;
+	bool _equilibrium;
+	// if > 0, floorplans are annealed within a fixed square outline with
+	// this much whitespace, instead of rejecting those with a bad aspect
+	// ratio;
+	float _outline_whitespace;
+	// if > 0, weight of the NoC-aware term of the annealing cost;
+	float _noc_weight;
+	// if > 0, the routers assignment is refined to also have fewer hops
+	// between cores that communicate, with this weight;
+	float _traffic_weight;
+	// in 3D, number of IP layers stacked around the NoC layer;
+	int _layers;
+	// if > 0, in 3D all the layers of an attempt are co-annealed, with
+	// this weight on matching their outlines;
+	float _coanneal_weight;
 
 	int _modules_N; // number of cores of the floorplan for a given testcase;
 	int _ary; // quantity of routers in both dimensions; total number of routers;
@@ -323,6 +445,30 @@ class SFRA {
 	char _inputfile[256];
 	int _n_fps, _n_best;
 	char _fp_criteria;
+	// if > 0, the bests list is first ranked with the analytical latency
+	// model and only the _n_sim most promising floorplans are simulated;
+	int _n_sim;
+	// annealing attempts run concurrently on this many threads; 0 means
+	// as many as the hardware threads;
+	int _threads;
+	THREAD_POOL *_thread_pool;
+	// in 2D and 2.5D, the floorplans that go into the bests list are
+	// assigned routers and simulated while the other attempts are still
+	// annealing; by attempt number;
+	bool _pipeline;
+	map<int, PIPELINED_SIMULATIONS *> _pipelined_simulations;
+	// annealed floorplans and simulation results are taken from, and
+	// stored into, this persistent cache, if given (see cache:);
+	RESULTS_CACHE *_cache;
+	// file of experiments to run as one batch (see batch:);
+	char _batch_file[256];
+	// if true, _inputs and _thread_pool (and _cache, if _shared_cache)
+	// belong to the batch that runs this experiment;
+	bool _shared;
+	bool _shared_cache;
+	// everything the experiment prints goes here; in a batch, into a log
+	// of its own;
+	FILE *_out;
 
 	// vNOC simulation parameters;
 	long _inp_buf, _out_buf;
@@ -337,7 +483,7 @@ class SFRA {
 	int _gui_pauses;
 	int _sim_mode;
 	char _test_name[256];
-	int _inj_load, _skipped_packets, _max_skip_counter, _skip_counter;
+	int _inj_load;
 
 	// additional parameters for various sweeps and investigations;
 	bool _load_sweep;
@@ -345,21 +491,24 @@ class SFRA {
 	bool _testcase_creation;
 	float _testcase_multiplier;
 	bool _use_excel;
-
-	// _sketch_latency is a temporary storage where any call of the vNOC
-	// simulator will deposit the final result; needed here because the
-	// current wrapper VNOC_APP of vNOC is used via its ctor, which will 
-	// destroy vNOC object inside it; so, I need to pass the result;
-	double _sketch_latency;
-	double _sketch_packets_per_cycle; // average;
+	// routers activity time series and heatmaps written into results/;
+	bool _export_activity;
+	// headless gui: routers usage recorded into a frame log (record) and
+	// frame logs rendered offline into svg pictures (replay:);
+	bool _record_frames;
+	char _replay_file[256];
+	// routers and links energy; disabled unless a technology file is given;
+	ENERGY_MODEL _energy_model;
 
 	// application graph; this is unique no matter how many floorplans
 	// are investigated;
 	APPLICATION_GRAPH _application_graph;
+	// netlist of the testcase, read only once from the .fp file and shared
+	// by all floorplans, and its traces; created at first use;
+	TESTCASE_INPUTS *_inputs;
 	// sketch arrays used for 3D architecture explaoration only;
 	vector<int> _magic_topid_to_subid;
-	vector<int> _magic_subid1_to_topid;
-	vector<int> _magic_subid2_to_topid; 
+	vector< vector<int> > _magic_subid_to_topid; // one per layer;
 
 	// if _verbose is true then detailed framework run will be printed
 	// by calling "print_*" functions; default is true;
@@ -379,6 +528,15 @@ class SFRA {
 		_n_fps = 1; // default 10;
 		_n_best = 1; // default 3;
 		_fp_criteria = 'A';
+		_n_sim = 0; // 0 means simulate all bests;
+		_threads = 0; // all cores;
+		_thread_pool = 0;
+		_pipeline = false;
+		_cache = 0;
+		_batch_file[0] = '\0';
+		_shared = false;
+		_shared_cache = false;
+		_out = stdout;
 		_inp_buf = INPUT_BUFFER_SIZE; // 5;
 		_out_buf = OUTPUT_BUFFER_SIZE; // 5;
 		_vc_n = VIRTUAL_CHANNEL_COUNT; // 3;
@@ -391,98 +549,183 @@ class SFRA {
 		_extra_links_timing_factor = 1;
 		_gui_pauses = 1;
 		_fp_scale = 1.0;
+		_replicas = 1;
+		_equilibrium = false;
+		_outline_whitespace = 0;
+		_noc_weight = 0;
+		_traffic_weight = 0;
+		_layers = 2;
+		_coanneal_weight = 0;
 		_sim_mode = SIMULATED_ARCH_25D;
 		strcpy( _test_name, "Unnamed");
 		_inj_load = 100; 
-		_skipped_packets = 0; 
-		_max_skip_counter = 10;
-		_skip_counter = 0;
 		_load_sweep = false;
 		_buffer_sweep = false;
 		_testcase_creation = false;
 		_testcase_multiplier = 1.0;
 		_use_excel = false;
+		_export_activity = false;
+		_record_frames = false;
+		_replay_file[0] = '\0';
 
+		_inputs = 0;
 		_modules_N = 0;
 		_ary = 0;
-		_sketch_latency = 0.0;
-		_sketch_packets_per_cycle = 0.0;
 		// seed to be used for the C++' RNG is set randomly here; 
 		// it can be overwritten via arguments by user;
 		_seed = time(NULL);
 		_verbose = true;
 	}
-	~SFRA() {}
+	~SFRA();
 
 	bool parse_command_arguments( int argc, char *argv[]);
 	void print_setup_info() {
-		printf("Testcase name: \"%s\"", &_test_name);
+		fprintf( _out, "Testcase name: \"%s\"", &_test_name);
 		switch ( _sim_mode) {
 		case SIMULATED_ARCH_2D:
-			printf("\nWorking in 2D mode.");
+			fprintf( _out, "\nWorking in 2D mode.");
 			break;
 		case SIMULATED_ARCH_3D:
-			printf("\nWorking in 3D mode.");
+			fprintf( _out, "\nWorking in 3D mode.");
 			break;
 		case SIMULATED_ARCH_25D:
-			printf("\nWorking in 2.5D mode.");
+			fprintf( _out, "\nWorking in 2.5D mode.");
 			break;
 		default:
 			assert(0);
 		}
-		printf("\nSeed: %d", _seed);
+		fprintf( _out, "\nSeed: %d", _seed);
 	}
 	void setup_seed() {
 		// use the seed that potentially was asked by user via arguments;
 		srand( _seed);
 	}
+	// netlist of the testcase, read at first call;
+	const NETLIST *testcase_netlist( bool inflated_for_2d = false);
+	TESTCASE_INPUTS *testcase_inputs();
+	// parsed trace files, for the simulations;
+	TRACES *traces() { return testcase_inputs()->traces(); }
+	// this experiment runs in the batch of batch: it uses its testcase
+	// inputs, its threads and its results cache, if it has one;
+	void share_with_batch( SFRA &batch);
+	const char *batch_file() const { return _batch_file; }
+	FILE *out() { return _out; }
+	void set_out( FILE *out) { _out = out; }
+	// seed of trial "trial" of annealing attempt "attempt", derived from _seed;
+	unsigned int attempt_seed( int attempt, int trial);
+	// pool of threads running the annealing attempts, created at first call;
+	THREAD_POOL *thread_pool();
 	// 2D, 25D;
 	bool search_n_fps_floorplans(
 		vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps);
+	void anneal_floorplan_attempt( int i, FILE *log,
+		ONE_OF_THE_BEST_FLOOR_PLANS &attempt);
+	// adds to graph the routers assignment and the simulations of attempt,
+	// just gone into the bests list; see pipeline;
+	void add_pipelined_simulations( TASK_GRAPH &graph,
+		ONE_OF_THE_BEST_FLOOR_PLANS &attempt, long priority);
+	// true if attempt went into best_fps; then, if replaced_pos is given,
+	// it gets the position of the floorplan removed for it, or -1;
+	bool update_bests_list( ONE_OF_THE_BEST_FLOOR_PLANS &attempt,
+		vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps, int *replaced_pos = 0);
+	// what it prints goes into log; 0 prints nothing;
+	void assign_routers_to_cores( ONE_OF_THE_BEST_FLOOR_PLANS &best_fp,
+		ROUTER_ASSIGNMENT &router_assignment, double square_side, FILE *log);
+	// the routers assignment of best_fp that is simulated, with all its
+	// printouts;
+	void assign_routers_for_simulation( ONE_OF_THE_BEST_FLOOR_PLANS &best_fp,
+		ROUTER_ASSIGNMENT &router_assignment, double square_side, FILE *log);
+	// assigns the cores, in this order, to the routers of the _ary x _ary
+	// mesh that starts at (sx,sy) and has square_side as its physical
+	// size, for the least total extra-links length; the results are left
+	// in hungarian;
+	void solve_routers_assignment( HUNGARIAN_ONE &hungarian,
+		const vector<const Module_Info *> &cores,
+		double sx, double sy, double square_side);
+	// changes assignment (router of every core) for fewer hops between
+	// cores that communicate, at the cost of longer extra-links;
+	void refine_routers_assignment( const vector<const Module_Info *> &cores,
+		vector<int> &assignment, double sx, double sy, double square_side,
+		FILE *log);
+	void prescreen_best_fps_with_estimator(
+		vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps);
 	bool routers_assignment_and_vNOC_simulation(
 		vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps);
+	// (buffers size multiplier, load) of every simulation of a floorplan,
+	// in the order of the buffers size and load sweeps;
+	vector< pair<int, int> > simulation_points();
+	// simulates the floorplan (in 3D, the stack of subfloorplans) at one
+	// simulation point; everything is printed into log; if cancel becomes
+	// true, the simulation is abandoned;
+	RESULT simulate_noc( ROUTER_ASSIGNMENT &router_assignment,
+		ROUTERS_DISTRIBUTION &router_distribution,
+		const vector<ONE_OF_THE_BEST_FLOOR_PLANS *> &best_fps,
+		int buffer_multiplier, int load, FILE *log = stdout,
+		const atomic<bool> *cancel = 0);
+	// what the annealing of attempt i and a simulation depend on, for the
+	// results cache;
+	void add_annealing_to_key( CACHE_KEY &key, int i);
+	void add_simulation_to_key( CACHE_KEY &key,
+		ROUTER_ASSIGNMENT &router_assignment,
+		const vector<ONE_OF_THE_BEST_FLOOR_PLANS *> &best_fps,
+		int buffer_multiplier, int load);
+	// activity files and frame logs of a simulation are named after this;
+	void simulation_file_prefix( char *file_prefix,
+		const vector<ONE_OF_THE_BEST_FLOOR_PLANS *> &best_fps,
+		int load, long inp_buf);
+	// searches the floorplans and simulates the best ones, in the mode
+	// asked for; best_fps gets the bests list (in 3D, that of layer 1),
+	// for calculate_final_results_statistics();
+	void run_experiment( vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps);
 	bool calculate_final_results_statistics( int argc,char **argv,
 		vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps);
-	// 3D;
+	// 3D; best_fps_layers[layer] is the bests list of every layer; the
+	// floorplans at the same position of all lists form one 3D stack;
 	bool search_n_fps_floorplans_3D(
-		vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps1,
-		vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps2);
+		vector< vector <ONE_OF_THE_BEST_FLOOR_PLANS> > &best_fps_layers);
 	void search_n_fps_for_subfloorplan( B_Tree *fp_p,
 		vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps);
 	bool routers_assignment_and_vNOC_simulation_3D(
-		vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps1,
-		vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps2);
- 	int magic_subid1_to_topid(int i) const { 
-		return _magic_subid1_to_topid[ i]; 
-	};
- 	int magic_subid2_to_topid(int i) const { 
-		return _magic_subid2_to_topid[ i]; 
+		vector< vector <ONE_OF_THE_BEST_FLOOR_PLANS> > &best_fps_layers);
+	// records which top-level cores every layer has, from the partition
+	// of the application graph;
+	void set_magic_mappings( const vector<int> &partition);
+ 	int magic_subid_to_topid( int layer, int i) const { 
+		return _magic_subid_to_topid[ layer][ i]; 
 	};
+	int layers() const { return _layers; }
 	// 3D version 2;
 	bool search_n_fps_floorplans_3D_version2(
-		vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps1,
-		vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps2);
-	void search_n_fps_for_subfloorplans_layers_12(
+		vector< vector <ONE_OF_THE_BEST_FLOOR_PLANS> > &best_fps_layers);
+	void search_n_fps_for_subfloorplans_layers(
 		FPlan *fp_toplevel,
 		vector<int> partition,
-		vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps1,
-		vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps2);
+		vector< vector <ONE_OF_THE_BEST_FLOOR_PLANS> > &best_fps_layers);
+	// anneals one subfloorplan of a 3D attempt; everything it prints goes
+	// into the log of fp_p; layer tells the debug files apart;
+	void anneal_subfloorplan( B_Tree *fp_p, int layer, unsigned int seed);
+	// co-anneals the subfloorplans of all the layers of a 3D attempt;
+	void coanneal_subfloorplans( vector<B_Tree *> &fp_layers,
+		int attempt, int trial);
+	// initializes fp_p for annealing and returns its annealing, to be
+	// deleted by the caller;
+	SA_FLOORPLANING *new_subfloorplan_annealing( B_Tree *fp_p, int layer,
+		unsigned int seed);
  
 
 	double extra_links_timing_factor() const { return _extra_links_timing_factor; }
 	int sim_mode() const { return _sim_mode; }
-	void set_skip_counter(int new_val) { _skip_counter = new_val; }
-	int skip_counter() const { return _skip_counter; }
-	int max_skip_counter() const { return _max_skip_counter; }
 	bool testcase_creation() const { return _testcase_creation; }
 	double testcase_multiplier() const { return _testcase_multiplier; }
-	void set_sketch_latency(double val) { _sketch_latency = val; }
-	double sketch_latency() const { return _sketch_latency; }
-	void set_sketch_packets_per_cycle(double val) { _sketch_packets_per_cycle = val; }
-	double sketch_packets_per_cycle() const { return _sketch_packets_per_cycle; }
 	char *test_name() { return _test_name; }
 	bool verbose() const { return _verbose; }
-	void calculate_average_path_length(ROUTER_ASSIGNMENT *router_assignment);
+	bool export_activity() const { return _export_activity; }
+	ENERGY_MODEL &energy_model() { return _energy_model; }
+	bool record_frames() const { return _record_frames; }
+	char *replay_file() { return _replay_file; }
+	RESULTS_CACHE *results_cache() { return _cache; }
+	void calculate_average_path_length(ROUTER_ASSIGNMENT *router_assignment,
+		FILE *log = stdout);
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,72 @@
+#ifndef _SFRA_BATCH_H_
+#define _SFRA_BATCH_H_
+#include "config.h"
+#include "sfra.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <mutex>
+
+using namespace std;
+
+// longest line of a batch file;
+#define BATCH_LINE_SIZE 4096
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// BATCH
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// one line of a batch file: the command line of an experiment, as it
+// would be run alone;
+class BATCH_EXPERIMENT {
+ public:
+	int line_number;
+	vector<string> args; // args[0] is the program;
+	vector<char *> argv;
+	SFRA *sfra;
+	FILE *log; // what the experiment prints, until it is reported;
+	vector<ONE_OF_THE_BEST_FLOOR_PLANS> best_fps;
+	bool done;
+
+ public:
+	BATCH_EXPERIMENT() { line_number = 0; sfra = 0; log = 0; done = false; }
+	~BATCH_EXPERIMENT() {}
+};
+
+// runs the experiments of a batch file (see batch:), e.g. a .run script,
+// in one process: every line is a command line of sfra (the program may
+// be left out); empty lines and lines that start with # are skipped;
+// the experiments share the parsed testcases and traces and the threads
+// of the batch, and its results cache if it has one; they run
+// concurrently, each printing into a log of its own; every experiment
+// is reported - its log printed and its results files written - once
+// it and all the experiments before it are done, so the output is that
+// of running the lines one after another;
+
+class BATCH {
+ private:
+	SFRA *_sfra; // the batch command line;
+	vector<BATCH_EXPERIMENT> _experiments;
+	mutex _mutex;
+	int _reported_count;
+
+ public:
+	BATCH( SFRA *sfra) { _sfra = sfra; _reported_count = 0; }
+	~BATCH();
+
+	// reads and parses the command lines of file_name; program replaces
+	// the program of every line; exits on errors;
+	void read( const char *file_name, const char *program);
+	int experiments_count() const { return _experiments.size(); }
+	void run();
+
+ private:
+	void run_experiment( int k);
+	// reports the experiments that can be; must be called with _mutex
+	// locked;
+	void report_done_experiments();
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef _SFRA_CACHE_H_
+#define _SFRA_CACHE_H_
+#include "config.h"
+#include "sfra.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <set>
+#include <map>
+#include <mutex>
+
+using namespace std;
+
+// part of every key; to be increased whenever a change of the annealing,
+// of the routers assignment or of the simulator changes their results,
+// so that results cached before are not taken anymore;
+#define CACHE_FORMAT_VERSION 1
+// name of the index file, inside the cache directory;
+#define CACHE_INDEX_FILE "index.txt"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// CACHE_KEY
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// 64 bits FNV-1a hash of everything a cached result depends on: the
+// testcase files, the seed, the parameters and, for a simulation, the
+// floorplans and their routers assignment; values are added in a fixed
+// order, so equal keys mean equal inputs (but for collisions);
+
+class CACHE_KEY {
+ private:
+	unsigned long long _hash;
+
+ public:
+	// kind tells apart the keys of different kinds of results;
+	CACHE_KEY( const char *kind) {
+		_hash = 14695981039346656037ULL;
+		add_int( CACHE_FORMAT_VERSION);
+		add_string( kind);
+	}
+	~CACHE_KEY() {}
+
+	void add_bytes( const void *bytes, size_t bytes_count);
+	void add_int( long long value) { add_bytes( &value, sizeof( value)); }
+	void add_double( double value) { add_bytes( &value, sizeof( value)); }
+	void add_string( const char *text) { add_bytes( text, strlen( text) + 1); }
+	void add_floorplan( const ONE_OF_THE_BEST_FLOOR_PLANS &fp);
+	void add_router_assignment( ROUTER_ASSIGNMENT &router_assignment, int ary);
+	unsigned long long hash() const { return _hash; }
+	// the hash as 16 hex digits;
+	string name() const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// RESULTS_CACHE
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// persistent cache of the annealed floorplans and of the simulation
+// results, in a directory that outlives the runs (see cache:); every
+// entry is a text file named after its key, with the floorplan or the
+// RESULT and what was printed while computing it, so a hit prints the
+// same; the index file lists the entries, one line each: key, kind and
+// the experiment that stored it; entries are written into a temporary
+// file first and renamed, so runs sharing the directory never read half
+// an entry; all the methods may be called concurrently;
+
+class RESULTS_CACHE {
+ private:
+	string _directory;
+	mutex _mutex;
+	set<string> _entries; // names of the keys listed in the index;
+	// hashes of the contents of the testcase files hashed so far;
+	map<string, unsigned long long> _files_hashes;
+	long _hits_count;
+	long _stored_count;
+
+ public:
+	RESULTS_CACHE() { _hits_count = 0; _stored_count = 0; }
+	~RESULTS_CACHE() {}
+
+	// creates directory if needed and reads its index; false if it
+	// cannot be used;
+	bool open( const char *directory);
+	const char *directory() const { return _directory.c_str(); }
+	long hits_count() const { return _hits_count; }
+	long stored_count() const { return _stored_count; }
+	// adds to key the contents of file_name, or that it is missing; every
+	// file is read once;
+	void add_file( CACHE_KEY &key, const string &file_name);
+
+	// if key is cached, fills attempt, prints into log what was printed
+	// while annealing it and returns true;
+	bool load_floorplan( const CACHE_KEY &key,
+		ONE_OF_THE_BEST_FLOOR_PLANS &attempt, FILE *log);
+	// stores attempt, with what was printed into log since offset;
+	void store_floorplan( const CACHE_KEY &key, const char *experiment,
+		const ONE_OF_THE_BEST_FLOOR_PLANS &attempt, FILE *log, long offset);
+	// likewise, for the result of a simulation;
+	bool load_result( const CACHE_KEY &key, RESULT &result, FILE *log);
+	void store_result( const CACHE_KEY &key, const char *experiment,
+		const RESULT &result, FILE *log, long offset);
+
+ private:
+	string entry_file( const CACHE_KEY &key) const;
+	// opens the entry of key, if listed in the index;
+	FILE *open_entry( const CACHE_KEY &key, const char *kind);
+	// copies the log at the end of an entry into log; false if the entry
+	// is truncated;
+	bool load_log( FILE *entry, FILE *log);
+	// writes the entry (its first line, value, then the log) and lists it
+	// in the index;
+	void store_entry( const CACHE_KEY &key, const char *kind,
+		const char *experiment, const string &value, FILE *log, long offset);
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef _SFRA_ESTIMATOR_H_
+#define _SFRA_ESTIMATOR_H_
+#include "config.h"
+#include "fp_plan.h"
+#include <vector>
+
+using namespace std;
+
+class SFRA;
+class ROUTER_ASSIGNMENT;
+
+// latency returned for a flow that crosses a saturated channel (utilization
+// of 1 or more); it is large enough to push such a floorplan at the end of
+// any ranking, but still a finite number that can be printed and sorted;
+#define ESTIMATOR_SATURATED_LATENCY 1.0e9
+// cycles spent by a header flit inside one router: routing decision, vc
+// arbitration, sw arbitration and traversal to the output buffer; it mirrors
+// the pipeline implemented by ROUTER::simulate_one_router();
+#define ESTIMATOR_ROUTER_STAGES 4
+#define ESTIMATOR_CHANNELS_PER_ROUTER 6
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ESTIMATED_FLOW
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class ESTIMATED_FLOW {
+ public:
+	int src_id; // source IP/core;
+	int des_id; // destination IP/core;
+	double weight; // communication volume as read from the .fp file;
+	double rate; // flits per cycle, at the current injection load;
+	int hops; // number of links traversed by this flow;
+	double latency; // estimated average latency of its packets (cycles);
+	vector<long> channels; // channels traversed, from injection to ejection;
+ public:
+	ESTIMATED_FLOW() {
+		src_id = -1; des_id = -1; weight = 0.0; rate = 0.0;
+		hops = 0; latency = 0.0;
+	}
+	ESTIMATED_FLOW( int src, int des, double w) : src_id(src), des_id(des),
+		weight(w) { rate = 0.0; hops = 0; latency = 0.0; }
+	~ESTIMATED_FLOW() {}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// LATENCY_ESTIMATOR
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// analytical NoC latency model used to pre-screen the bests list before
+// any of its floorplans is handed to the (expensive) cycle-accurate vNOC;
+// every output channel of every router is modeled as an M/D/1 queue whose
+// arrival rate is the sum of the rates of the flows routed through it;
+// the service time is a whole packet because of wormhole switching;
+// per flow latency is then:
+//
+//   hops * (router stages + link delay) + (packet size - 1) +
+//   sum over traversed channels of the M/D/1 waiting time +
+//   extra-links and TSV delays (same as in ROUTER::consume_flit)
+//
+// all times are in cycles, like the delays reported by vNOC;
+//
+// set_flows( fp) once per testcase, calibrate_injection_rate( trace) once,
+// and then estimate( router_assignment, ary, load, link_length) for every
+// floorplan;
+
+class LATENCY_ESTIMATOR {
+ private:
+	SFRA *_sfra; // its host;
+	vector<ESTIMATED_FLOW> _flows;
+	double _total_weight; // sum of all flow weights;
+	// network-wide injection rate (flits/cycle) at 100% load and average
+	// packet size (flits) as found in the aggregate trace file;
+	double _injection_rate;
+	double _avg_packet_size;
+	// 6 channels per router: 0 is the ejection port, 1..4 are the x-, x+,
+	// y-, y+ output ports (same numbering as the physical ports of vNOC)
+	// and 5 is the injection port shared by all flows of the local core;
+	int _ary;
+	vector<double> _channel_load;
+	double _avg_latency;
+	double _max_utilization;
+	double _avg_utilization;
+	bool _saturated;
+
+ public:
+	LATENCY_ESTIMATOR() {
+		_sfra = 0;
+		_total_weight = 0.0;
+		_injection_rate = 0.0;
+		_avg_packet_size = 1.0;
+		_ary = 0;
+		_avg_latency = 0.0;
+		_max_utilization = 0.0;
+		_avg_utilization = 0.0;
+		_saturated = false;
+	}
+	~LATENCY_ESTIMATOR() {}
+
+	void set_sfra_host( SFRA *sfra) { _sfra = sfra; }
+	void set_flows( FPlan *fp_p);
+	bool calibrate_injection_rate( char *trace_file);
+	double estimate( ROUTER_ASSIGNMENT *router_assignment, int ary, int load,
+		double link_length);
+	void print_estimate( bool print_flows, FILE *fp = stdout);
+
+	long flows_count() const { return _flows.size(); }
+	ESTIMATED_FLOW &flow( long i) { return _flows[i]; }
+	double avg_latency() const { return _avg_latency; }
+	double max_utilization() const { return _max_utilization; }
+	double avg_utilization() const { return _avg_utilization; }
+	bool saturated() const { return _saturated; }
+	double injection_rate() const { return _injection_rate; }
+	double avg_packet_size() const { return _avg_packet_size; }
+};
+
+#endif
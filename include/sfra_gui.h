@@ -34,6 +34,9 @@
 enum COLOR_TYPES { WHITE, BLACK, DARKGREY, LIGHTGREY, BLUE, GREEN, YELLOW, CYAN,
 	RED, GREY35, GREY15 }; // DARKGREEN, MAGENTA
 enum LINE_TYPES { SOLID, DASHED };
+// cores and links of the layers of a 3D stack are colored by layer, cycling
+// through this many colors;
+#define GUI_LAYER_COLORS 4
 enum PICTURE_TYPE { NO_PICTURE, ROUTERS }; // What's on screen?
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -152,8 +155,8 @@ class GUI_GRAPHICS {
 	TOPOLOGY *_topology;
 	VNOC *_vnoc;
 	// next ones are related to the floorplanning and router assignmemnt;
-	ONE_OF_THE_BEST_FLOOR_PLANS *_best_fp1;
-	ONE_OF_THE_BEST_FLOOR_PLANS *_best_fp2; // used only in 3D sim_mode;
+	// the floorplan; in 3D sim_mode, the subfloorplan of every layer;
+	vector<ONE_OF_THE_BEST_FLOOR_PLANS *> _best_fps;
 	ROUTER_ASSIGNMENT *_router_assignment;
 	ROUTERS_DISTRIBUTION *_router_distribution;
 
@@ -167,8 +170,7 @@ class GUI_GRAPHICS {
  public:
 	GUI_GRAPHICS( TOPOLOGY *topology, VNOC *vnoc,
 		char *testcase_name,
-		ONE_OF_THE_BEST_FLOOR_PLANS *best_fp1,
-		ONE_OF_THE_BEST_FLOOR_PLANS *best_fp2, // default we run 2.5D or 2D;
+		const vector<ONE_OF_THE_BEST_FLOOR_PLANS *> &best_fps, // one per layer;
 		ROUTER_ASSIGNMENT *router_assignment,
 		ROUTERS_DISTRIBUTION *router_distribution);
 	~GUI_GRAPHICS() {}
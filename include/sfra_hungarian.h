@@ -1,7 +1,9 @@
 #ifndef _REMNOC_HUNGARIAN_H_
 #define _REMNOC_HUNGARIAN_H_
 
+#include <stdio.h>
 #include <vector>
+#include <utility>
 
 
 using namespace std;
@@ -12,35 +14,65 @@ using namespace std;
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-// this is the (Minimum) Assignment Problem by Hungarian Algorithm; taken and
-// adapted from Knuth's Stanford Graphbase; first size1 will be used for the
-// number of IP/cores, and second size2 will be used for the candidate tiles
-// - as a subset of tiles available on NOC -
-// http://reptar.uta.edu/NOTES5311/hungarian.c
+// this is the (Minimum) Assignment Problem; first size1 will be used for the
+// number of IP/cores, and second size2 (>= size1) will be used for the
+// candidate tiles - as a subset of tiles available on NOC -; every core
+// gets a different tile and the sum of the costs is minimum;
+// it was Knuth's Hungarian algorithm from the Stanford Graphbase, on int
+// costs (http://reptar.uta.edu/NOTES5311/hungarian.c); it is now the
+// shortest augmenting path algorithm of Jonker and Volgenant, for
+// rectangular problems (as in D.F. Crouse, "On implementing 2D rectangular
+// assignment algorithms", IEEE Trans. AES, 2016), on double costs: every
+// core is assigned in turn, along the shortest path (Dijkstra on the costs
+// reduced by the dual variables) to a free tile; it is O(size1^2 * size2)
+// at worst, but much less on router assignment costs;
+//
+// for large problems, every core can instead be given only a few
+// candidate tiles (e.g., the nearest ones), which makes the solver about
+// linear in the number of cores; the paths are then searched with a heap
+// over the candidates only, and the assignment is the best one among
+// candidates; if some core cannot get any of its candidates, the caller
+// should solve the dense problem instead;
 //
 // initialize( dim1, dim2)
 // set_cost( y, x) for any possible assignment
 // run_hungarian() to solve the assignment problem
 // report_assignment_of( y)
+//
+// or:
+// initialize_sparse( dim1, dim2, candidates_count)
+// set_candidate( y, k, x, cost) for the k-th candidate tile x of core y
+// run_hungarian(), which returns false if some core got no tile
+// report_assignment_of( y)
 
 #define SIZE1_HUNGARIAN 64;
 #define SIZE2_HUNGARIAN 64;
-#define INFINITY_HUNGARIAN 0x7FFFFFFF;
 
 class HUNGARIAN_ONE {
  private:
 	int _size1;
 	int _size2;
-	vector<int> _array;
+	// 0 for dense problems, where _array has all _size1 x _size2 costs;
+	// else the number of candidates of every core, whose tiles are in
+	// _candidates and costs in _array, _size1 x _candidates_count;
+	int _candidates_count;
+	vector<int> _candidates;
+	vector<double> _array;
 	vector<int> _result;
 	// utils storage;
-	vector<int> _unchosen_row; // _size1;
-	vector<int> _row_mate; // _size2;
-	vector<int> _row_dec;
-	vector<int> _col_inc;
-	vector<int> _parent_row;
-	vector<int> _slack;
-	vector<int> _slack_row;
+	vector<int> _row_mate; // _size2; core assigned to every tile or -1;
+	vector<double> _row_dual; // _size1;
+	vector<double> _col_dual; // _size2;
+	vector<double> _path_cost; // _size2; shortest path to every tile;
+	vector<int> _parent_row; // _size2; previous core on that path;
+	vector<int> _remaining; // tiles not yet reached by the paths;
+	vector<char> _row_visited;
+	vector<char> _col_visited;
+	// sparse problems only: tiles and cores reached by the current path
+	// search, and its heap of (path cost, tile);
+	vector<int> _touched_cols;
+	vector<int> _touched_rows;
+	vector< pair<double,int> > _heap;
  public:
 	HUNGARIAN_ONE() {
 		_size1 = SIZE1_HUNGARIAN;
@@ -50,13 +82,33 @@ class HUNGARIAN_ONE {
 	~HUNGARIAN_ONE() {}
 	
 	void initialize( int y, int x);
+	void initialize_sparse( int y, int x, int candidates_count);
 	void clear();
-	void run_hungarian(); // solve it;
-	int get_array( int i, int j) { return _array[i * _size2 + j]; }
-	void set_array( int i, int j, int value) { _array[i * _size2 + j] = value; }
-	void set_cost( int y, int x, int cost) { set_array( y, x, cost); }
+	bool run_hungarian(); // solve it;
+	double get_array( int i, int j) { return _array[i * _size2 + j]; }
+	void set_array( int i, int j, double value) { _array[i * _size2 + j] = value; }
+	void set_cost( int y, int x, double cost) { set_array( y, x, cost); }
+	bool sparse() const { return ( _candidates_count > 0); }
+	void set_candidate( int y, int k, int x, double cost) {
+		_candidates[y * _candidates_count + k] = x;
+		_array[y * _candidates_count + k] = cost;
+	}
 	int report_assignment_of( int y) { return _result[y]; }
-	void print_hungarian_assignment(); // for debug;
+	// dual variable of core y; the dual variables of the tiles start at
+	// 0 and never increase, so the assignment of a sparse problem is also
+	// the best one of the dense problem if every core has a dual variable
+	// not larger than the cost of any of its tiles that is not a candidate;
+	double report_dual_of( int y) { return _row_dual[y]; }
+	void print_hungarian_assignment( FILE *fp = stdout); // for debug;
+
+ private:
+	// shortest augmenting path from core "row" to a free tile; returns
+	// that tile and its path cost in min_cost;
+	int shortest_augmenting_path( int row, double &min_cost);
+	// same, over the candidate tiles only; returns -1 if there is no such
+	// path;
+	int sparse_shortest_augmenting_path( int row, double &min_cost);
+	bool run_sparse();
 };
 
 ////////////////////////////////////////////////////////////////////////////////
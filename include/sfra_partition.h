@@ -0,0 +1,137 @@
+#ifndef _SFRA_PARTITION_H_
+#define _SFRA_PARTITION_H_
+#include "config.h"
+#include <vector>
+
+using namespace std;
+
+class THREAD_POOL;
+
+// coarsening stops at this many vertices per part, or when a level has
+// less than 10% fewer vertices than the previous one;
+#define PARTITION_COARSEST_PER_PART 10
+#define PARTITION_MIN_REDUCTION 0.9
+// a cluster may not weigh more than the average part / this;
+#define PARTITION_CLUSTERS_PER_PART 4
+// nets with more pins are not used to match vertices, nor to update the
+// gains of their pins after a move (gains are always checked before a
+// move anyway);
+#define PARTITION_LARGE_NET 64
+#define PARTITION_INITIAL_TRIALS 8
+#define PARTITION_FM_PASSES 8
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// HYPERGRAPH
+//
+////////////////////////////////////////////////////////////////////////////////
+
+class HYPERGRAPH {
+ public:
+	int vertices_count;
+	vector<double> vertex_weight;
+	vector<int> fixed; // part of every fixed vertex, -1 for free ones;
+	// pins of net e are pins[net_start[e]] ... pins[net_start[e+1]-1];
+	vector<int> net_start;
+	vector<int> pins;
+	vector<double> net_weight;
+	// nets of vertex v, likewise;
+	vector<int> vertex_start;
+	vector<int> vertex_nets;
+
+ public:
+	HYPERGRAPH() { vertices_count = 0; net_start.push_back( 0); }
+	~HYPERGRAPH() {}
+
+	int nets_count() const { return int(net_start.size()) - 1; }
+	int net_size( int e) const { return net_start[e+1] - net_start[e]; }
+	void build_vertex_nets();
+	double total_weight() const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// MULTILEVEL_PARTITIONER
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// k-way partitioning of a hypergraph with weighted vertices and nets, and
+// fixed vertices, for the least sum over nets of weight * (number of parts
+// spanned - 1), i.e., the weight of the cut nets when k is 2;
+//
+// multilevel, like hMetis: the hypergraph is coarsened by matching every
+// vertex with the one it shares the heaviest (small) nets with; the
+// coarsest one is partitioned a few times at random and refined; then
+// the partition is projected back level by level and refined at each one
+// by k-way Fiduccia-Mattheyses passes, that move single vertices, the
+// best gain first, to any other part that stays within the balance; a
+// V-cycle coarsens again, matching only vertices of the same part, and
+// refines the partition projected back; runs are independent and run
+// concurrently; the best one is kept, the first one among equals, so
+// the result does not depend on the number of threads;
+//
+// balance follows the UBfactor of hMetis: for a bisection with UBfactor
+// b, every part weighs at most (50 + b)% of the total; for k parts, at
+// most (1 + b/50) / k of it;
+//
+// initialize( vertices_count, parts_count), set_vertex_weight( v, w),
+// set_fixed( v, part), add_net( pins_count, pins, w) for every net, then
+// run( seed, pool) and part_of( v);
+
+class MULTILEVEL_PARTITIONER {
+ private:
+	HYPERGRAPH _graph;
+	int _parts_count;
+	double _ubfactor;
+	int _runs;
+	int _vcycles;
+	vector<int> _part;
+	double _cut;
+	double _overweight; // sum of the weight over the limit of all parts;
+
+ public:
+	MULTILEVEL_PARTITIONER() {
+		_parts_count = 2;
+		_ubfactor = 5;
+		_runs = 4;
+		_vcycles = 1;
+		_cut = 0.0;
+		_overweight = 0.0;
+	}
+	~MULTILEVEL_PARTITIONER() {}
+
+	void initialize( int vertices_count, int parts_count);
+	void set_vertex_weight( int v, double weight) {
+		_graph.vertex_weight[v] = weight;
+	}
+	void set_fixed( int v, int part) { _graph.fixed[v] = part; }
+	void add_net( int pins_count, const int *pins, double weight);
+	void set_ubfactor( double ubfactor) { _ubfactor = ubfactor; }
+	void set_runs( int runs) { _runs = runs; }
+	void set_vcycles( int vcycles) { _vcycles = vcycles; }
+	// returns the cut of the best run;
+	double run( unsigned int seed, THREAD_POOL *pool);
+	int part_of( int v) const { return _part[v]; }
+	double cut() const { return _cut; }
+	double overweight() const { return _overweight; }
+
+ private:
+	double max_part_weight( const HYPERGRAPH &graph) const;
+	double cut_of( const HYPERGRAPH &graph, const vector<int> &part) const;
+	double overweight_of( const HYPERGRAPH &graph, const vector<int> &part) const;
+	// true if part1 is better: less overweight, else smaller cut;
+	bool better( const HYPERGRAPH &graph, const vector<int> &part1,
+		const vector<int> &part2) const;
+	// coarse gets the clusters of fine; coarse_of maps every vertex of
+	// fine to its cluster; with part, only vertices of the same part are
+	// matched;
+	void coarsen( const HYPERGRAPH &fine, const vector<int> *part,
+		HYPERGRAPH &coarse, vector<int> &coarse_of, unsigned int &seed) const;
+	void initial_partition( const HYPERGRAPH &graph, vector<int> &part,
+		unsigned int &seed) const;
+	void refine( const HYPERGRAPH &graph, vector<int> &part) const;
+	// one multilevel partitioning; V-cycle if vcycle, from part;
+	void multilevel( vector<int> &part, bool vcycle, unsigned int &seed) const;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef _SFRA_REFINE_H_
+#define _SFRA_REFINE_H_
+#include "config.h"
+#include "fp_plan.h"
+#include <stdlib.h>
+#include <vector>
+
+using namespace std;
+
+class THREAD_POOL;
+
+// independent searches run by refine(), each with its own random numbers;
+// fixed, so that results do not depend on the number of threads;
+#define REFINE_SEARCHES 4
+// iterations of every search, per core;
+#define REFINE_ITERATIONS_PER_CORE 50
+// a core may move only to routers at most this many pitches away in x and
+// y from its current one;
+#define REFINE_RADIUS 2
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ROUTERS_REFINEMENT
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// the Hungarian routers assignment minimizes only the extra-links; but the
+// latency of the NoC depends also on the hops between the routers of cores
+// that communicate; ROUTERS_REFINEMENT starts from that assignment and
+// looks, by tabu search, for one with a smaller
+//
+//   sum of extra-links + weight * sum of comm. volume * XY hops
+//
+// a quadratic assignment problem; extra-links are in router pitches and
+// comm. volumes are relative to the average one, so that weight 1 trades
+// one pitch of extra-link for one hop of an average communication;
+// moves are the swap of the routers of two cores, or the move of a core to
+// a free router nearby; their cost change is computed from the communications of
+// the cores moved only;
+//
+// set_flows( netlist) once per testcase; then, for every assignment,
+// initialize( cores_count, ary), set_extralink( id, j, pitches) for every
+// core and router, and refine( assignment, weight, seed, pool);
+
+class ROUTERS_REFINEMENT {
+ private:
+	int _cores_count;
+	int _ary;
+	int _routers_count;
+	// communications of every core, both directions: core i talks to
+	// _talks_to[k] with relative volume _volume[k], for k in
+	// [_talks_start[i], _talks_start[i+1]);
+	vector<int> _talks_start;
+	vector<int> _talks_to;
+	vector<double> _volume;
+	vector<double> _extralinks; // _cores_count x _routers_count;
+	double _weight;
+
+ public:
+	ROUTERS_REFINEMENT() {
+		_cores_count = 0;
+		_ary = 0;
+		_routers_count = 0;
+		_weight = 0.0;
+	}
+	~ROUTERS_REFINEMENT() {}
+
+	void set_flows( const NETLIST *netlist);
+	void initialize( int cores_count, int ary);
+	void set_extralink( int id, int j, double pitches) {
+		_extralinks[ id * _routers_count + j] = pitches;
+	}
+	// assignment[id] is the router of core id, changed in place into the
+	// best one found; returns the cost of that one;
+	double refine( vector<int> &assignment, double weight,
+		unsigned int seed, THREAD_POOL *pool);
+	double cost( const vector<int> &assignment, double weight);
+	double extralinks( const vector<int> &assignment);
+	// sum of comm. volume * XY hops;
+	double weighted_hops( const vector<int> &assignment);
+
+ private:
+	int hops( int r1, int r2) const {
+		return abs( r1 % _ary - r2 % _ary) + abs( r1 / _ary - r2 / _ary);
+	}
+	double extralink( int id, int j) const {
+		return _extralinks[ id * _routers_count + j];
+	}
+	// cost change if core id moves from router "from" to router "to",
+	// while the core "skip" (if any) is being moved too;
+	double move_delta( const vector<int> &router_of, int id, int from, int to,
+		int skip) const;
+	double search( vector<int> &assignment, unsigned int seed) const;
+};
+
+#endif
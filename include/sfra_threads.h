@@ -0,0 +1,121 @@
+#ifndef _SFRA_THREADS_H_
+#define _SFRA_THREADS_H_
+#include "config.h"
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <set>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// THREAD_POOL
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// fixed set of worker threads used to run independent tasks, like the
+// annealing attempts, concurrently; run() hands out task indices to the
+// workers and to the calling thread, which works too, and returns when
+// all the tasks are done; tasks are expected to write their results into
+// slots of their own, so that the caller can reduce them afterwards in
+// index order and get the same results no matter how many threads ran;
+//
+// a task may call run() again (e.g., a batch of runs, each with its own
+// annealing attempts); the calling thread always works on its own tasks,
+// so nested calls do not deadlock; with 1 thread there are no workers
+// and run() is just a loop;
+
+class THREAD_POOL {
+ private:
+	struct JOB {
+		const function<void(int)> *task;
+		int tasks_count;
+		int next_task; // first task not yet handed out;
+		int done_count;
+	};
+
+	vector<thread> _workers;
+	mutex _mutex;
+	condition_variable _job_added; // workers wait here for work;
+	condition_variable _task_done; // callers of run() wait here;
+	deque<JOB*> _jobs; // jobs with tasks not yet handed out;
+	bool _stop;
+
+ public:
+	// threads_count includes the thread calling run(); 0 means as many
+	// as the hardware threads;
+	THREAD_POOL( int threads_count);
+	~THREAD_POOL();
+
+	int threads_count() const { return _workers.size() + 1; }
+	// runs task(0), ..., task(tasks_count-1) and returns when all are done;
+	void run( int tasks_count, const function<void(int)> &task);
+
+ private:
+	void worker();
+	// hands out the next task of job; must be called with _mutex locked;
+	int take_task( JOB *job);
+	void finish_task( JOB *job);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// TASK_GRAPH
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// tasks with dependencies among them, run by all the threads of a
+// THREAD_POOL; a task is ready once all the tasks it depends on are done;
+// ready tasks are taken from one queue, the smallest priority first and,
+// among equals, the first added; tasks may add more tasks while the graph
+// runs, also depending on tasks that are already done; run() returns when
+// all the tasks added are done;
+//
+// a task cancelled before it starts is not run, and its dependents are
+// released as if it was done; one already running is not interrupted (it
+// may watch a flag of its own to stop early);
+//
+// tasks are expected to be coarse (an annealing, a simulation); hence, one
+// queue under one lock instead of a queue per thread with stealing; tasks
+// that call THREAD_POOL::run() themselves run those nested tasks mostly on
+// their own thread, as the other threads are busy in the graph;
+
+class TASK_GRAPH {
+ private:
+	struct TASK {
+		function<void()> work;
+		long priority;
+		int waiting_count; // tasks it depends on that are not done yet;
+		bool done;
+		bool cancelled;
+		vector<int> dependents;
+	};
+
+	mutex _mutex;
+	condition_variable _changed; // threads with nothing to do wait here;
+	deque<TASK *> _tasks; // indexed by task id;
+	set< pair<long, int> > _ready; // (priority, id) of ready tasks;
+	int _not_done_count;
+
+ public:
+	TASK_GRAPH() { _not_done_count = 0; }
+	~TASK_GRAPH();
+
+	// returns the id of the new task;
+	int add_task( const function<void()> &work,
+		const vector<int> &dependencies, long priority);
+	void cancel( int id);
+	// runs all the tasks on all the threads of pool;
+	void run( THREAD_POOL *pool);
+
+ private:
+	void work();
+	// must be called with _mutex locked;
+	void finish( int id);
+};
+
+#endif
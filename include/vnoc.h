@@ -13,6 +13,7 @@
 #include <sstream>
 #include <string>
 #include <cstring>
+#include <atomic>
 
 using namespace std;
 
@@ -28,7 +29,9 @@ class VNOC;
 class ROUTER;
 class EVENT_QUEUE;
 class GUI_GRAPHICS;
+class FRAME_RECORDER;
 class SFRA;
+class RESULT;
 
 ////////////////////////////////////////////////////////////////////////////////
 //
@@ -258,7 +261,9 @@ class ROUTER {
 		ROUTING_ALGORITHM _routing_algo; // routing algorithm used;
 		double _local_injection_time; // used for the next packet injection time;
 		long _packet_counter;
-		ifstream *_local_injection_file; // input trace file;
+		// packets of the input trace file, next one to inject;
+		const TRACE *_local_injection_trace;
+		long _local_injection_next;
 		// these two are required in the implementation of the 2.5D
 		// framework;
 		// "extra_length" is the additional wire length needed to connect 
@@ -267,6 +272,27 @@ class ROUTER {
 		double _link_length;
 		double _extra_length;
 		ROUTER_ASSIGNMENT *_router_assignment;
+		// flits sent through each physical port; port 0 counts the flits
+		// consumed (ejected) by this router;
+		vector<long> _port_flits_count;
+		// activity counters; always on and cumulative since the start of 
+		// the simulation; indexed by [physical port][vc] or [physical port];
+		vector<vector<double> > _buffer_occupancy; // flits x cycles in input vc's;
+		// flits that crossed the crossbar; flits arrived at destination are
+		// consumed directly from the input vc and counted in port 0 above;
+		vector<vector<long> > _crossbar_traversals;
+		vector<vector<long> > _credit_stalls; // cycles an input vc had no credits;
+		// arbitration requests, winners included, and requests that lost;
+		// the input side counts the vc's of an input port competing for
+		// the crossbar input (sw arbitration, first stage); the output side
+		// counts the input ports competing for an output port (sw
+		// arbitration, second stage) and the input vc's competing for the
+		// vc's of an output port (vc arbitration);
+		vector<long> _input_arbitration_requests;
+		vector<long> _input_arbitration_conflicts;
+		vector<long> _output_arbitration_requests;
+		vector<long> _output_arbitration_conflicts;
+		vector<long> _buffer_writes; // flits written into input buffers;
 	public:
 		int _assigned_core;
 
@@ -288,10 +314,23 @@ class ROUTER {
 		long vc_number() { return _vc_number; }
 		long buffer_size() { return _buffer_size; }
 		double extra_length() { return _extra_length; }
+		double link_length() const { return _link_length; }
 
 		// calculate the  accumulated total "propagation" delay of all flits;	
 		void update_delay(double delta) { _total_delay += delta; }
 		double total_delay() const { return _total_delay; }
+		long port_flits_count(long i) const { return _port_flits_count[i]; }
+		double buffer_occupancy(long i, long j) const { return _buffer_occupancy[i][j]; }
+		long crossbar_traversals(long i, long j) const { return _crossbar_traversals[i][j]; }
+		long credit_stalls(long i, long j) const { return _credit_stalls[i][j]; }
+		long input_arbitration_requests(long i) const { return _input_arbitration_requests[i]; }
+		long input_arbitration_conflicts(long i) const { return _input_arbitration_conflicts[i]; }
+		long output_arbitration_requests(long i) const { return _output_arbitration_requests[i]; }
+		long output_arbitration_conflicts(long i) const { return _output_arbitration_conflicts[i]; }
+		long buffer_writes(long i) const { return _buffer_writes[i]; }
+		long buffers_occupancy() const; // flits now in input and output buffers;
+		void init_activity_counters();
+		void update_buffer_occupancy();
 		// retrieve packet from trace file associated with this;
 		void receive_packet_from_trace_file();
 		void inject_packet( long flit_id, ADDRESS &sor_addr, ADDRESS &des_addr,
@@ -312,12 +351,7 @@ class ROUTER {
 		void send_flits_via_physical_link();
 		void sanity_check() const;
 
-		ifstream &local_injection_file() { return *_local_injection_file; }
 		void init_local_injection_file();
-		void close_injection_file() { // needed to avoid memory leaks;
-			_local_injection_file->close();
-			delete _local_injection_file;
-		}
 
 		void call_current_routing_algorithm(
 			const ADDRESS &des_t, const ADDRESS &sor_t,
@@ -350,13 +384,24 @@ class LINK {
 //
 ////////////////////////////////////////////////////////////////////////////////
 
+// fields recorded for every physical port of every router in each sample of
+// the activity time series; except buffer occupancy, which is the average
+// number of flits in the input buffers of the port, all are counts over the 
+// sampling period; arbitration conflicts are those of the output side of the
+// port (ROUTER::output_arbitration_conflicts), where flits wait for the link;
+enum ACTIVITY_FIELD { ACTIVITY_LINK_FLITS, ACTIVITY_CROSSBAR_TRAVERSALS,
+	ACTIVITY_BUFFER_OCCUPANCY, ACTIVITY_ARBITRATION_CONFLICTS,
+	ACTIVITY_CREDIT_STALLS, ACTIVITY_FIELDS_COUNT };
+
 class VNOC {
 	private:
 		long _ary_size;
 		long _cube_size;
 		long _routers_count;
 		long _packets_count;
-		ifstream _input_file_st;
+		// packets of the main trace file, next one to schedule;
+		const TRACE *_input_trace;
+		long _input_next;
 		ROUTER_ASSIGNMENT *_router_assignment;
 		// _latency is the final result of running the vNOC simulator; introduced
 		// in order to be able to read it from other classes, when vNOC is used 
@@ -364,6 +409,14 @@ class VNOC {
 		double _latency;
 		// if _verbose is true then detailed debug info will be printed;
 		bool _verbose;
+		// injection load control; in 10 by 10 injections, only the first
+		// _max_skip_counter ones are done (see set_load());
+		int _max_skip_counter;
+		int _skip_counter;
+		// detailed statistics of the simulation go here; 0 if not needed;
+		RESULT *_result;
+		// if given, the simulation stops as soon as it becomes true;
+		const atomic<bool> *_cancel;
 		
 		// here are the delay numbers extrapolated from the original
 		// numbers from popnet that were derived for a link of 1mm and
@@ -372,31 +425,57 @@ class VNOC {
 		double _h_pipe_delay;
 		double _h_credit_delay;
 
+		// latency of all packets (tail flits) consumed so far and the
+		// same per source-destination flow; key is src_router_id *
+		// _routers_count + des_router_id;
+		LATENCY_HISTOGRAM _latency_histogram;
+		map<long, FLOW_STATISTICS> _flows_statistics;
+
+		// routers activity sampled every REPORT_STATS_PERIOD; a sample is
+		// ACTIVITY_FIELDS_COUNT floats per physical port per router;
+		// _activity_last keeps the cumulative counters at the previous 
+		// sample so that samples store only what happened in between;
+		vector<float> _activity_samples;
+		vector<double> _activity_sample_times;
+		vector<double> _activity_last;
+
 	public:
 		// _routers was made public to be accessed by the gui;
 		vector<ROUTER> _routers;
 		TOPOLOGY *_topology;
 		EVENT_QUEUE *_event_queue;
 		GUI_GRAPHICS *_gui;
+		FRAME_RECORDER *_frame_recorder; // headless gui; 0 if not recording;
 		SFRA *_sfra;
 
 	public:
 		VNOC( TOPOLOGY *topology, EVENT_QUEUE *event_queue,
 			ROUTER_ASSIGNMENT *router_assignment, bool verbose=true);
-		~VNOC() {
-			// all files must be closed, or memory leaks can occur;
-			_input_file_st.close();
-			for ( int i = 0; i < _routers.size(); i++) {
-				_routers[i].close_injection_file();
-			}
-		}
+		~VNOC() {}
 
 		TOPOLOGY *topology() const { return _topology; }
 		EVENT_QUEUE *event_queue() { return _event_queue; }
 		GUI_GRAPHICS *gui() { return _gui; };
 		void set_gui(GUI_GRAPHICS *gui) { _gui = gui; }
+		FRAME_RECORDER *frame_recorder() { return _frame_recorder; }
+		void set_frame_recorder(FRAME_RECORDER *frame_recorder) { _frame_recorder = frame_recorder; }
+		void record_frame( double time);
 		SFRA *sfra() { return _sfra; }
 		void set_sfra_host(SFRA *sfra) { _sfra = sfra; }
+		// load is a percentage of the injections of the trace files;
+		void set_load( int load) {
+			_max_skip_counter = 10 - (100 - load) / 10;
+			_skip_counter = 0;
+		}
+		// true if the next injection is done at this load;
+		bool injection_allowed() {
+			_skip_counter = (_skip_counter + 1) % 10;
+			return ( _skip_counter < _max_skip_counter);
+		}
+		void set_result( RESULT *result) { _result = result; }
+		void set_cancel( const atomic<bool> *cancel) { _cancel = cancel; }
+		bool cancelled() const { return ( _cancel && *_cancel); }
+		FILE *log() { return _topology->log(); }
 
 		vector<ROUTER> &routers() { return _routers; }
 		const vector<ROUTER> &routers() const { return _routers; }
@@ -424,6 +503,9 @@ class VNOC {
 
 		bool run_simulation();
 		void check_simulation();
+		void record_packet_latency( const FLIT &flit, double latency);
+		void sample_activity( double time);
+		void export_activity( const char *file_prefix);
 		void print_simulation_results();
 		void print_network_routers();
 		void init_input_file();
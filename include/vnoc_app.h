@@ -5,10 +5,12 @@
 #include "vnoc_topology.h"
 #include "vnoc.h"
 #include <string>
+#include <atomic>
 
 using namespace std;
 
 class ROUTER_ASSIGNMENT;
+class RESULT;
 
 ////////////////////////////////////////////////////////////////////////////////
 //
@@ -36,8 +38,13 @@ class VNOC_APPLICATION {
 		double warmup_cycles, bool use_gui,
 		ROUTERS_DISTRIBUTION *r_distrib_p,
 		int gui_pauses,
-		ONE_OF_THE_BEST_FLOOR_PLANS *best_fp_p1,
-		ONE_OF_THE_BEST_FLOOR_PLANS *best_fp_p2 = 0); // used only by 3D;
+		// the floorplan; in 3D, the subfloorplan of every layer;
+		const vector<ONE_OF_THE_BEST_FLOOR_PLANS *> &best_fps,
+		// injection load (%); the statistics of the simulation go into
+		// result; everything is printed into log; if cancel becomes true,
+		// the simulation is abandoned and result is meaningless;
+		int load, RESULT &result, FILE *log = stdout,
+		const atomic<bool> *cancel = 0);
 	~VNOC_APPLICATION() {}
 
 	SFRA *sfra() { return _sfra; }
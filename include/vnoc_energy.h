@@ -0,0 +1,77 @@
+#ifndef _VNOC_ENERGY_H_
+#define _VNOC_ENERGY_H_
+#include "config.h"
+#include <vector>
+
+using namespace std;
+
+class VNOC;
+class RESULT;
+class CACHE_KEY;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ENERGY_MODEL
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// Orion-style activity based energy model of the routers and links; every
+// event (flit written into or read from an input buffer, crossbar traversal,
+// arbitration request, link or TSV traversal) costs a fixed energy given in
+// a technology file; leakage is a constant power per router;
+//
+// the simulator only counts events (see the activity counters of ROUTER);
+// energy is computed from the counters in one batch, at the end of the
+// simulation, and only if a technology file was given with "energy:"; so,
+// timing-only runs pay nothing for it;
+//
+// the technology file has one "name value" pair per line; lines starting
+// with # are comments; names not given keep the defaults of the ctor:
+//
+//   buffer_write   pJ per flit written into an input buffer
+//   buffer_read    pJ per flit read from an input buffer
+//   crossbar       pJ per flit crossing the crossbar
+//   arbiter        pJ per request to a vc or sw arbiter
+//   link           pJ per flit per BASE_WIRE length units of wire; used for
+//                  both router-to-router links and core extra-links
+//   tsv            pJ per flit per TSV traversal (2.5D and 3D only)
+//   leakage        mW per router
+//   frequency      GHz; clock of the NoC, one simulation cycle
+
+class ENERGY_MODEL {
+ private:
+	bool _enabled;
+	double _buffer_write;
+	double _buffer_read;
+	double _crossbar;
+	double _arbiter;
+	double _link;
+	double _tsv;
+	double _leakage;
+	double _frequency;
+
+ public:
+	ENERGY_MODEL() {
+		_enabled = false;
+		// roughly a 64 bits flit router in 65nm at 1V and 1GHz;
+		_buffer_write = 1.20;
+		_buffer_read = 1.00;
+		_crossbar = 1.80;
+		_arbiter = 0.05;
+		_link = 1.50;
+		_tsv = 0.05;
+		_leakage = 2.0;
+		_frequency = 1.0;
+	}
+	~ENERGY_MODEL() {}
+
+	bool read_technology_file( char *file_name);
+	bool enabled() const { return _enabled; }
+	// fills the energy fields of result with the energy spent so far by
+	// the routers and links of vnoc;
+	void compute_energy( VNOC *vnoc, RESULT &result, bool print_it);
+	// adds to key everything the energy computed depends on;
+	void add_to_key( CACHE_KEY &key) const;
+};
+
+#endif
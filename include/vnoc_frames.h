@@ -0,0 +1,95 @@
+#ifndef _VNOC_FRAMES_H_
+#define _VNOC_FRAMES_H_
+#include "config.h"
+#include <stdio.h>
+#include <vector>
+
+using namespace std;
+
+class VNOC;
+class ROUTER_ASSIGNMENT;
+class ROUTERS_DISTRIBUTION;
+class ONE_OF_THE_BEST_FLOOR_PLANS;
+
+// number of occupancy levels (from white to black) used to color routers;
+// same scale as in GUI_GRAPHICS::redraw_screen();
+#define FRAME_OCCUPANCY_LEVELS 6
+// cores and extra-links of the layers of a 3D stack are colored by layer,
+// cycling through this many colors;
+#define FRAME_LAYER_COLORS 4
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// FRAME_CORE and FRAME_ROUTER
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// what GUI_GRAPHICS::draw_routers() needs to draw a core and a router,
+// in world (floorplan) coordinates; layer is 0 for the cores of the only
+// floorplan in 2D and 2.5D or of subfloorplan 1 in 3D, 1 for subfloorplan 2
+// in 3D, and so on, and -1 for routers without a core;
+
+class FRAME_CORE {
+ public:
+	float x1, y1, x2, y2;
+	int id; // top-level core id;
+	int layer;
+ public:
+	FRAME_CORE() { x1 = 0; y1 = 0; x2 = 0; y2 = 0; id = -1; layer = 0; }
+	~FRAME_CORE() {}
+};
+
+class FRAME_ROUTER {
+ public:
+	float x, y;
+	int core_id; // -1 if no core is hooked up;
+	int layer;
+	float link_x, link_y; // corner of the core where the extra-link goes;
+ public:
+	FRAME_ROUTER() {
+		x = 0; y = 0; core_id = -1; layer = -1; link_x = 0; link_y = 0;
+	}
+	~FRAME_ROUTER() {}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// FRAME_RECORDER
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// headless alternative to the GUI; every REPORT_STATS_PERIOD, instead of
+// redrawing thru X11, the occupancy of every router is appended to a frame
+// log; the floorplan and the routers positions are written only once, at
+// the beginning of the log; the log can be rendered later, frame by frame,
+// into SVG pictures with render_frames();
+//
+// log format: an 8 chars "VNOCFRM1" tag, 3 ints (cores count, routers
+// count, ary size), 2 floats (bigger side of the floorplan, drawing scale),
+// the FRAME_CORE's and FRAME_ROUTER's, and then, for every frame, a double
+// (time) and one unsigned short (flits in buffers) per router;
+
+class FRAME_RECORDER {
+ private:
+	FILE *_file;
+	long _frames_count;
+	vector<unsigned short> _occupancy; // of the frame being recorded;
+
+ public:
+	FRAME_RECORDER() { _file = 0; _frames_count = 0; }
+	~FRAME_RECORDER() { close(); }
+
+	bool open( char *file_name, VNOC *vnoc,
+		const vector<ONE_OF_THE_BEST_FLOOR_PLANS *> &best_fps, // one per layer;
+		ROUTER_ASSIGNMENT *router_assignment,
+		ROUTERS_DISTRIBUTION *router_distribution);
+	void record_frame( VNOC *vnoc, double time);
+	void close();
+	long frames_count() const { return _frames_count; }
+
+	// offline renderer of a frame log: writes <file_name>-<frame>.svg for
+	// every frame; does not need X11 nor the simulator;
+	static bool render_frames( char *file_name);
+};
+
+#endif
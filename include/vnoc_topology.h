@@ -83,13 +83,19 @@ class TOPOLOGY
 		// simulation after every printing interval; default is false;
 		bool _user_step_by_step; // -user_sbs;
 		double _link_length; // physical link length in um;
+		// everything the simulation prints goes here; simulations that
+		// run concurrently print into logs of their own;
+		FILE *_log;
+		// the trace files, parsed once; by default, by this topology alone;
+		TRACES _own_traces;
+		TRACES *_traces;
 
 	public:
 		TOPOLOGY( long net_size, long inp_buf, long out_buf, long vc_n,
 				  long flit_size, long link_bw, double link_l,
 				  long pipeline_in_link, string trace_file, long seed,
 				  ROUTING_ALGORITHM routing_a, double cycles,
-				  double warmup_cycles, bool use_gui);
+				  double warmup_cycles, bool use_gui, FILE *log = stdout);
 		~TOPOLOGY() {};
 
 		bool check_topology();
@@ -112,6 +118,11 @@ class TOPOLOGY
 		RANDOM_NUMBER_GENERATOR &rng() { return _rng; }
 		bool use_gui() { return _use_gui; }
 		bool user_step_by_step() { return _user_step_by_step; }
+		FILE *log() { return _log; }
+		// packets of a trace file; 0 if it cannot be opened;
+		const TRACE *trace( const string &file_name) {
+			return _traces->get( file_name);
+		}
 
 
 		void set_network_size(long network_size) 
@@ -125,6 +136,8 @@ class TOPOLOGY
 		void set_link_bandwidth(long link_bandwidth) { _link_bandwidth = link_bandwidth; };
 		void set_link_length(double link_length) { _link_length = link_length; };
 		void set_trace_file(string trace_file) { _trace_file = trace_file; };
+		// traces shared with other simulations;
+		void set_traces(TRACES *traces) { _traces = traces; };
 		void set_rng_seed(long rng_seed) {
 			_rng_seed = rng_seed;
 			// now set the actual seed of the internal random gen;
@@ -5,6 +5,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <vector>
+#include <map>
+#include <string>
+#include <mutex>
 
 using namespace std;
 
@@ -39,14 +43,25 @@ void *my_realloc(void *ptr, size_t size);
 //
 ////////////////////////////////////////////////////////////////////////////////
 
+// every generator has a state of its own, so that simulations can run
+// concurrently; its numbers are those random() gives after srandom();
+
 class RANDOM_NUMBER_GENERATOR
 {
  private:
 	long _seed;
+	struct random_data _random_data; // points into _random_state;
+	char _random_state[128];
+	// gauss01() makes two numbers at a time;
+	bool _gauss_recalc;
+	double _gauss_b;
 
  private:
 	double sflat01();
 	double gauss01();
+	// not copyable, as _random_data points into the generator;
+	RANDOM_NUMBER_GENERATOR( const RANDOM_NUMBER_GENERATOR &);
+	RANDOM_NUMBER_GENERATOR &operator=( const RANDOM_NUMBER_GENERATOR &);
  public:
 	RANDOM_NUMBER_GENERATOR(long seed);
 	RANDOM_NUMBER_GENERATOR();
@@ -63,4 +78,115 @@ class RANDOM_NUMBER_GENERATOR
 	void set_seed( long seed);
 };
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// LATENCY_HISTOGRAM
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// constant-memory log-linear histogram (HDR style) used to get latency
+// percentiles without storing the latencies themselves; values are counted
+// in units of 1/HISTOGRAM_UNITS_PER_CYCLE cycles; the first 2^SUB_BITS units
+// have a bucket each, and then every power of two is split in 2^(SUB_BITS-1)
+// buckets; so, any percentile is off by less than 1/2^(SUB_BITS-1) of its
+// value (6% here);
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_UNITS_PER_CYCLE 8
+#define HISTOGRAM_BUCKETS_COUNT \
+	((1 << HISTOGRAM_SUB_BITS) + (64 - HISTOGRAM_SUB_BITS) * (1 << (HISTOGRAM_SUB_BITS - 1)))
+
+class LATENCY_HISTOGRAM
+{
+ private:
+	vector<long> _buckets;
+	long _count;
+	double _sum;
+	double _min_value;
+	double _max_value;
+
+ private:
+	int bucket_of( unsigned long long units) const;
+	unsigned long long bucket_upper_units( int b) const;
+ public:
+	LATENCY_HISTOGRAM() { clear(); }
+	~LATENCY_HISTOGRAM() {}
+
+	void clear();
+	void record( double value);
+	void merge( const LATENCY_HISTOGRAM &histogram);
+	// p is in percents: 50, 95, 99...
+	double percentile( double p) const;
+	long count() const { return _count; }
+	double mean() const { return ( _count > 0) ? _sum / _count : 0.0; }
+	double min_value() const { return _min_value; }
+	double max_value() const { return _max_value; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// FLOW_STATISTICS
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// constant-memory statistics of the packets of one source-destination flow;
+
+class FLOW_STATISTICS
+{
+ public:
+	int src_id; // source IP/core;
+	int des_id; // destination IP/core;
+	int hops; // links traversed from source router to destination router;
+	long packets_count;
+	double latency_sum;
+	double latency_max;
+ public:
+	FLOW_STATISTICS() { 
+		src_id = -1; des_id = -1; hops = 0;
+		packets_count = 0; latency_sum = 0.0; latency_max = 0.0;
+	}
+	~FLOW_STATISTICS() {}
+
+	double avg_latency() const {
+		return ( packets_count > 0) ? latency_sum / packets_count : 0.0;
+	}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// TRACES
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// one packet of a trace file (.trs), whose every line is: injection time,
+// source core, destination core and packet size (flits);
+
+class TRACE_PACKET
+{
+ public:
+	double time;
+	int src_id;
+	int des_id;
+	long packet_size;
+};
+
+typedef vector<TRACE_PACKET> TRACE;
+
+// trace files, parsed once and shared by all the simulations that inject
+// their packets (in a batch, by all the experiments; see batch:); get()
+// may be called concurrently; a trace is never changed once parsed;
+
+class TRACES
+{
+ private:
+	mutex _mutex;
+	map<string, TRACE *> _traces;
+ public:
+	TRACES() {}
+	~TRACES();
+
+	// the packets of file_name, parsed at first call; 0 if it cannot be
+	// opened;
+	const TRACE *get( const string &file_name);
+};
+
 #endif
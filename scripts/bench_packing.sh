@@ -0,0 +1,97 @@
+#!/bin/sh
+# bench of the B*-tree annealing on testcases with many modules; the
+# modules of a testcase (tests/ami49 by default) are copied N times,
+# with their nets and communications, into one testcase of N x modules;
+# every size is annealed with the same number of moves per temperature
+# (times: x modules) and area only, so that its time over the one of
+# the original testcase shows how the time per move grows with the
+# modules; the simulation is kept negligible;
+#
+# usage: scripts/bench_packing.sh [testcase] [copies...]
+# e.g.:  scripts/bench_packing.sh tests/ami49 1 10 20
+# the tiled testcases and their trace files are created under $BENCH_DIR
+# (/tmp/bench_packing by default); run it from the directory of sfra;
+
+TESTCASE=${1:-tests/ami49}
+shift
+COPIES=${*:-1 10 20}
+BENCH_DIR=${BENCH_DIR:-/tmp/bench_packing}
+MOVES=4900 # per temperature;
+
+mkdir -p $BENCH_DIR
+NAME=`basename $TESTCASE`
+MODULES=`grep -c "^MODULE" $TESTCASE.fp`
+MODULES=`expr $MODULES - 1` # the top level module;
+
+for K in $COPIES; do
+	TILED=$BENCH_DIR/${NAME}x$K
+	# (1) copy k of a module or net gets the suffix _k; copy 0 keeps
+	# the names and is the only one connected to the pins of the top
+	# level module;
+	awk -v K=$K -v N=$MODULES '
+		/^MODULE/ { in_module = 1; block = ""; top = 0 }
+		in_module && /TYPE PARENT;/ { top = 1 }
+		in_module && top && /^ NETWORK;/ { in_module = 0; in_network = 1;
+			printf "%s", block; print; next }
+		in_module { block = block $0 "\n";
+			if ( $0 ~ /^ENDMODULE;/) {
+				in_module = 0;
+				for ( k = 0; k < K; k++) {
+					b = block;
+					if ( k > 0) sub( /^MODULE [^;]*/, "&_" k, b);
+					printf "%s", b;
+				}
+			}
+			next }
+		in_network && /^ ENDNETWORK;/ { in_network = 0;
+			for ( k = 0; k < K; k++) printf "%s", rename( network, k);
+			print; next }
+		in_network { network = network $0 "\n"; next }
+		/^COMMUNICATIONS/ { in_volume = 1; print; next }
+		in_volume && /^END;/ { in_volume = 0;
+			for ( k = 0; k < K; k++) {
+				for ( l = 1; l <= volumes; l++) {
+					split( volume[l], f, " ");
+					print f[1] ( k > 0 ? "_" k : "") " " f[2] + k * N " " f[3] + k * N " " f[4];
+				}
+			}
+			print; next }
+		in_volume { volume[++volumes] = $0; next }
+		{ print }
+		function rename( text, k,    lines, n, i, j, w, out, line, s) {
+			if ( k == 0) return text;
+			out = "";
+			n = split( text, lines, "\n");
+			for ( i = 1; i < n; i++) {
+				j = split( lines[i], w, " ");
+				line = "";
+				for ( s = 1; s <= j; s++) {
+					if ( s == 1 && lines[i] ~ /^  c_/) {
+						line = "  " w[s] "_" k;
+					} else if ( s == 2 && lines[i] ~ /^  c_/) {
+						line = line " " w[s] "_" k;
+					} else if ( w[s] ~ /;$/) {
+						sub( /;$/, "_" k ";", w[s]);
+						line = line ( line == "" ? "    " : " ") w[s];
+					} else {
+						line = line ( line == "" ? "    " : " ") w[s] "_" k;
+					}
+				}
+				out = out line "\n";
+			}
+			return out;
+		}
+	' $TESTCASE.fp > $TILED.fp
+
+	# (2) trace files of the tiled testcase;
+	if [ ! -f $TILED.trs ]; then
+		./sfra file: $TILED TESTCASE: 1 > /dev/null
+	fi
+
+	# (3) the annealing;
+	TIMES=`expr $MOVES / \( $MODULES \* $K \)`
+	echo "$NAME x $K: `expr $MODULES \* $K` modules, times: $TIMES"
+	./sfra name: bench_packing file: $TILED cycles: 10 warmup: 1 n_fps: 1 n_best: 1 \
+		mode: 2D alpha: 1 outline: 0.3 seed: 1 times: $TIMES local: 6 verbose: 0 threads: 1 | \
+		grep -a "moves\|walltime"
+done
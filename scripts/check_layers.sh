@@ -0,0 +1,20 @@
+#!/bin/sh
+# regression run of "layers:" larger than the cores of the testcase;
+# sfra must reject it with an error, and not crash on the empty layers;
+#
+# usage: scripts/check_layers.sh [testcase] [layers]
+# e.g.:  scripts/check_layers.sh tests/apte 9
+# run it from the directory of sfra;
+
+TESTCASE=${1:-tests/apte}
+LAYERS=${2:-9}
+
+OUTPUT=`./sfra name: check_layers file: $TESTCASE cycles: 100 warmup: 10 \
+	n_fps: 1 n_best: 1 mode: 3D layers: $LAYERS times: 1 verbose: 0`
+STATUS=$?
+echo "$OUTPUT" | grep -a "Error:"
+if [ $STATUS -ne 1 ] || ! echo "$OUTPUT" | grep -aq "Error:.*layers"; then
+	echo "FAILED: layers: $LAYERS on $TESTCASE exited with $STATUS"
+	exit 1
+fi
+echo "passed"
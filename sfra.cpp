@@ -9,6 +9,9 @@
 #include "vnoc_topology.h"
 #include "sfra.h"
 #include "sfra_hungarian.h"
+#include "sfra_estimator.h"
+#include "sfra_refine.h"
+#include "sfra_cache.h"
 #include "vnoc_app.h"
 #include "fp_btree.h"
 #include "fp_sa.h"
@@ -139,21 +142,123 @@ double ROUTER_ASSIGNMENT::extralink_by_id(int id)
 
 void ROUTER_ASSIGNMENT::clear_assignments()
 {
-	// clear all assignments;
+	// clear all assignments; routers without a core have no extra-link;
 	for ( int y = 0; y < _n_rows; y++) {
 		for ( int x = 0; x < _n_columns; x++) {
 			_array_ids[x][y] = -1;
+			_array_extralinks[x][y] = 0.0;
 		}
 	}
 	_total_extralinks = 0.0;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// PIPELINED_SIMULATIONS
+//
+////////////////////////////////////////////////////////////////////////////////
+
+PIPELINED_SIMULATIONS::~PIPELINED_SIMULATIONS()
+{
+	if ( router_assignment) delete router_assignment;
+	if ( router_distribution) delete router_distribution;
+	if ( assignment_log) fclose( assignment_log);
+	for ( int j = 0; j < logs.size(); j++) {
+		if ( logs[j]) fclose( logs[j]);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// TESTCASE_INPUTS
+//
+////////////////////////////////////////////////////////////////////////////////
+
+TESTCASE_INPUTS::~TESTCASE_INPUTS()
+{
+	map<string, NETLIST *>::iterator it;
+	for ( it = _netlists.begin(); it != _netlists.end(); it++) {
+		delete it->second;
+	}
+	for ( it = _netlists_2d.begin(); it != _netlists_2d.end(); it++) {
+		delete it->second;
+	}
+}
+
+const NETLIST *TESTCASE_INPUTS::netlist( SFRA *sfra, char *inputfile,
+	float scale, bool inflated_for_2d)
+{
+	// the .fp testcase is parsed only once; every floorplan created
+	// afterwards only references the netlist;
+	char key[BUFFER_SIZE + 64];
+	sprintf( key, "%s %.9g %.9g", inputfile, scale,
+		sfra->testcase_creation() ? sfra->testcase_multiplier() : 0.0);
+	lock_guard<mutex> lock( _mutex);
+	NETLIST *&netlist = _netlists[ key];
+	if ( netlist == 0) {
+		netlist = new NETLIST();
+		netlist->read( inputfile, scale, sfra);
+	}
+	if ( !inflated_for_2d) {
+		return netlist;
+	}
+
+	// every core - regardless of its initial size - is expanded with a 
+	// constant amount of area dedicated to implementing the router and
+	// network interface;
+	NETLIST *&netlist_2d = _netlists_2d[ key];
+	if ( netlist_2d == 0) {
+		netlist_2d = new NETLIST( *netlist);
+		for ( int id = 0; id < netlist_2d->modules_N; id++) {
+			netlist_2d->inflate_core( id, 1);
+		}
+	}
+	return netlist_2d;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // SFRA - means simultaneous floorplanning and router assignment;
 //
 ////////////////////////////////////////////////////////////////////////////////
 
+// log of work done concurrently with other work; what and i only name
+// it in the error message;
+static FILE *new_log( const char *what, int i)
+{
+	FILE *log = tmpfile();
+	if ( log == 0) {
+		printf("Error:\tCannot create the log of %s %d.\n", what, i);
+		exit(1);
+	}
+	return log;
+}
+
+// prints what was printed into log into to and closes it;
+static void print_and_close_log( FILE *log, FILE *to)
+{
+	char buffer[4096];
+	rewind( log);
+	size_t n = 0;
+	while ( (n = fread( buffer, 1, sizeof( buffer), log)) > 0) {
+		fwrite( buffer, 1, n, to);
+	}
+	fclose( log);
+}
+
+SFRA::~SFRA()
+{
+	if ( !_shared) {
+		if ( _inputs) delete _inputs;
+		if ( _thread_pool) delete _thread_pool;
+	}
+	if ( _cache && !_shared_cache) delete _cache;
+	map<int, PIPELINED_SIMULATIONS *>::iterator it;
+	for ( it = _pipelined_simulations.begin(); it != _pipelined_simulations.end(); it++) {
+		delete it->second;
+	}
+}
+
 bool SFRA::parse_command_arguments( int argc, char *argv[]) 
 {
 	bool result = true;
@@ -181,14 +286,30 @@ bool SFRA::parse_command_arguments( int argc, char *argv[])
 		//printf(" [pipe_link:]\tNumber of pipeline stages per link - 0\n");
 		printf(" [routing_a:]\tRouting algorithm. Must be XY or TXY - XY\n");
 		printf(" [extra:]\tExtra-links timing factor. Use 0 to disable them - 1\n");
+		printf(" [energy:]\tTechnology file of the routers/links energy model; reports\n\t\tenergy per flit and average power - disabled\n");
+		printf(" [activity]\tExport routers/links activity time series and heatmaps\n\t\t(.act, .csv, .json) to results\\ - disabled\n");
 		printf("FRAMEWORK'S TOP-LEVEL LOOP:\n");
 		printf(" [mode:]\tArchitecture selection, 2D, 3D or 2.5D - 2.5D\n");
 		printf(" [n_fps:]\tNumber of floorplans to try (attempts) - 10\n");
 		printf(" [n_best:]\tNumber of best floorplans to be simulated - 3\n");
+		printf(" [n_sim:]\tPre-screen the bests list with an analytical latency model and\n\t\tsimulate only the n_sim best of them; 0 simulates all - 0\n");
+		printf(" [equilibrium:]\tEnd every annealing temperature once the cost of the\n\t\tsolutions reaches equilibrium, and the local search stage\n\t\tonce it stops improving (1), instead of after a fixed\n\t\tnumber of moves (0) - 0\n");
+		printf(" [replicas:]\tAnneal every floorplan with parallel tempering, using this\n\t\tmany replicas at geometrically spaced temperatures; 1 uses\n\t\tthe adaptive single-chain annealing - 1\n");
+		printf(" [outline:]\tAnneal within a fixed square outline with this much whitespace\n\t\t(e.g., 0.3 keeps the aspect ratio under 1.3) instead of\n\t\trejecting floorplans with aspect ratio over 1.3; 0 disables - 0\n");
+		printf(" [noc_weight:]\tWeight of the NoC-aware term (extra-links length and hop\n\t\tdistance of a greedy routers assignment) in the annealing\n\t\tcost of 2D and 2.5D floorplans; 0 disables - 0\n");
+		printf(" [traffic_weight:]\tWeight of comm. volume * hops against extra-links\n\t\twhen refining the routers assignment of 2D and 2.5D\n\t\tfloorplans; 0 disables - 0\n");
+		printf(" [layers:]\tNumber of IP layers stacked around the NoC layer in 3D;\n\t\tthe cores are partitioned k-way among them - 2\n");
+		printf(" [coanneal:]\tIn 3D, anneal all the layers of an attempt concurrently,\n\t\twith this weight on matching their outlines, instead of\n\t\tlayer 1 first; 0 disables - 0\n");
+		printf(" [pipeline]\tIn 2D and 2.5D, assign routers to and simulate the floorplans\n\t\tthat go into the bests list while the other attempts are\n\t\tstill annealing; ignored with gui - disabled\n");
+		printf(" [cache:]\tDirectory of a persistent cache of the annealed floorplans and\n\t\tof the simulation results; runs with the same testcase and\n\t\tparameters take them from it instead - disabled\n");
+		printf(" [batch:]\tFile of experiments, one command line each (e.g., a .run script);\n\t\tthey run concurrently in this process, sharing the parsed\n\t\ttestcases and the threads; no other option but threads: and\n\t\tcache: is needed - disabled\n");
+		printf(" [threads:]\tNumber of threads annealing the attempts concurrently; 0 uses\n\t\tall the cores - 0\n");
 		printf(" [x_ary:]\tExtra routers per dimension - 0\n");
 		printf(" [fp_criteria:]\tCriteria for \"best\" fp's (W-wirelengh, A-area) - A\n");
 		printf(" [gui]\t\tUse the graphical user interface (GUI) - disabled by default\n");
 		printf(" [p:]\t\tGUI pausing behavior per simulation. 0:step-by-step, 1:once at\n\t\tthe end, 2:never pauses - 1\n");
+		printf(" [record]\tRecord routers usage (what the GUI shows) into a frame log in\n\t\tresults\\; works without X11 - disabled\n");
+		printf(" [replay:]\tRender a frame log recorded with \"record\" into .svg pictures\n\t\tand exit; no other option is needed - disabled\n");
 		printf(" [verbose:]\tPrint debugging info, 0 or 1 - 1\n");
 		printf(" [name:]\tOutputs the average latency of all simulations to a file\n\t\tnamed results\\results.txt with a \"simulation name\" tag -\n\t\tdisabled by default\n");
 		printf(" [load:]\tAdjust the injection load by 10,20,30...100 percent (use only\n\t\tmultiples of 10) - 100\n");
@@ -295,6 +416,107 @@ bool SFRA::parse_command_arguments( int argc, char *argv[])
 			i += 2;
 			continue;
 		}
+		if ( !strcmp(argv[i], "n_sim:")) {
+			_n_sim = atoi(argv[i+1]);
+			if (_n_sim < 0 || _n_sim > INT_MAX) { 
+				printf("Error:\tn_sim value must be between [0 %d].\n", INT_MAX);
+				exit(1); 
+			}
+			i += 2;
+			continue;
+		}
+		if ( !strcmp(argv[i], "equilibrium:")) {
+			int equilibrium = atoi(argv[i+1]);
+			if (equilibrium < 0 || equilibrium > 1) { 
+				printf("Error:\tequilibrium value must be 0 or 1.\n");
+				exit(1); 
+			}
+			_equilibrium = ( equilibrium == 1);
+			i += 2;
+			continue;
+		}
+		if ( !strcmp(argv[i], "replicas:")) {
+			_replicas = atoi(argv[i+1]);
+			if (_replicas < 1 || _replicas > 64) { 
+				printf("Error:\treplicas value must be between [1 64].\n");
+				exit(1); 
+			}
+			i += 2;
+			continue;
+		}
+		if ( !strcmp(argv[i], "outline:")) {
+			_outline_whitespace = atof(argv[i+1]);
+			if (_outline_whitespace < 0 || _outline_whitespace > 1) { 
+				printf("Error:\toutline value must be between [0 1].\n");
+				exit(1); 
+			}
+			i += 2;
+			continue;
+		}
+		if ( !strcmp(argv[i], "noc_weight:")) {
+			_noc_weight = atof(argv[i+1]);
+			if (_noc_weight < 0 || _noc_weight > 100) { 
+				printf("Error:\tnoc_weight value must be between [0 100].\n");
+				exit(1); 
+			}
+			i += 2;
+			continue;
+		}
+		if ( !strcmp(argv[i], "traffic_weight:")) {
+			_traffic_weight = atof(argv[i+1]);
+			if (_traffic_weight < 0 || _traffic_weight > 100) { 
+				printf("Error:\ttraffic_weight value must be between [0 100].\n");
+				exit(1); 
+			}
+			i += 2;
+			continue;
+		}
+		if ( !strcmp(argv[i], "layers:")) {
+			_layers = atoi(argv[i+1]);
+			if (_layers < 2 || _layers > 16) { 
+				printf("Error:\tlayers value must be between [2 16].\n");
+				exit(1); 
+			}
+			i += 2;
+			continue;
+		}
+		if ( !strcmp(argv[i], "coanneal:")) {
+			_coanneal_weight = atof(argv[i+1]);
+			if (_coanneal_weight < 0 || _coanneal_weight > 100) { 
+				printf("Error:\tcoanneal value must be between [0 100].\n");
+				exit(1); 
+			}
+			i += 2;
+			continue;
+		}
+		if ( !strcmp(argv[i], "pipeline")) {
+			_pipeline = true;
+			i++; 
+			continue;
+		}
+		if ( !strcmp(argv[i], "cache:")) {
+			if ( _cache) delete _cache;
+			_cache = new RESULTS_CACHE();
+			if ( !_cache->open( argv[i+1])) {
+				exit(1);
+			}
+			i += 2;
+			continue;
+		}
+		if ( !strcmp(argv[i], "batch:")) {
+			strcpy(_batch_file, argv[i+1]);
+			i += 2;
+			continue;
+		}
+		if ( !strcmp(argv[i], "threads:")) {
+			_threads = atoi(argv[i+1]);
+			if (_threads < 0 || _threads > 1024) { 
+				printf("Error:\tthreads value must be between [0 1024].\n");
+				exit(1); 
+			}
+			i += 2;
+			continue;
+		}
 		if ( !strcmp(argv[i], "fp_criteria:")) {
 			_fp_criteria = argv[i+1][0];
 			if (_fp_criteria != 'W' && _fp_criteria != 'A') { 
@@ -483,6 +705,28 @@ bool SFRA::parse_command_arguments( int argc, char *argv[])
 			i++; 
 			continue;
 		}
+		if ( !strcmp(argv[i], "energy:")) {
+			if ( !_energy_model.read_technology_file( argv[i+1])) {
+				exit(1);
+			}
+			i += 2;
+			continue;
+		}
+		if ( !strcmp(argv[i], "record")) {
+			_record_frames = true;
+			i++; 
+			continue;
+		}
+		if ( !strcmp(argv[i], "replay:")) {
+			strcpy(_replay_file, argv[i+1]);
+			i += 2;
+			continue;
+		}
+		if ( !strcmp(argv[i], "activity")) {
+			_export_activity = true;
+			i++; 
+			continue;
+		}
 		if ( !strcmp(argv[i], "TESTCASE:")) {
 			printf("\n\nTHIS MUST BE DONE ONLY IN LINUX\n\n\n");
 			_testcase_creation = true;
@@ -498,54 +742,111 @@ bool SFRA::parse_command_arguments( int argc, char *argv[])
 	return result;
 }
 
-bool SFRA::search_n_fps_floorplans( vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps) 
+TESTCASE_INPUTS *SFRA::testcase_inputs()
 {
-	// here we basically run the floorplanner _n_fps times and record the
-	// _n_best ones only; the best ones will be used outside this function to
-	// simulate them using the vNOC simulator;
+	if ( _inputs == 0) {
+		_inputs = new TESTCASE_INPUTS();
+	}
+	return _inputs;
+}
 
-	bool result = true;
+const NETLIST *SFRA::testcase_netlist( bool inflated_for_2d)
+{
+	return testcase_inputs()->netlist( this, _inputfile, _fp_scale,
+		inflated_for_2d);
+}
 
-	//#########################################
-	//# Try a 'n_fps' number of floorplanings #
-	//#########################################
+void SFRA::share_with_batch( SFRA &batch)
+{
+	// nothing of its own was created yet, but maybe its own cache;
+	assert( _inputs == 0 && _thread_pool == 0);
+	_inputs = batch.testcase_inputs();
+	_thread_pool = batch.thread_pool();
+	_shared = true;
+	if ( batch.results_cache()) {
+		if ( _cache) delete _cache;
+		_cache = batch.results_cache();
+		_shared_cache = true;
+	}
+}
+
+unsigned int SFRA::attempt_seed( int attempt, int trial)
+{
+	// the random numbers stream of every trial of every annealing attempt
+	// is derived from _seed only (splitmix64 finalizer); hence, an attempt
+	// gets the same floorplan no matter which thread anneals it or when;
+	unsigned long long z = (unsigned long long)( _seed) +
+		0x9E3779B97F4A7C15ULL * ( (unsigned long long)( attempt) * 1024 + trial + 1);
+	z = ( z ^ ( z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = ( z ^ ( z >> 27)) * 0x94D049BB133111EBULL;
+	return (unsigned int)( z ^ ( z >> 31));
+}
+
+THREAD_POOL *SFRA::thread_pool()
+{
+	if ( _thread_pool == 0) {
+		_thread_pool = new THREAD_POOL( _threads);
+	}
+	return _thread_pool;
+}
+
+void SFRA::anneal_floorplan_attempt( int i, FILE *log,
+	ONE_OF_THE_BEST_FLOOR_PLANS &attempt)
+{
+	// runs annealing attempt number i, repeating it while the floorplan has
+	// a bad aspect ratio, and copies the accepted floorplan into attempt;
+	// runs concurrently with the other attempts, so everything it prints
+	// goes into log and it does not change any member of this host;
 
 	B_Tree *fp_p;
-	vector<ONE_OF_THE_BEST_FLOOR_PLANS>::iterator pos_Iterator;
-	ONE_OF_THE_BEST_FLOOR_PLANS temp_best_floor_plan;
-	Module_Info temp_module;
 	double fp_aspect_ratio = 1.0;
 	int num_rejected_fps = 0;
 	int THRESHOLD_TRIALS_COUNT_PER_ATTEMPT = 6;
+	float alpha = _alpha;
+	// named after the experiment too, for the experiments of a batch
+	// run at the same time;
+	char debug_file[256];
+	snprintf( debug_file, sizeof( debug_file), "/tmp/btree_debug.%s.%d", _test_name, i);
+
+	// the same testcase, seed and annealing parameters anneal the same
+	// floorplan; an earlier run may have cached it;
+	CACHE_KEY key( "floorplan");
+	long log_offset = 0;
+	if ( _cache) {
+		add_annealing_to_key( key, i);
+		if ( _cache->load_floorplan( key, attempt, log)) {
+			return;
+		}
+		fflush( log);
+		log_offset = ftell( log);
+	}
+
+	while ( true) {
 
-	// loop _n_fps times and run the BTree floorplanner; record the best ones;
-	for ( int i = 1; i <= _n_fps; i++) {
-		
 		//#######################################
 		//# B*Tree representation and Annealing #
 		//#######################################
 
-		printf("\n\n\n\n\n\nFloorplan annealing attempt number: %d\n\n", i);
+		fprintf( log, "\n\n\n\n\n\nFloorplan annealing attempt number: %d\n\n", i);
 
 		// (1) load the original floorplanning and apply the annealing;
-		fp_p = new B_Tree( _alpha);
-		fp_p->set_sfra_host( this); // place a copy of this host in the fp object;
-		fp_p->read( _inputfile, _fp_scale);
-		_modules_N = fp_p->modules_N;
-
-
 		// (2) if 2D mode: expand the cores to allocate routers in the same plane;
-		// every core - regardless of its initial size - is expanded with a constant
-		// amount of area dedicated to implementing the router and network interface;
+		fp_p = new B_Tree( alpha);
+		fp_p->set_sfra_host( this); // place a copy of this host in the fp object;
+		fp_p->set_log( log);
+		fp_p->set_rand_seed( attempt_seed( i, num_rejected_fps));
 		if ( _sim_mode == SIMULATED_ARCH_2D) {
-			printf("\nModules are now expanded for 2D simulation...\n");
-			for ( int id = 0; id < _modules_N; id++) {
-				fp_p->inflate_core( id, 1);
-			}
+			fprintf( log, "\nModules are now expanded for 2D simulation...\n");
+			fp_p->set_netlist( testcase_netlist( true));
+		} else {
+			fp_p->set_netlist( testcase_netlist());
 		}
+
 		if ( _verbose) {
 			fp_p->show_modules(); // debug;
 		}
+		fp_p->set_outline( _outline_whitespace);
+		fp_p->set_noc_cost( _noc_weight, (int) ceil( sqrt( fp_p->modules_N)) + _x_ary);
 		fp_p->init();
 
 
@@ -553,10 +854,13 @@ bool SFRA::search_n_fps_floorplans( vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_f
 		SA_FLOORPLANING sa_floorplanning( fp_p, _times, _local, _term_temp);
 		sa_floorplanning.set_avg_ratio( _avg_ratio);
 		sa_floorplanning.set_lambda( _lambda);
-		sa_floorplanning.set_alpha( _alpha);
+		sa_floorplanning.set_alpha( alpha);
 		sa_floorplanning.set_fp_scale( _fp_scale);
 		sa_floorplanning.set_verbose(_verbose); // print detailed info?
-		sa_floorplanning.run_SA_Floorplaning(); // run floorplanner;
+		sa_floorplanning.set_debug_file( debug_file);
+		sa_floorplanning.set_replicas( _replicas, thread_pool());
+		sa_floorplanning.set_equilibrium( _equilibrium);
+		sa_floorplanning.run_floorplaning(); // run floorplanner;
 
 
 		// (4)
@@ -567,7 +871,10 @@ bool SFRA::search_n_fps_floorplans( vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_f
 		fp_aspect_ratio = ( fp_p->Height >= fp_p->Width) ?
 			( fp_p->Height / fp_p->Width) : ( fp_p->Width / fp_p->Height);
 		// if the aspect ration is higher than 1.3 reject this floorplan;
-		if ( num_rejected_fps <= THRESHOLD_TRIALS_COUNT_PER_ATTEMPT &&
+		// with a fixed outline every annealing is kept instead: the
+		// outline already keeps the aspect ratio low;
+		if ( _outline_whitespace == 0 &&
+			num_rejected_fps <= THRESHOLD_TRIALS_COUNT_PER_ATTEMPT &&
 			fp_aspect_ratio > 1.3) {
 			num_rejected_fps ++;
 			if ( num_rejected_fps == _n_fps) {
@@ -575,393 +882,935 @@ bool SFRA::search_n_fps_floorplans( vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_f
 				// thin and tall rects, the floorplanner cannot find
 				// floorplans with aspect ratio closed to 1; hence, I 
 				// relax the wirelength requirement;
-				_alpha = fmin( _alpha + 0.5, 1);
+				alpha = fmin( alpha + 0.5, 1);
 			}
-			// cancel this attempt and do not count it as part of _n_fps;
+			// cancel this trial and do not count it as part of _n_fps;
 			// however, this should not be done too many (infinite) times;
-			i --;
 			delete fp_p;
 			continue;
 		}
-		// reset num_rejected_fps so that during next "i" iteration we'll
-		// explore more floorplans until we get one with good aspect ratio;
-		num_rejected_fps = 0;
 
+		if ( !fp_p->fits_outline()) {
+			fprintf( log, "\nWarning: attempt %d does not fit the outline %.0f x %.0f.\n",
+				i, fp_p->outline(), fp_p->outline());
+		}
 
-		//#################################################
-		//# Verify if the resulting FP is one of the best #
-		//#################################################
+		// copy all the info from this floorplaning to the attempt's slot;
+		attempt.attempt_n = i;
+		attempt.Width = fp_p->Width;
+		attempt.Height = fp_p->Height;
+		attempt.Area = fp_p->getArea();
+		attempt.WireLength = fp_p->getWireLength();
+		attempt.modules_N = fp_p->modules_N;
+		attempt.modules_info.assign( fp_p->modules_info.begin(),
+			fp_p->modules_info.begin() + fp_p->modules_N);
+		delete fp_p;
+		break;
+	}
 
-		bool this_fp_is_better = false; // should go into bests list;
-		double worst_crit = 0;
-		int pos_best, pos_worst, erase_pos;
-		double aspect_ratio = 1.0;
+	if ( _cache) {
+		_cache->store_floorplan( key, _test_name, attempt, log, log_offset);
+	}
+}
 
-		// start filling the list...
-		if ( best_fps.size() < _n_best) {
-			this_fp_is_better = true; // first three fp's go into list anyway;
-			pos_best = -1; // signals any position, just use push_back;
-		} else {
-			// if list has already a number of n_bests, find the 
-			// "worst of the best" to be potentially replaced with the new one;
-			for ( int pos = 0; pos < best_fps.size(); pos++) {
-				aspect_ratio = 
-					( best_fps[pos].Height >= best_fps[pos].Width) ?
-					( best_fps[pos].Height / best_fps[pos].Width) :
-					( best_fps[pos].Width / best_fps[pos].Height);
-				switch ( _fp_criteria) {
-				case 'W':
-					if (aspect_ratio > 1.3 || best_fps[pos].WireLength > worst_crit) {
-						worst_crit = best_fps[pos].WireLength;
-						pos_worst = pos;
-					}
-					break;
-				case 'A':
-					if (aspect_ratio > 1.3 || best_fps[pos].Area > worst_crit) {
-						worst_crit = best_fps[pos].Area;
-						pos_worst = pos;
-					}
-					break;
-				default:
-					assert(false);
-				}
-			}
-			// compute also the aspect ratio of the worst floorplan in 
-			// current bests list;
+void SFRA::add_annealing_to_key( CACHE_KEY &key, int i)
+{
+	// the testcase and how its netlist is read;
+	_cache->add_file( key, string( _inputfile) + ".fp");
+	key.add_int( _sim_mode);
+	key.add_double( _fp_scale);
+	// the random numbers and the annealing parameters; _n_fps decides
+	// when the cost moves to area, after rejected floorplans; what is
+	// printed depends on _verbose;
+	key.add_int( _seed);
+	key.add_int( i);
+	key.add_int( _n_fps);
+	key.add_double( _alpha);
+	key.add_int( _times);
+	key.add_int( _local);
+	key.add_double( _term_temp);
+	key.add_double( _avg_ratio);
+	key.add_double( _lambda);
+	key.add_int( _replicas);
+	key.add_int( _equilibrium);
+	key.add_double( _outline_whitespace);
+	key.add_double( _noc_weight);
+	key.add_int( _x_ary);
+	key.add_int( _verbose);
+}
+
+bool SFRA::update_bests_list( ONE_OF_THE_BEST_FLOOR_PLANS &attempt,
+	vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps, int *replaced_pos)
+{
+	//#################################################
+	//# Verify if the resulting FP is one of the best #
+	//#################################################
+
+	vector<ONE_OF_THE_BEST_FLOOR_PLANS>::iterator pos_Iterator;
+	bool this_fp_is_better = false; // should go into bests list;
+	double worst_crit = 0;
+	int pos_best, pos_worst, erase_pos;
+	double aspect_ratio = 1.0;
+	double fp_aspect_ratio = ( attempt.Height >= attempt.Width) ?
+		( attempt.Height / attempt.Width) : ( attempt.Width / attempt.Height);
+
+	// start filling the list...
+	if ( best_fps.size() < _n_best) {
+		this_fp_is_better = true; // first three fp's go into list anyway;
+		pos_best = -1; // signals any position, just use push_back;
+	} else {
+		// if list has already a number of n_bests, find the 
+		// "worst of the best" to be potentially replaced with the new one;
+		for ( int pos = 0; pos < best_fps.size(); pos++) {
 			aspect_ratio = 
-				( best_fps[pos_worst].Height >= best_fps[pos_worst].Width) ?
-				( best_fps[pos_worst].Height / best_fps[pos_worst].Width) :
-				( best_fps[pos_worst].Width / best_fps[pos_worst].Height);
-			// after scaning the whole bests list, if the actual is better than
-			// the "worst of the best", assign it to the list;
+				( best_fps[pos].Height >= best_fps[pos].Width) ?
+				( best_fps[pos].Height / best_fps[pos].Width) :
+				( best_fps[pos].Width / best_fps[pos].Height);
 			switch ( _fp_criteria) {
 			case 'W':
-				if ( (fp_p->getWireLength() < best_fps[pos_worst].WireLength) ||
-					(fp_p->getWireLength() < 1.5*best_fps[pos_worst].WireLength &&
-					fp_aspect_ratio < aspect_ratio) ) {
-					pos_best = pos_worst;
-				 	this_fp_is_better = true;
+				if (aspect_ratio > 1.3 || best_fps[pos].WireLength > worst_crit) {
+					worst_crit = best_fps[pos].WireLength;
+					pos_worst = pos;
 				}
 				break;
 			case 'A':
-				if ( (fp_p->getArea() < best_fps[pos_worst].Area) ||
-					(fp_p->getArea() < 1.5*best_fps[pos_worst].Area &&
-					fp_aspect_ratio < aspect_ratio)) {
-					pos_best = pos_worst;
-					this_fp_is_better = true;
+				if (aspect_ratio > 1.3 || best_fps[pos].Area > worst_crit) {
+					worst_crit = best_fps[pos].Area;
+					pos_worst = pos;
 				}
 				break;
-			}
+			default:
+				assert(false);
+			}
+		}
+		// compute also the aspect ratio of the worst floorplan in 
+		// current bests list;
+		aspect_ratio = 
+			( best_fps[pos_worst].Height >= best_fps[pos_worst].Width) ?
+			( best_fps[pos_worst].Height / best_fps[pos_worst].Width) :
+			( best_fps[pos_worst].Width / best_fps[pos_worst].Height);
+		// after scaning the whole bests list, if the actual is better than
+		// the "worst of the best", assign it to the list;
+		switch ( _fp_criteria) {
+		case 'W':
+			if ( (attempt.WireLength < best_fps[pos_worst].WireLength) ||
+				(attempt.WireLength < 1.5*best_fps[pos_worst].WireLength &&
+				fp_aspect_ratio < aspect_ratio) ) {
+				pos_best = pos_worst;
+			 	this_fp_is_better = true;
+			}
+			break;
+		case 'A':
+			if ( (attempt.Area < best_fps[pos_worst].Area) ||
+				(attempt.Area < 1.5*best_fps[pos_worst].Area &&
+				fp_aspect_ratio < aspect_ratio)) {
+				pos_best = pos_worst;
+				this_fp_is_better = true;
+			}
+			break;
 		}
+	}
 
-		if ( this_fp_is_better) {
-			printf("\nAttempt number %d goes to the list of best floorplans...\n" ,i);
+	if ( this_fp_is_better) {
+		fprintf( _out, "\nAttempt number %d goes to the list of best floorplans...\n",
+			attempt.attempt_n);
 
-			// copy all the info from this floorplaning to a temporary container;
-			temp_best_floor_plan.attempt_n = i;
-			temp_best_floor_plan.Width = fp_p->Width;
-			temp_best_floor_plan.Height = fp_p->Height;
-			temp_best_floor_plan.Area = fp_p->getArea();
-			temp_best_floor_plan.WireLength = fp_p->getWireLength();
-			temp_best_floor_plan.modules_N = _modules_N;
-			for ( int id = 0; id < _modules_N; id++) {
-				// copy all info of each module to a temporary module;
-				temp_module.x = fp_p->modules_info[id].x;
-				temp_module.y = fp_p->modules_info[id].y;
-				temp_module.rx = fp_p->modules_info[id].rx;
-				temp_module.ry = fp_p->modules_info[id].ry;
-				temp_module.rotate = fp_p->modules_info[id].rotate;
-				temp_module.flip = fp_p->modules_info[id].flip;
-				// push that temp. module to the vector inside the temp. best fp;
-				temp_best_floor_plan.modules_info.push_back( temp_module);
+		// add this attempt to the vector of best floorplans;
+		if ( replaced_pos) {
+			*replaced_pos = pos_best;
+		}
+		if ( pos_best == -1)
+			best_fps.push_back( attempt);
+		else {
+			fprintf( _out, "\nRemoving attempt number %d from the bests list...\n",
+				best_fps[pos_worst].attempt_n);
+			pos_Iterator = best_fps.begin(); // erase() requires an iterator;
+			erase_pos = 0;
+			while ( erase_pos < pos_worst) {
+				erase_pos ++;
+				pos_Iterator ++;
 			}
+			best_fps.erase( pos_Iterator);
+			best_fps.push_back( attempt);
+		}
+	}
+	return this_fp_is_better;
+}
 
-			// add this temp. to the vector of best floorplans;
-			if ( pos_best == -1)
-				best_fps.push_back( temp_best_floor_plan);
-			else {
-				printf("\nRemoving attempt number %d from the bests list...\n",
-					best_fps[pos_worst].attempt_n);
-				pos_Iterator = best_fps.begin(); // erase() requires an iterator;
-				erase_pos = 0;
-				while ( erase_pos < pos_worst) {
-					erase_pos ++;
-					pos_Iterator ++;
+bool SFRA::search_n_fps_floorplans( vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps) 
+{
+	// here we basically run the floorplanner _n_fps times and record the
+	// _n_best ones only; the best ones will be used outside this function to
+	// simulate them using the vNOC simulator;
+	//
+	// the attempts are independent of each other and are annealed
+	// concurrently on the thread pool; each one prints into a log of its
+	// own and fills a slot of its own; afterwards, the logs are printed and
+	// the bests list is built in attempt order, so that the output and
+	// the results are the same no matter how many threads are used;
+	//
+	// with pipeline, the annealings, the updates of the bests list and the
+	// routers assignments and simulations of the floorplans that go into
+	// it are the tasks of one task graph instead; every update waits for
+	// its attempt and for the previous update, so the bests list is the
+	// same; a floorplan is assigned routers and simulated as soon as it
+	// goes into the list, and its simulations are cancelled if a later
+	// attempt evicts it; annealings go first, so simulations only take the
+	// threads that no annealing needs anymore;
+
+	bool result = true;
+
+	// the netlist is read here, before any thread needs it;
+	_modules_N = testcase_netlist( _sim_mode == SIMULATED_ARCH_2D)->modules_N;
+
+	//#########################################
+	//# Try a 'n_fps' number of floorplanings #
+	//#########################################
+
+	vector<ONE_OF_THE_BEST_FLOOR_PLANS> attempts( _n_fps);
+	vector<FILE *> logs( _n_fps, (FILE *)0);
+	function<void(int)> anneal = [&]( int k) {
+		logs[k] = new_log( "annealing attempt", k + 1);
+		anneal_floorplan_attempt( k + 1, logs[k], attempts[k]);
+	};
+
+	// the gui shows one simulation at a time;
+	if ( !_pipeline || _use_gui) {
+		thread_pool()->run( _n_fps, anneal);
+		for ( int k = 0; k < _n_fps; k++) {
+			// print what the attempt printed while annealing;
+			print_and_close_log( logs[k], _out);
+			update_bests_list( attempts[k], best_fps);
+		}
+		return result;
+	}
+
+	// all the routers assignments are on the same mesh;
+	_ary = (int) ceil( sqrt( _modules_N)) + _x_ary;
+
+	TASK_GRAPH graph;
+	int previous_update = -1;
+	for ( int k = 0; k < _n_fps; k++) {
+		vector<int> dependencies( 1,
+			graph.add_task( [&anneal, k]() { anneal( k); }, vector<int>(), _n_fps + k));
+		if ( previous_update >= 0) {
+			dependencies.push_back( previous_update);
+		}
+		previous_update = graph.add_task( [&, k]() {
+			vector<int> attempts_before;
+			for ( int pos = 0; pos < best_fps.size(); pos++) {
+				attempts_before.push_back( best_fps[pos].attempt_n);
+			}
+			// print what the attempt printed while annealing;
+			print_and_close_log( logs[k], _out);
+			if ( !update_bests_list( attempts[k], best_fps)) {
+				return;
+			}
+			// cancel what is left of the simulations of the evicted one;
+			for ( int i = 0; i < attempts_before.size(); i++) {
+				bool evicted = true;
+				for ( int pos = 0; pos < best_fps.size(); pos++) {
+					evicted = evicted && ( best_fps[pos].attempt_n != attempts_before[i]);
+				}
+				if ( evicted) {
+					PIPELINED_SIMULATIONS *pipelined = _pipelined_simulations[ attempts_before[i]];
+					pipelined->cancelled = true;
+					for ( int j = 0; j < pipelined->tasks.size(); j++) {
+						graph.cancel( pipelined->tasks[j]);
+					}
 				}
-				best_fps.erase( pos_Iterator);
-				best_fps.push_back( temp_best_floor_plan);
 			}
-		}
-
-		// prepare for the next floorplan
-		temp_best_floor_plan.modules_info.clear();
-		delete fp_p;
+			add_pipelined_simulations( graph, attempts[k], 2 * _n_fps + k);
+		}, dependencies, k);
 	}
+	graph.run( thread_pool());
 
 	return result;
 }
 
+void SFRA::add_pipelined_simulations( TASK_GRAPH &graph,
+	ONE_OF_THE_BEST_FLOOR_PLANS &attempt, long priority)
+{
+	// the routers assignment is one task and every simulation point is
+	// another one, that depends on it; each one prints into a log of its
+	// own; attempt stays where it is until the graph is done;
+	PIPELINED_SIMULATIONS *pipelined = new PIPELINED_SIMULATIONS();
+	_pipelined_simulations[ attempt.attempt_n] = pipelined;
+	ONE_OF_THE_BEST_FLOOR_PLANS *best_fp = &attempt;
+	vector< pair<int, int> > points = simulation_points();
+	pipelined->logs.resize( points.size(), (FILE *)0);
+	pipelined->results.resize( points.size());
+
+	int assignment = graph.add_task( [this, pipelined, best_fp]() {
+		double square_side = min( best_fp->Width, best_fp->Height);
+		pipelined->router_distribution = new ROUTERS_DISTRIBUTION(
+			_ary, _ary, 0, 0, square_side/(_ary - 1));
+		pipelined->router_assignment = new ROUTER_ASSIGNMENT( _ary);
+		pipelined->assignment_log = new_log( "routers assignment of attempt",
+			best_fp->attempt_n);
+		assign_routers_for_simulation( *best_fp, *pipelined->router_assignment,
+			square_side, pipelined->assignment_log);
+	}, vector<int>(), priority);
+	pipelined->tasks.push_back( assignment);
+
+	for ( int j = 0; j < points.size(); j++) {
+		pipelined->tasks.push_back( graph.add_task( [this, pipelined, best_fp, points, j]() {
+			// the assignment may have been cancelled already;
+			if ( pipelined->cancelled) {
+				return;
+			}
+			pipelined->logs[j] = new_log( "simulation of attempt", best_fp->attempt_n);
+			pipelined->results[j] = simulate_noc( *pipelined->router_assignment,
+				*pipelined->router_distribution,
+				vector<ONE_OF_THE_BEST_FLOOR_PLANS *>( 1, best_fp),
+				points[j].first, points[j].second, pipelined->logs[j],
+				&pipelined->cancelled);
+		}, vector<int>( 1, assignment), priority));
+	}
+}
+
 bool SFRA::routers_assignment_and_vNOC_simulation(
 	vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps)
 {
 	// here we take every best floorplan and do router assignment - using
 	// the Hungarian algo - and then simulate it using the vNOC simulator;
+	// with pipeline, that was done already while annealing; only the
+	// printouts and the results are taken here, in the same order;
 	bool result = true;
 
 	//###########################################################
 	//# Read the list of best FP's, assign routers and simulate #
 	//###########################################################
 
-	double square_side;	// physical size of the 2-cube mesh;
-	long sx, sy; // starting position of the 2-cube mesh;
+	// if asked, drop from the bests list the floorplans that the analytical
+	// latency model predicts to be worse; they are not worth a simulation;
+	prescreen_best_fps_with_estimator( best_fps);
+
+	// this is a 2 cube, N ary mesh;
+	_ary = (int) ceil( sqrt( _modules_N)) + _x_ary;
+	vector< pair<int, int> > points = simulation_points();
 
 	for ( int pos = 0; pos < best_fps.size(); pos++) {
-		printf("\n\n\n\n\n\nSimulating attempt number: %d.\n\n",
+		fprintf( _out, "\n\n\n\n\n\nSimulating attempt number: %d.\n\n",
 			best_fps[pos].attempt_n);
+		map<int, PIPELINED_SIMULATIONS *>::iterator pipelined =
+			_pipelined_simulations.find( best_fps[pos].attempt_n);
+		if ( pipelined != _pipelined_simulations.end()) {
+			print_and_close_log( pipelined->second->assignment_log, _out);
+			pipelined->second->assignment_log = 0;
+		}
 
 		// PART A
 
 		//#####################
 		//# Router Assignment #
 		//#####################
-	
-		// (1) define a square mesh starting at (0,0)
-		sx = 0; sy = 0;
-		if ( best_fps[pos].Width < best_fps[pos].Height ) { // take max or min?
-			square_side = best_fps[pos].Width;
-		} else { 
-			square_side = best_fps[pos].Height;
-		}
-		
-		// (2) this is a 2 cube, N ary mesh;
-		_ary = (int) ceil( sqrt( _modules_N)) + _x_ary;
-		printf("Mesh type: %dx%d\n\n", _ary, _ary);
 
+		// a square mesh starting at (0,0);
+		double square_side = min( best_fps[pos].Width, best_fps[pos].Height);
 		ROUTERS_DISTRIBUTION router_distribution(
-			_ary, _ary, sx, sy, square_side/(_ary - 1));
-
-		// (3) create an empty router assignment bidimensional table;
+			_ary, _ary, 0, 0, square_side/(_ary - 1));
 		ROUTER_ASSIGNMENT router_assignment( _ary);
+		if ( pipelined == _pipelined_simulations.end()) {
+			assign_routers_for_simulation( best_fps[pos], router_assignment,
+				square_side, _out);
+		}
 
-		printf("Starting routers assignment...\n\n");
-	
-		// corners identification;
-		//		   NW---NE (rx,ry)
-		//		   |	 |
-		//		   |	 |				<- for each modules_info[]
-		//	 (x,y) SW---SE
-		// 
-		// 0,0
-	
-		double dist_a, dist_b, dist_c, dist_d;
-		double min_dist_a, min_dist_b, min_dist_c, min_dist_d;
-		double min_dist;
-		long min_a_x, min_b_x, min_c_x, min_d_x;
-		long min_a_y, min_b_y, min_c_y, min_d_y;
-	
+		// PART B
 
+		//##################
+		//# NOC Simulation #
+		//##################
 
-		// (4) do router assignment using the Hungarian algorithm;
+		for ( int j = 0; j < points.size(); j++) {
+			int buffer_multiplier = points[j].first;
+			RESULT temp_result;
+			if ( pipelined != _pipelined_simulations.end()) {
+				print_and_close_log( pipelined->second->logs[j], _out);
+				pipelined->second->logs[j] = 0;
+				temp_result = pipelined->second->results[j];
+			} else {
+				temp_result = simulate_noc( router_assignment, router_distribution,
+					vector<ONE_OF_THE_BEST_FLOOR_PLANS *>( 1, &best_fps[pos]),
+					buffer_multiplier, points[j].second, _out);
+			}
+			// with a single injection load the latency will be stored at
+			// best_fps[pos].results[0].latency
+			// if a load sweep is done, we'll have results for 10% at results[0],
+			// 20% at results[1], 30% at results[2], ...
+			if ( best_fps[pos].results.size() < buffer_multiplier) {
+				best_fps[pos].results.push_back( RESULTS());
+			}
+			best_fps[pos].results[buffer_multiplier-1].push_back( temp_result);
+		}
+		if ( pipelined != _pipelined_simulations.end()) {
+			delete pipelined->second;
+			_pipelined_simulations.erase( pipelined);
+		}
+	}
 
-		// (a) create Hungarian object;
-		HUNGARIAN_ONE hungarian; // will solve the linear assignment problem;
-		int total_number_of_routers = _ary * _ary;
-		hungarian.initialize( _modules_N, total_number_of_routers); 
+	// the pipelined simulations of floorplans evicted from the bests list,
+	// or not retained by the pre-screening, leave no files behind;
+	map<int, PIPELINED_SIMULATIONS *>::iterator it;
+	for ( it = _pipelined_simulations.begin(); it != _pipelined_simulations.end(); it++) {
+		ONE_OF_THE_BEST_FLOOR_PLANS discarded;
+		discarded.attempt_n = it->first;
+		vector<ONE_OF_THE_BEST_FLOOR_PLANS *> best_fp( 1, &discarded);
+		for ( int j = 0; j < points.size(); j++) {
+			char file_prefix[BUFFER_SIZE];
+			char file_name[BUFFER_SIZE + 16];
+			simulation_file_prefix( file_prefix, best_fp, points[j].second,
+				_inp_buf * points[j].first);
+			const char *suffixes[] = { ".act", "-activity.csv", "-activity.json", ".frames" };
+			for ( int i = 0; i < 4; i++) {
+				sprintf( file_name, "%s%s", file_prefix, suffixes[i]);
+				remove( file_name);
+			}
+		}
+		delete it->second;
+	}
+	_pipelined_simulations.clear();
 
-		// (b) for each core:
-		int max_x = _ary - 1;
-		int max_y = _ary - 1;
-		for ( int id = 0; id < _modules_N; id++) {
-	
-			double dist_a, dist_b, dist_c, dist_d;
-			double min_dist;
-
-			// sweep through the routers...
-			min_dist_a = -1.0; min_dist_b = -1.0; 
-			min_dist_c = -1.0; min_dist_d = -1.0;
-			for ( int y = 0; y < _ary; y++) {
-				for ( int x = 0; x < _ary; x++) {
-					// router at (x,y) location/address now available here;
-						
-					// Hungarian is looking at the corners of the cores, not
-					// their centers
-					dist_a = 
-						fabs( best_fps[pos].modules_info[id].x - (sx+square_side*x/max_x) ) + 
-						fabs( best_fps[pos].modules_info[id].y - (sy+square_side*y/max_y) );
-					dist_b = 
-						fabs( best_fps[pos].modules_info[id].rx - (sx+square_side*x/max_x) ) +
-						fabs( best_fps[pos].modules_info[id].y - (sy+square_side*y/max_y) );
-					dist_c =
-						fabs( best_fps[pos].modules_info[id].x - (sx+square_side*x/max_x) ) +
-						fabs( best_fps[pos].modules_info[id].ry - (sy+square_side*y/max_y) );
-					dist_d =
-						fabs( best_fps[pos].modules_info[id].rx - (sx+square_side*x/max_x) ) +
-						fabs( best_fps[pos].modules_info[id].ry - (sy+square_side*y/max_y) );
-
-					min_dist = min(dist_a, min(dist_b, min(dist_c, dist_d)));
-
-					int j = x + y * (max_x + 1);
-						
-					// min_dist plays the role of cost of assigning
-					// this router to this ip;
-					hungarian.set_cost( id, j, long(min_dist));
-				}
-			}
+	return result;
+}
+
+vector< pair<int, int> > SFRA::simulation_points()
+{
+	vector< pair<int, int> > points;
+	// initially use the original buffers size;
+	int buffer_multiplier = 1;
+	do {
+		// get the injection load from the command line;
+		int load = _inj_load;
+		// if a load sweep is going to be done, start at 10%;
+		if ( _load_sweep == true) {
+			load = 20;
 		}
-		//hungarian.print_hungarian_assignment(); // debug;
+		do {
+			points.push_back( make_pair( buffer_multiplier, load));
+			// prepare for the next simulation if a load sweep is being done;
+			load = load + 10;
+		} while ( _load_sweep && load <= 100);
 
-		// (c) call the actual magyar man;
-		hungarian.run_hungarian();
+		// prepare for the next round if a buffer size sweep is being done also;
+		buffer_multiplier ++;
+	} while ( _buffer_sweep && buffer_multiplier <= 5);
+	return points;
+}
 
-		// (d) get assignments;
-		for ( int id = 0; id < _modules_N; id++) {
-			long assigned_j = hungarian.report_assignment_of( id);
-			// hint: assigned_j = x + y * max_x;
-			int new_x = assigned_j % (max_x + 1);
-			int new_y = assigned_j / (max_x + 1);
+RESULT SFRA::simulate_noc( ROUTER_ASSIGNMENT &router_assignment,
+	ROUTERS_DISTRIBUTION &router_distribution,
+	const vector<ONE_OF_THE_BEST_FLOOR_PLANS *> &best_fps,
+	int buffer_multiplier, int load, FILE *log, const atomic<bool> *cancel)
+{
+	fprintf( log, "Starting NOC simulation of attempt: %d at load %d%%...\n\n",
+		best_fps[0]->attempt_n, load);
+
+	// used only by TOPOLOGY objects;
+	double link_length = BASE_WIRE; // 1000 um;
+
+	// simulations that leave no files behind may be taken from the
+	// results cache; what they print is stored with their result, hence
+	// it goes into a log of its own first;
+	RESULT result;
+	bool cached = ( _cache != 0 && !_use_gui && !_record_frames && !_export_activity);
+	CACHE_KEY key( "simulation");
+	FILE *simulation_log = log;
+	if ( cached) {
+		add_simulation_to_key( key, router_assignment, best_fps,
+			buffer_multiplier, load);
+		if ( _cache->load_result( key, result, log)) {
+			return result;
+		}
+		simulation_log = new_log( "simulation of attempt", best_fps[0]->attempt_n);
+	}
 
-			// now that each core (id) already has a respective router
-			// (new_x and new_y) find the distances for each corner...
-			// corner "SW"
-			dist_a =
-				fabs( best_fps[pos].modules_info[id].x - (sx+square_side*new_x/max_x) ) +
-				fabs( best_fps[pos].modules_info[id].y - (sy+square_side*new_y/max_y) );
-			// corner "SE"
-			dist_b =
-				fabs( best_fps[pos].modules_info[id].rx - (sx+square_side*new_x/max_x) ) +
-				fabs( best_fps[pos].modules_info[id].y - (sy+square_side*new_y/max_y) );
-			// corner "NW"
-			dist_c = 
-				fabs( best_fps[pos].modules_info[id].x - (sx+square_side*new_x/max_x) ) +
-				fabs( best_fps[pos].modules_info[id].ry - (sy+square_side*new_y/max_y) );
-			// corner "NE"
-			dist_d =
-				fabs( best_fps[pos].modules_info[id].rx - (sx+square_side*new_x/max_x) ) +
-				fabs( best_fps[pos].modules_info[id].ry - (sy+square_side*new_y/max_y) );
-	
-			min_dist = ceil( min(dist_a, min(dist_b, min(dist_c, dist_d))));
+	// ctor of VNOC_APPLICATION	does everything; calls the vNOC simulator,
+	// etc.; also puts the statistics of the simulation in result;
+	VNOC_APPLICATION vnoc_app(this, // pass the SFRA object as its host/owner;
+							  &router_assignment, _ary, 
+							  _inp_buf * buffer_multiplier,
+							  _out_buf * buffer_multiplier, 
+							  _vc_n, _flit_size, _link_bw, link_length, 
+							  _pipeline_in_link, _inputfile, _seed,
+							  _routing_a, _cycles, _warmup_cycles, _use_gui,
+							  &router_distribution, _gui_pauses,
+							  best_fps, load, result, simulation_log, cancel);
+	result.load = load;
+	result.buffer_multiplier = buffer_multiplier;
+
+	if ( cached) {
+		// a cancelled simulation has no results;
+		if ( cancel == 0 || !*cancel) {
+			_cache->store_result( key, _test_name, result, simulation_log, 0);
+		}
+		print_and_close_log( simulation_log, log);
+	}
+	return result;
+}
 
-			//...and finally assign this core to that router.
-			if (dist_a <= dist_b && dist_a <= dist_c && dist_a <= dist_d ) {
-				printf("%d [%c] -> Corner 'SW' to router: %d,%d",
-					   id, 48+id, new_x, new_y);
-				router_assignment.assign(new_x, new_y, id, SW, min_dist);
-			} else { // else is needed because 2 or more equal distances might appear;
+void SFRA::add_simulation_to_key( CACHE_KEY &key,
+	ROUTER_ASSIGNMENT &router_assignment,
+	const vector<ONE_OF_THE_BEST_FLOOR_PLANS *> &best_fps,
+	int buffer_multiplier, int load)
+{
+	// the floorplans (in 3D, one per layer) and their routers assignment;
+	for ( int layer = 0; layer < best_fps.size(); layer++) {
+		key.add_floorplan( *best_fps[ layer]);
+	}
+	key.add_router_assignment( router_assignment, _ary);
+	// the traces of the whole application and of every router;
+	char trace_file[BUFFER_SIZE + 16];
+	sprintf( trace_file, "%s.trs", _inputfile);
+	_cache->add_file( key, trace_file);
+	for ( int x = 0; x < _ary; x++) {
+		for ( int y = 0; y < _ary; y++) {
+			sprintf( trace_file, "%s.%d.trs", _inputfile, router_assignment.assigned( x, y));
+			_cache->add_file( key, trace_file);
+		}
+	}
+	// the topology and how it is simulated;
+	key.add_int( _inp_buf * buffer_multiplier);
+	key.add_int( _out_buf * buffer_multiplier);
+	key.add_int( _vc_n);
+	key.add_int( _flit_size);
+	key.add_int( _link_bw);
+	key.add_double( BASE_WIRE);
+	key.add_int( _pipeline_in_link);
+	key.add_int( _seed);
+	key.add_int( _routing_a);
+	key.add_double( _cycles);
+	key.add_double( _warmup_cycles);
+	key.add_int( load);
+	key.add_int( _sim_mode);
+	key.add_double( _extra_links_timing_factor);
+	key.add_int( _verbose);
+	_energy_model.add_to_key( key);
+}
 
-				if (dist_b <= dist_a && dist_b <= dist_c && dist_b <= dist_d ) {
-					printf("%d [%c] -> Corner 'SE' to router: %d,%d",
-						   id, 48+id, new_x, new_y);
-					router_assignment.assign(new_x, new_y, id, SE, min_dist);
-				} else {
+void SFRA::simulation_file_prefix( char *file_prefix,
+	const vector<ONE_OF_THE_BEST_FLOOR_PLANS *> &best_fps,
+	int load, long inp_buf)
+{
+	// activity files and frame logs are named after the attempt, load and 
+	// buffers size, so that sweeps do not overwrite each other;
+	// in 3D, the attempt of every layer;
+	int length = sprintf( file_prefix, "results/%s-attempt%d",
+		_test_name, best_fps[0]->attempt_n);
+	for ( int layer = 1; layer < best_fps.size(); layer++) {
+		length += sprintf( file_prefix + length, "_%d", best_fps[layer]->attempt_n);
+	}
+	sprintf( file_prefix + length, "-load%d-buf%ld", load, inp_buf);
+}
 
-					if (dist_c <= dist_a && dist_c <= dist_b && dist_c <= dist_d ) {
-						printf("%d [%c] -> Corner 'NW' to router: %d,%d",
-							   id, 48+id, new_x, new_y);
-						router_assignment.assign(new_x, new_y, id, NW, min_dist);
-					} else {
+void SFRA::assign_routers_for_simulation( ONE_OF_THE_BEST_FLOOR_PLANS &best_fp,
+	ROUTER_ASSIGNMENT &router_assignment, double square_side, FILE *log)
+{
+	fprintf( log, "Mesh type: %dx%d\n\n", _ary, _ary);
 
-						if (dist_d <= dist_a && dist_d <= dist_b && dist_d <= dist_c ) {
-							printf("%d [%c] -> Corner 'NE' to router: %d,%d",
-								   id, 48+id, new_x, new_y);
-							router_assignment.assign(new_x, new_y, id, NE, min_dist);
-						} else {
-							assert(0); 
+	// do router assignment using the Hungarian algorithm;
+	assign_routers_to_cores( best_fp, router_assignment, square_side, log);
+
+	// printouts;
+	fprintf( log, "\nRouter assignments summary:\n");
+	for ( int y = _ary - 1; y >= 0; y--) {
+		for ( int x = 0; x < _ary; x++) {
+			fprintf( log, "\t%d", router_assignment.assigned(x,y));	
+		}
+		fprintf( log, "\n");
+	}
+	fprintf( log, "Extra-links total: %.01f \n", router_assignment.total_extralinks());
+
+	calculate_average_path_length( &router_assignment, log); // debug;
+
+	fprintf( log, "Link length: %.01f", double( BASE_WIRE));
+	fprintf( log, "\n\n");
+}
+
+// extra-link length from the closest corner of core mi to point (x,y);
+static double corner_distance( const Module_Info &mi, double x, double y)
+{
+	double dist_a = fabs( mi.x - x) + fabs( mi.y - y);
+	double dist_b = fabs( mi.rx - x) + fabs( mi.y - y);
+	double dist_c = fabs( mi.x - x) + fabs( mi.ry - y);
+	double dist_d = fabs( mi.rx - x) + fabs( mi.ry - y);
+	return min(dist_a, min(dist_b, min(dist_c, dist_d)));
+}
+
+void SFRA::assign_routers_to_cores( ONE_OF_THE_BEST_FLOOR_PLANS &best_fp,
+	ROUTER_ASSIGNMENT &router_assignment, double square_side, FILE *log)
+{
+	// assign every core of best_fp to a router of the _ary x _ary mesh that
+	// starts at (0,0) and has square_side as its physical size; used by the
+	// vNOC simulation loop and by the pre-screening of the bests list;
+	long sx = 0, sy = 0; // starting position of the 2-cube mesh;
+
+	if ( log) {
+		fprintf( log, "Starting routers assignment...\n\n");
+	}
+
+	// corners identification;
+	//		   NW---NE (rx,ry)
+	//		   |	 |
+	//		   |	 |				<- for each modules_info[]
+	//	 (x,y) SW---SE
+	// 
+	// 0,0
+
+	double dist_a, dist_b, dist_c, dist_d;
+	double min_dist_a, min_dist_b, min_dist_c, min_dist_d;
+	double min_dist;
+
+	// (a) create Hungarian object;
+	HUNGARIAN_ONE hungarian; // will solve the linear assignment problem;
+	int max_x = _ary - 1;
+	int max_y = _ary - 1;
+
+	// (b) for each core, the costs of its routers, and (c) call the
+	// actual magyar man;
+	vector<const Module_Info *> cores( _modules_N);
+	for ( int id = 0; id < _modules_N; id++) {
+		cores[id] = &best_fp.modules_info[id];
+	}
+	solve_routers_assignment( hungarian, cores, sx, sy, square_side);
+	vector<int> assignment( _modules_N);
+	for ( int id = 0; id < _modules_N; id++) {
+		assignment[id] = hungarian.report_assignment_of( id);
+	}
+
+	// (c') if asked, trade some extra-links for fewer hops between the
+	// routers of the cores that communicate;
+	if ( _traffic_weight > 0) {
+		refine_routers_assignment( cores, assignment, sx, sy, square_side, log);
+	}
+
+	// (d) get assignments;
+	for ( int id = 0; id < _modules_N; id++) {
+		long assigned_j = assignment[id];
+		// hint: assigned_j = x + y * max_x;
+		int new_x = assigned_j % (max_x + 1);
+		int new_y = assigned_j / (max_x + 1);
+
+		// now that each core (id) already has a respective router
+		// (new_x and new_y) find the distances for each corner...
+		// corner "SW"
+		dist_a =
+			fabs( best_fp.modules_info[id].x - (sx+square_side*new_x/max_x) ) +
+			fabs( best_fp.modules_info[id].y - (sy+square_side*new_y/max_y) );
+		// corner "SE"
+		dist_b =
+			fabs( best_fp.modules_info[id].rx - (sx+square_side*new_x/max_x) ) +
+			fabs( best_fp.modules_info[id].y - (sy+square_side*new_y/max_y) );
+		// corner "NW"
+		dist_c = 
+			fabs( best_fp.modules_info[id].x - (sx+square_side*new_x/max_x) ) +
+			fabs( best_fp.modules_info[id].ry - (sy+square_side*new_y/max_y) );
+		// corner "NE"
+		dist_d =
+			fabs( best_fp.modules_info[id].rx - (sx+square_side*new_x/max_x) ) +
+			fabs( best_fp.modules_info[id].ry - (sy+square_side*new_y/max_y) );
+
+		min_dist = ceil( min(dist_a, min(dist_b, min(dist_c, dist_d))));
+
+		//...and finally assign this core to that router.
+		if (dist_a <= dist_b && dist_a <= dist_c && dist_a <= dist_d ) {
+			if ( log) {
+				fprintf( log, "%d [%c] -> Corner 'SW' to router: %d,%d",
+					id, 48+id, new_x, new_y);
+			}
+			router_assignment.assign(new_x, new_y, id, SW, min_dist);
+		} else { // else is needed because 2 or more equal distances might appear;
+
+			if (dist_b <= dist_a && dist_b <= dist_c && dist_b <= dist_d ) {
+				if ( log) {
+					fprintf( log, "%d [%c] -> Corner 'SE' to router: %d,%d",
+						id, 48+id, new_x, new_y);
+				}
+				router_assignment.assign(new_x, new_y, id, SE, min_dist);
+			} else {
+
+				if (dist_c <= dist_a && dist_c <= dist_b && dist_c <= dist_d ) {
+					if ( log) {
+						fprintf( log, "%d [%c] -> Corner 'NW' to router: %d,%d",
+							id, 48+id, new_x, new_y);
+					}
+					router_assignment.assign(new_x, new_y, id, NW, min_dist);
+				} else {
+
+					if (dist_d <= dist_a && dist_d <= dist_b && dist_d <= dist_c ) {
+						if ( log) {
+							fprintf( log, "%d [%c] -> Corner 'NE' to router: %d,%d",
+								id, 48+id, new_x, new_y);
 						}
+						router_assignment.assign(new_x, new_y, id, NE, min_dist);
+					} else {
+						assert(0); 
 					}
 				}
 			}
-			printf(" Extra-link: %.01f\n", min_dist);			
+		}
+		if ( log) {
+			fprintf( log, " Extra-link: %.01f\n", min_dist);
+		}
 
-		} // for; get assignments;
-		if ( _verbose) {
-			hungarian.print_hungarian_assignment(); // debug;
+	} // for; get assignments;
+	if ( log && _verbose) {
+		hungarian.print_hungarian_assignment( log); // debug;
+	}
+}
+
+// with at least ROUTERS_SPARSE_SIZE possible core-router pairs, and at
+// least 25% more routers than cores, every core gets as candidates only
+// its ROUTERS_CANDIDATES nearest routers among those of the windows of
+// (2 * ROUTERS_WINDOW + 1)^2 routers around its corners; the sparse
+// assignment is kept only if the dual variables prove it is also the
+// best dense one (almost always when routers are not scarce), else the
+// dense problem is solved;
+#define ROUTERS_SPARSE_SIZE 16384
+#define ROUTERS_CANDIDATES 16
+#define ROUTERS_WINDOW 2
+
+void SFRA::solve_routers_assignment( HUNGARIAN_ONE &hungarian,
+	const vector<const Module_Info *> &cores,
+	double sx, double sy, double square_side)
+{
+	int cores_count = cores.size();
+	int routers_count = _ary * _ary;
+	int max_x = _ary - 1;
+	int max_y = _ary - 1;
+
+	// (1) sparse problem of the nearest routers;
+	if ( long(cores_count) * routers_count >= ROUTERS_SPARSE_SIZE &&
+		4 * routers_count >= 5 * cores_count) {
+		hungarian.initialize_sparse( cores_count, routers_count, ROUTERS_CANDIDATES);
+		// lower bound of the costs of the routers that are not candidates:
+		// those outside all windows are further than ROUTERS_WINDOW - 0.5
+		// pitches from every corner;
+		vector<double> not_candidate_cost( cores_count);
+		vector<int> seen_by( routers_count, -1);
+		vector< pair<double,int> > near;
+		double pitch = square_side / max_x;
+		for ( int id = 0; id < cores_count; id++) {
+			const Module_Info &mi = *cores[id];
+			int corners_x[2] = { mi.x, mi.rx };
+			int corners_y[2] = { mi.y, mi.ry };
+			near.clear();
+			for ( int c = 0; c < 4; c++) {
+				int cx = lround( (corners_x[c % 2] - sx) / pitch);
+				int cy = lround( (corners_y[c / 2] - sy) / pitch);
+				cx = max( 0, min( max_x, cx));
+				cy = max( 0, min( max_y, cy));
+				for ( int y = max( 0, cy - ROUTERS_WINDOW); y <= min( max_y, cy + ROUTERS_WINDOW); y++) {
+					for ( int x = max( 0, cx - ROUTERS_WINDOW); x <= min( max_x, cx + ROUTERS_WINDOW); x++) {
+						int j = x + y * (max_x + 1);
+						if ( seen_by[j] == id) continue;
+						seen_by[j] = id;
+						near.push_back( make_pair( corner_distance( mi,
+							sx+square_side*x/max_x, sy+square_side*y/max_y), j));
+					}
+				}
+			}
+			int candidates_count = min( ROUTERS_CANDIDATES, int(near.size()));
+			int sorted_count = min( candidates_count + 1, int(near.size()));
+			partial_sort( near.begin(), near.begin() + sorted_count, near.end());
+			for ( int k = 0; k < candidates_count; k++) {
+				hungarian.set_candidate( id, k, near[k].second, near[k].first);
+			}
+			not_candidate_cost[id] = (ROUTERS_WINDOW - 0.5) * pitch;
+			if ( sorted_count > candidates_count) {
+				not_candidate_cost[id] = min( not_candidate_cost[id], near[candidates_count].first);
+			}
 		}
+		bool best = hungarian.run_hungarian();
+		for ( int id = 0; best && id < cores_count; id++) {
+			best = ( hungarian.report_dual_of( id) <= not_candidate_cost[id]);
+		}
+		if ( best) {
+			return;
+		}
+	}
 
-	
-		// (e) printouts;
-		printf("\nRouter assignments summary:\n");
-		for ( int y = _ary - 1; y >= 0; y--) {
+	// (2) dense problem, every core with every router;
+	hungarian.initialize( cores_count, routers_count);
+	for ( int id = 0; id < cores_count; id++) {
+		for ( int y = 0; y < _ary; y++) {
 			for ( int x = 0; x < _ary; x++) {
-				printf("\t%d", router_assignment.assigned(x,y));	
+				// router at (x,y) location/address now available here;
+				// Hungarian is looking at the corners of the cores, not
+				// their centers; the distance plays the role of cost of
+				// assigning this router to this ip;
+				int j = x + y * (max_x + 1);
+				hungarian.set_cost( id, j, corner_distance( *cores[id],
+					sx+square_side*x/max_x, sy+square_side*y/max_y));
 			}
-			printf("\n");
 		}
-		printf("Extra-links total: %.01f \n", router_assignment.total_extralinks());
-
-		calculate_average_path_length( &router_assignment); // debug;
-
- 
-		// PART B
-
-		//##################
-		//# NOC Simulation #
-		//##################
-	
-		// used only by TOPOLOGY objects;
-		double link_length = BASE_WIRE; // 1000 um;
-		//double link_length  = (BTREE_TO_VNOC_SCALE_MULTIPLIER * square_side) / (_ary - 1);
-		printf("Link length: %.01f", link_length);
-		printf("\n\n");
+	}
+	hungarian.run_hungarian();
+}
 
-		// initially use the original buffers size;
-		int buffer_multiplier = 1;
-		do {
+void SFRA::refine_routers_assignment( const vector<const Module_Info *> &cores,
+	vector<int> &assignment, double sx, double sy, double square_side,
+	FILE *log)
+{
+	// tabu search from the Hungarian assignment, on extra-links in router
+	// pitches plus _traffic_weight times comm. volume * hops;
+	int max_x = _ary - 1;
+	int max_y = _ary - 1;
+	double pitch = square_side / max_x;
+	ROUTERS_REFINEMENT refinement;
+	refinement.set_flows( testcase_netlist());
+	refinement.initialize( cores.size(), _ary);
+	for ( int id = 0; id < cores.size(); id++) {
+		for ( int y = 0; y < _ary; y++) {
+			for ( int x = 0; x < _ary; x++) {
+				refinement.set_extralink( id, x + y * (max_x + 1),
+					corner_distance( *cores[id],
+					sx+square_side*x/max_x, sy+square_side*y/max_y) / pitch);
+			}
+		}
+	}
+	double extralinks = refinement.extralinks( assignment);
+	double weighted_hops = refinement.weighted_hops( assignment);
+	refinement.refine( assignment, _traffic_weight, (unsigned int) _seed,
+		thread_pool());
+	if ( log) {
+		fprintf( log, "Traffic-aware refinement: extra-links %.1f -> %.1f pitches, comm. volume * hops %.1f -> %.1f\n\n",
+			extralinks, refinement.extralinks( assignment),
+			weighted_hops, refinement.weighted_hops( assignment));
+	}
+}
 
+void SFRA::prescreen_best_fps_with_estimator(
+	vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps)
+{
+	// rank all floorplans from the bests list with the analytical latency
+	// model of LATENCY_ESTIMATOR and retain only the _n_sim most promising
+	// ones; only those will be simulated with vNOC; this way n_best (and
+	// n_fps) can be much larger at the cost of a few routers assignments;
+	if ( _n_sim <= 0 || _n_sim >= best_fps.size()) {
+		return;
+	}
+	fprintf( _out, "\n\n\n\n\n\nPre-screening %d floorplans with the analytical latency model...\n\n",
+		best_fps.size());
 
-			RESULTS dummy_list;
-			best_fps[pos].results.push_back( dummy_list);
-			// get the injection load from the command line;
-			int load = _inj_load;
-			// if a load sweep is going to be done, start at 10%;
-			if ( _load_sweep == true) {
-				load = 20;
-			}
+	// (1) the flows and their rates are the same for all floorplans;
+	B_Tree *fp_p = new B_Tree( _alpha);
+	fp_p->set_sfra_host( this); // place a copy of this host in the fp object;
+	fp_p->set_log( _out);
+	fp_p->set_netlist( testcase_netlist());
+	LATENCY_ESTIMATOR estimator;
+	estimator.set_sfra_host( this);
+	estimator.set_flows( fp_p);
+	delete fp_p;
+	if ( !estimator.calibrate_injection_rate( _inputfile)) {
+		fprintf( _out, "Warning: trace file %s.trs has no packets; pre-screening skipped.\n",
+			_inputfile);
+		return;
+	}
+	fprintf( _out, "Flows: %d  Injection rate at 100%% load: %.4f flits/cycle  Avg. packet: %.2f flits\n\n",
+		estimator.flows_count(), estimator.injection_rate(),
+		estimator.avg_packet_size());
+
+	// (2) the injection loads that will be simulated; a buffer size sweep
+	// repeats them, but buffers do not enter the analytical model;
+	vector<int> loads;
+	vector< pair<int, int> > points = simulation_points();
+	for ( int j = 0; j < points.size(); j++) {
+		if ( find( loads.begin(), loads.end(), points[j].second) == loads.end()) {
+			loads.push_back( points[j].second);
+		}
+	}
+	sort( loads.begin(), loads.end());
 
+	// (3) routers assignment exactly as for simulation, then estimate at
+	// every simulated load; the floorplans are ranked on the average; links
+	// are as long as the routers pitch of ROUTERS_DISTRIBUTION;
+	vector<PAIR_TWO> ranking;
+	_ary = (int) ceil( sqrt( _modules_N)) + _x_ary;
+	for ( int pos = 0; pos < best_fps.size(); pos++) {
+		double square_side = min( best_fps[pos].Width, best_fps[pos].Height);
+		double link_length = square_side / (_ary - 1);
+		ROUTER_ASSIGNMENT router_assignment( _ary);
+		assign_routers_to_cores( best_fps[pos], router_assignment, square_side, 0);
+
+		// the highest load is estimated last, so that is what gets printed;
+		double latency_sum = 0.0;
+		for ( int j = 0; j < loads.size(); j++) {
+			latency_sum += estimator.estimate(
+				&router_assignment, _ary, loads[j], link_length);
+		}
+		best_fps[pos].estimated_latency = latency_sum / loads.size();
+		fprintf( _out, "Attempt: %d\tEstimated flit latency: %.02lf\tMax channel utilization: %.3f%s\n",
+			best_fps[pos].attempt_n, best_fps[pos].estimated_latency,
+			estimator.max_utilization(), ( estimator.saturated() ? " (saturated)" : ""));
+		if ( _verbose) {
+			estimator.print_estimate( true, _out);
+		}
+		ranking.push_back( PAIR_TWO( pos, best_fps[pos].estimated_latency));
+	}
 
-			do {
-				printf("Starting NOC simulation of attempt: %d at load %d%%...\n\n",
-					   best_fps[pos].attempt_n, load);
+	// (4) retain the _n_sim floorplans with the smallest estimated latency;
+	// stable_sort keeps the bests list order among equal estimates;
+	stable_sort( ranking.begin(), ranking.end());
+	vector <ONE_OF_THE_BEST_FLOOR_PLANS> selected_fps;
+	for ( int k = 0; k < _n_sim; k++) {
+		selected_fps.push_back( best_fps[ ranking[k].id()]);
+		fprintf( _out, "\nAttempt number %d retained for simulation...", 
+			best_fps[ ranking[k].id()].attempt_n);
+	}
+	fprintf( _out, "\n");
+	best_fps.swap( selected_fps);
+}
 
-				_skipped_packets = (100 - load) / 10; // with 100% load;
-				_max_skip_counter = (10 - _skipped_packets);
+void SFRA::run_experiment( vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps)
+{
+	// (A) in 2D and 25D simulation mode, things are simpler; this this 
+	// the way 25D framework was studied for ReConFig'09 paper;
+	if ( _sim_mode == SIMULATED_ARCH_25D ||
+		 _sim_mode == SIMULATED_ARCH_2D) {
 
-				// ctor of VNOC_APPLICATION	does everythingl calls the vNOC
-				// simulator, etc.; also puts the final latency result in
-				// _sketch_latency of sfra;	
-				VNOC_APPLICATION vnoc_app(this, // pass the SFRA object as its host/owner;
-										  &router_assignment, _ary, 
-										  _inp_buf * buffer_multiplier,
-										  _out_buf * buffer_multiplier, 
-										  _vc_n, _flit_size, _link_bw, link_length, 
-										  _pipeline_in_link, _inputfile, _seed,
-										  _routing_a, _cycles, _warmup_cycles, _use_gui,
-										  &router_distribution, _gui_pauses,
-										  &best_fps[pos]);
+		// (2)
+		//#########################################
+		//# Try a 'n_fps' number of floorplanings #
+		//#########################################
 
-				RESULT temp_result;
-				temp_result.load = load;
-				// retrieve latency as final result of the vNOC simulator;
-				temp_result.latency = _sketch_latency;
-				temp_result.packets_per_cycle = _sketch_packets_per_cycle;
-				temp_result.buffer_multiplier = buffer_multiplier;
-				// with a single injection load the latency will be stored at
-				// best_fps[pos].results[0].latency
-				// if a load sweep is done, we'll have results for 10% at results[0],
-				// 20% at results[1], 30% at results[2], ...
-				best_fps[pos].results[buffer_multiplier-1].push_back( temp_result);
+		// try 'n_fps' number of floorplanings; I should have "best_fps" as a 
+		// sketch array inside SFRA;
 
-				// prepare for the next simulation if a load sweep is being done;
-				load = load + 10;
-			} while ( _load_sweep && load <= 100);
+		search_n_fps_floorplans( best_fps);
 
-			// prepare for the next round if a buffer size sweep is being done also;
-			buffer_multiplier ++;
+		// (3)
+		//###########################################################
+		//# Read the list of best FP's, assign routers and simulate #
+		//###########################################################
 
-		} while ( _buffer_sweep && buffer_multiplier <= 5);
+		// next we simulate using vNOC all floorplans from the bests list;
+		// the result of each simulation is stored inside each fp object
+		// from the list;
 
+		fprintf( _out, "\nThe %d best floorplans will be simulated.\n\n", best_fps.size());
+		routers_assignment_and_vNOC_simulation( best_fps);
+	}
+	// (B) in 3D I partition the task graph into one part per layer (2 by
+	// default) using hMetis and floorplan the partitions on their layers;
+	// another layer is used for the homogeneous network;
+	else if ( _sim_mode == SIMULATED_ARCH_3D) {
+	
+		// (2)
+		// -- create top level application graph
+		// -- partition it into one part per layer
+		// -- create sub-floorplans and call floorplanner; do it for n_fps
+		//    and retain n_best;
+		vector< vector <ONE_OF_THE_BEST_FLOOR_PLANS> > best_fps_layers;
+		//search_n_fps_floorplans_3D( best_fps_layers);
+		search_n_fps_floorplans_3D_version2( best_fps_layers);
+		
+		// (3) assign routers to the IP/core from all subfloorplans;
+		// simulated using vNOC;
+		fprintf( _out, "\nThe %d best floorplans will be simulated.\n\n", best_fps_layers[0].size());
+		routers_assignment_and_vNOC_simulation_3D( best_fps_layers);
+		best_fps = best_fps_layers[0];
 	}
-
-	return result;
 }
 
 bool SFRA::calculate_final_results_statistics( int argc,char **argv,
@@ -1021,7 +1870,7 @@ bool SFRA::calculate_final_results_statistics( int argc,char **argv,
 		}
 	}
 
-	printf("RESULTS SUMMARY:\n================\n\n");
+	fprintf( _out, "RESULTS SUMMARY:\n================\n\n");
 
 	// initially use the original buffers size;
 	int buffer_multiplier = 1;
@@ -1037,7 +1886,7 @@ bool SFRA::calculate_final_results_statistics( int argc,char **argv,
 		
 		// index is 0 for a single buffer simulation; in sweep 0->1x, 1->2x, 2->3x...
 		int buf_sweep_i = buffer_multiplier - 1;
-		printf("BUFFERS SIZE: %dx\n\n", buffer_multiplier);
+		fprintf( _out, "BUFFERS SIZE: %dx\n\n", buffer_multiplier);
 		fprintf(p_results_file, "BUFFERS SIZE: %dx\n\n", buffer_multiplier);
 
 		// index is 0 for a single injection load; in sweep 0->10%, 1->20%, 2->30%...
@@ -1058,7 +1907,7 @@ bool SFRA::calculate_final_results_statistics( int argc,char **argv,
 
 			packets_per_cycle_of_min_latency =
 				best_fps[0].results[0][load_sweep_i].packets_per_cycle;
-			printf("INJECTION LOAD: %d%%  packets/cycle: %.4lf \n",
+			fprintf( _out, "INJECTION LOAD: %d%%  packets/cycle: %.4lf \n",
 				   load, packets_per_cycle_of_min_latency);
 			fprintf(p_results_file, "INJECTION LOAD: %d%%  packets/cycle: %.4lf \n",
 					load, packets_per_cycle_of_min_latency);
@@ -1077,12 +1926,26 @@ bool SFRA::calculate_final_results_statistics( int argc,char **argv,
 				// calculate the sum of all latencies (for this load %) 
 				// and minimum;
 				latency_sum += best_fps[pos].results[buf_sweep_i][load_sweep_i].latency;
-				printf("Attempt: %d\tFlit latency: %.02lf\n",
+				fprintf( _out, "Attempt: %d\tFlit latency: %.02lf\n",
 					best_fps[pos].attempt_n, 
 					best_fps[pos].results[buf_sweep_i][load_sweep_i].latency);
 				fprintf(p_results_file, "Attempt: %d\tFlit latency: %.02lf\n",
 					best_fps[pos].attempt_n,
 					best_fps[pos].results[buf_sweep_i][load_sweep_i].latency);
+				// tail of the latency distribution of this attempt;
+				RESULT &this_result = best_fps[pos].results[buf_sweep_i][load_sweep_i];
+				fprintf( _out, "\tp50: %.02lf  p95: %.02lf  p99: %.02lf  max: %.02lf\n",
+					this_result.latency_p50, this_result.latency_p95,
+					this_result.latency_p99, this_result.latency_max);
+				fprintf(p_results_file, "\tp50: %.02lf  p95: %.02lf  p99: %.02lf  max: %.02lf\n",
+					this_result.latency_p50, this_result.latency_p95,
+					this_result.latency_p99, this_result.latency_max);
+				if ( _energy_model.enabled()) {
+					fprintf( _out, "\tenergy/flit: %.02lf pJ  power: %.02lf mW\n",
+						this_result.energy_per_flit, this_result.avg_power);
+					fprintf(p_results_file, "\tenergy/flit: %.02lf pJ  power: %.02lf mW\n",
+						this_result.energy_per_flit, this_result.avg_power);
+				}
 				min_latency = min(min_latency, 
 					best_fps[pos].results[buf_sweep_i][load_sweep_i].latency);
 			}
@@ -1094,11 +1957,11 @@ bool SFRA::calculate_final_results_statistics( int argc,char **argv,
 			}
 			std_deviation = sqrt( squared_deviations_sum / best_fps.size());
 
-			printf("\nAverage flit latency: %.02lf\n", avg_latency);
+			fprintf( _out, "\nAverage flit latency: %.02lf\n", avg_latency);
 			fprintf(p_results_file,"\nAverage flit latency: %.02lf\n", avg_latency);
-			printf("Standard deviation: %.02lf\n", std_deviation);
+			fprintf( _out, "Standard deviation: %.02lf\n", std_deviation);
 			fprintf(p_results_file,"Standard deviation: %.02lf\n", std_deviation);
-			printf("\nMinimum flit latency: %.02lf\n\n\n\n", min_latency);
+			fprintf( _out, "\nMinimum flit latency: %.02lf\n\n\n\n", min_latency);
 			fprintf(p_results_file,"\nMinimum flit latency: %.02lf\n\n\n\n", min_latency);
 			if ( _use_excel) {
 				fprintf(p_excel,"%.02lf\t", min_latency);
@@ -1147,29 +2010,29 @@ bool SFRA::calculate_final_results_statistics( int argc,char **argv,
 void APPLICATION_GRAPH::print_application_graph()
 {
 	// debug;
-	printf("\nApplication graph:");
-	printf("\nmax_nodes_comm_volume: %.2lf", _max_nodes_comm_volume);
-	printf("\nmax_arcs_comm_volume: %.2lf", _max_arcs_comm_volume);
-	printf("\nIP/cores: %d", _nodes.size());
+	fprintf( _sfra->out(), "\nApplication graph:");
+	fprintf( _sfra->out(), "\nmax_nodes_comm_volume: %.2lf", _max_nodes_comm_volume);
+	fprintf( _sfra->out(), "\nmax_arcs_comm_volume: %.2lf", _max_arcs_comm_volume);
+	fprintf( _sfra->out(), "\nIP/cores: %d", _nodes.size());
 	for ( long i = 0; i < _nodes_count; i ++) {
-		printf("\n%d  area: %d  cumul comm vol: %d", i,
+		fprintf( _sfra->out(), "\n%d  area: %d  cumul comm vol: %d", i,
 			_nodes[i].area(), int(_nodes[i].io_comm_volume()));
-		printf("        \tfin:");
+		fprintf( _sfra->out(), "        \tfin:");
 		for ( long k = 0; k < _nodes[i].fanin().size(); k ++) {
-			printf(" %d", _nodes[i].fanin()[k]);
+			fprintf( _sfra->out(), " %d", _nodes[i].fanin()[k]);
 		}
-		printf("\tfout:");
+		fprintf( _sfra->out(), "\tfout:");
 		for ( long k = 0; k < _nodes[i].fanout().size(); k ++) {
-			printf(" %d", _nodes[i].fanout()[k]);
+			fprintf( _sfra->out(), " %d", _nodes[i].fanout()[k]);
 		}
 		//printf("\tcomm_vol: %.1f", _nodes[i].io_comm_volume());
 	}
-	printf("\nArcs: %d", _arcs.size());
+	fprintf( _sfra->out(), "\nArcs: %d", _arcs.size());
 	for ( long j = 0; j < _arcs_count; j ++) {
-		printf("\n%d -- %d    \t%.1f",
+		fprintf( _sfra->out(), "\n%d -- %d    \t%.1f",
 			_arcs[j].src_id(), _arcs[j].des_id(), _arcs[j].comm_volume());
 	}
-	printf("\n");
+	fprintf( _sfra->out(), "\n");
 }
 
 bool APPLICATION_GRAPH::create_nodes_and_arcs( B_Tree *fp_p)
@@ -1212,7 +2075,7 @@ bool APPLICATION_GRAPH::create_nodes_and_arcs( B_Tree *fp_p)
 	return true;
 }
 
-void APPLICATION_GRAPH::init_hmetis_interface()
+void APPLICATION_GRAPH::init_hmetis_interface( int num_partitions)
 {
 	// used for transfering nodes and nets to hmetis interface in
 	// preparation for calling hmetis partitioner; adds in all
@@ -1224,7 +2087,11 @@ void APPLICATION_GRAPH::init_hmetis_interface()
 	int this_node_partition = -1;
 
 	// (1) instatiate the Metis Interface class;
+	if ( _hmetis_interface) {
+		delete _hmetis_interface;
+	}
 	_hmetis_interface = new MetisIntfc( local_num_blocks, local_num_nets);
+	_hmetis_interface->SetThreadPool( _sfra->thread_pool());
 
 	// (2.a) add Modules (i.e., nodes, vertices);
 	for ( int i = 0; i < _nodes_count; i++) {
@@ -1239,7 +2106,7 @@ void APPLICATION_GRAPH::init_hmetis_interface()
 	}
 
 	// (2.b) fix 10% of largest cores into partitions to have
-	// big cores in both partitions; sort IP/cores after their 
+	// big cores in all partitions; sort IP/cores after their 
 	// area and assign them into partitions alternatively;
 	bool fix_some_cores_as_anchors = true;
 	if ( fix_some_cores_as_anchors == true) {
@@ -1248,14 +2115,12 @@ void APPLICATION_GRAPH::init_hmetis_interface()
 			nodes_areas.push_back( PAIR_TWO(i, get_node_area( i)));
 		}
 		sort( nodes_areas.begin(), nodes_areas.end());
-		for ( int i = 0; i < 4; i ++) { // assume there are at least 6 cores;
+		// at least one anchor per partition, and 4 for bi-partitioning;
+		int anchors_count = min( long( max( 4, num_partitions)), _nodes_count);
+		for ( int i = 0; i < anchors_count; i ++) {
 			// Note: take the last (ie largest) corest from sorted list;
 			int id = nodes_areas[ _nodes_count - 1 - i].id();
-			if ( (id % 2) > 0) {
-				_hmetis_interface->setModPartition( id, 1);
-			} else {
-				_hmetis_interface->setModPartition( id, 0);
-			}
+			_hmetis_interface->setModPartition( id, i % num_partitions);
 		}
 	}
 
@@ -1293,7 +2158,7 @@ bool APPLICATION_GRAPH::run_partitioning( int num_partitions)
 	// this is one time deal; later we can perform partitioning as many 
 	// times we want; we'll only change the fraction of fixed nodes in
 	// each partition;
-	init_hmetis_interface();
+	init_hmetis_interface( num_partitions);
 	if ( _sfra->verbose()) {
 		_hmetis_interface->ShowHyperGraph();
 	}
@@ -1305,11 +2170,11 @@ bool APPLICATION_GRAPH::run_partitioning( int num_partitions)
 	if ( _sfra->verbose()) {
 		_hmetis_interface->ShowOptions();
 		_hmetis_interface->ShowHyperGraph();
-		printf("\nPerforming %d-way partitioning...", num_partitions);
+		fprintf( _sfra->out(), "\nPerforming %d-way partitioning...", num_partitions);
 	}
 	_hmetis_interface->Partition( num_partitions);
 	if ( _sfra->verbose()) {
-		printf("\nDone hmetis partitioning.");
+		fprintf( _sfra->out(), "\nDone hmetis partitioning.");
 		//_hmetis_interface->ShowResults();
 	}
 		
@@ -1318,24 +2183,21 @@ bool APPLICATION_GRAPH::run_partitioning( int num_partitions)
 	// into local-host; also record cut_freq of each cut edge;
 	get_hmetis_results();
 	if ( _sfra->verbose()) { 
-		print_graph_partitions(); // debug;
+		print_graph_partitions( num_partitions); // debug;
 	}
+	return true;
 }
 
-void APPLICATION_GRAPH::print_graph_partitions()
+void APPLICATION_GRAPH::print_graph_partitions( int num_partitions)
 {
 
 	_hmetis_interface->ShowResults();
-	int this_partition = 0;
-	printf("\nPartition 1:  ");
-	for ( int i = 0; i < _nodes_count; i++) {
-		if ( _nodes[i].partition() == 0)
-			printf(" %d", i);
-	}
-	printf("\nPartition 2:  ");
-	for ( int i = 0; i < _nodes_count; i++) {
-		if ( _nodes[i].partition() == 1)
-			printf(" %d", i);
+	for ( int k = 0; k < num_partitions; k++) {
+		fprintf( _sfra->out(), "\nPartition %d:  ", k + 1);
+		for ( int i = 0; i < _nodes_count; i++) {
+			if ( _nodes[i].partition() == k)
+				fprintf( _sfra->out(), " %d", i);
+		}
 	}
 }
 
@@ -1343,14 +2205,41 @@ void APPLICATION_GRAPH::print_graph_partitions()
 //
 // 3D related functions; most of them are developed from those used for
 // 2D and 25D above; howver, in 3D architecture we first partition the 
-// task graph into 2 and do floorplanning on each separately;
+// task graph into one part per layer (2 by default) and do floorplanning
+// on each separately;
 //
 ////////////////////////////////////////////////////////////////////////////////
 
+void SFRA::set_magic_mappings( const vector<int> &partition)
+{
+	// construct the magic mappings between top-level floorplan
+	// modules ids and the ids inside the subfloorplans; need these mappings
+	// to be able to jump from ones to the others for assignment and then for 
+	// vNOC simulation purposes;
+	// let's say that in the top level we have 10 and subfloorplan 1 has 5 
+	// cores out of the 10; 
+	// _magic_topid_to_subid = {0 -1 -1 1 2 -1 -1 -1 3 4}; top-level node
+	// id 9 corresponds to subfloorplan node id 4;
+	// _magic_subid_to_topid[0] = {0 3 4 8 9};
+	_magic_topid_to_subid.clear();
+	_magic_subid_to_topid.assign( _layers, vector<int>());
+	for ( int i = 0; i < partition.size(); i ++) {
+		vector<int> &subid_to_topid = _magic_subid_to_topid[ partition[i]];
+		_magic_topid_to_subid.push_back( subid_to_topid.size());
+		subid_to_topid.push_back( i);
+	}
+	// an empty subfloorplan cannot be floorplanned;
+	for ( int layer = 0; layer < _layers; layer ++) {
+		if ( _magic_subid_to_topid[ layer].empty()) {
+			printf("Error:\tNo core was partitioned into layer %d; use fewer layers.\n",
+				layer + 1);
+			exit(1);
+		}
+	}
+}
 
 bool SFRA::search_n_fps_floorplans_3D(
-	vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps1,
-	vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps2) 
+	vector< vector <ONE_OF_THE_BEST_FLOOR_PLANS> > &best_fps_layers) 
 {
 
 	bool result = true;
@@ -1365,35 +2254,43 @@ bool SFRA::search_n_fps_floorplans_3D(
 	// (1) load the original floorplan testcase;
 	fp_p = new B_Tree( _alpha);
 	fp_p->set_sfra_host( this); // place a copy of this host in the fp object;
-	fp_p->read( _inputfile, _fp_scale);
+	fp_p->set_log( _out);
+	fp_p->set_netlist( testcase_netlist());
 
 	if ( _verbose) {
 		fp_p->show_modules(); // debug;
 	}
 	fp_p->init();
 
+	// every layer needs at least one core;
+	if ( _layers > fp_p->modules_N) {
+		printf("Error:\tlayers value must be between [2 %d] for this testcase.\n",
+			fp_p->modules_N);
+		exit(1);
+	}
+
 	// Note: in a one time action only create the _application_graph;
 	if ( _application_graph.nodes_count() <= 0) {
-		printf("\nCreate the application_graph...");
+		fprintf( _out, "\nCreate the application_graph...");
 		_application_graph.create_nodes_and_arcs( fp_p);
 		_application_graph.set_host( this);
 		if ( _verbose) {
 			_application_graph.print_application_graph(); // debug;
 		}
-		printf("\nDone create application_graph.\n");
+		fprintf( _out, "\nDone create application_graph.\n");
 	}
 
 
 	//###########################################
-	//# Partition and create 2 sub-floorplans   #
+	//# Partition and create k sub-floorplans   #
 	//###########################################
 	
 	vector<int> partition;
 	int appl_nodes_count = _application_graph.nodes_count();
 	bool use_hmetis = false;
 	if ( use_hmetis == true) {
-		// run hMetis partitioner;
-		_application_graph.run_partitioning( 2); // num_partitions = 2;
+		// run hMetis partitioner (or the built-in one, see config.h);
+		_application_graph.run_partitioning( _layers); // one partition per layer;
 		for ( int i = 0; i < appl_nodes_count; i ++) {
 			partition.push_back( _application_graph.get_node_partition( i));
 		}
@@ -1412,68 +2309,36 @@ bool SFRA::search_n_fps_floorplans_3D(
 		sort( nodes_areas.begin(), nodes_areas.end()); // small->big;
 		for ( int i = 0; i < appl_nodes_count; i ++) {
 			int id = nodes_areas[i].id();
-			if ( (id % 2) > 0) {
-				partition[ id] = 1;
-				//printf("%d(%d): 1 ",id,_application_graph.get_node_area( id));
-			} else {
-				partition[ id] = 0;
-				//printf("%d(%d): 1 ",id,_application_graph.get_node_area( id));
-			}
+			partition[ id] = id % _layers;
+			//printf("%d(%d): %d ",id,_application_graph.get_node_area( id),partition[ id]);
 		}
 	}
 	
 
-	// () construct the magic mappings between top-level floorplan
-	// modules ids and the ids inside the subfloorplans; need these mappings
-	// to be able to jump from ones to the others for assignment and then for 
-	// vNOC simulation purposes;
-	// let's say that in the top level we have 10 and subfloorplan 1 has 5 
-	// cores out of the 10; 
-	// _magic_topid_to_subid = {0 -1 -1 1 2 -1 -1 -1 3 4}; top-level node
-	// id 9 corresponds to subfloorplan node id 4;
-	// _magic_subid_to_topid = {0 3 4 8 9};
-	int counter1_i = 0, counter2_i = 0;
-	for ( int i = 0; i < appl_nodes_count; i ++) {
-		if ( partition[i] == 0) {
-			_magic_topid_to_subid.push_back( counter1_i);
-			_magic_subid1_to_topid.push_back( i);
-			counter1_i ++;
-		} else { // partition[i] == 1;
-			_magic_topid_to_subid.push_back( counter2_i);
-			_magic_subid2_to_topid.push_back( i);
-			counter2_i ++;
-		}				
-	}	
-
-
-	// () create the two subfloorplan objects;
-	B_Tree *fp_p1;
-	B_Tree *fp_p2;
-	fp_p1 = new B_Tree( _alpha);
-	fp_p2 = new B_Tree( _alpha);
-	fp_p1->set_sfra_host( this);
-	fp_p2->set_sfra_host( this);
-
-	fp_p1->create_subfloorplan( 0, fp_p, partition);
-	fp_p2->create_subfloorplan( 1, fp_p, partition);	
+	// () construct the magic mappings;
+	set_magic_mappings( partition);
 
 
 	//#########################################
 	//# Try a 'n_fps' number of floorplanings #
 	//#########################################
 
-	// () best found floorplans will be recorded in the arguments 
-	// best_fps1, best_fps2;
+	// () every layer is floorplanned on its own, and its best found
+	// floorplans are recorded in best_fps_layers[layer];
+	best_fps_layers.resize( _layers);
+	for ( int layer = 0; layer < _layers; layer++) {
+		B_Tree *fp_p_layer = new B_Tree( _alpha);
+		fp_p_layer->set_sfra_host( this);
+		fp_p_layer->set_log( _out);
+		fp_p_layer->create_subfloorplan( layer, fp_p, partition);
 
-	search_n_fps_for_subfloorplan( fp_p1, best_fps1);
- 
-	search_n_fps_for_subfloorplan( fp_p2, best_fps2);
+		search_n_fps_for_subfloorplan( fp_p_layer, best_fps_layers[layer]);
 
+		delete fp_p_layer;
+	}
 
 
 	// () clean-up;
-	delete fp_p1;
-	delete fp_p2;
 	delete fp_p;
 
 	return result;
@@ -1499,14 +2364,16 @@ void SFRA::search_n_fps_for_subfloorplan( B_Tree *fp_p,
 		//# Annealing #
 		//#############
 
-		printf("\n\n\n\n\n\nFloorplan annealing attempt number: %d\n\n", i);
+		fprintf( _out, "\n\n\n\n\n\nFloorplan annealing attempt number: %d\n\n", i);
 
 
 		// (1)
 		_modules_N = fp_p->modules_N; // modules count of this subfloorplan;
+		fp_p->set_rand_seed( attempt_seed( i, num_rejected_fps));
 		if ( _verbose) {
 			fp_p->show_modules(); // debug;
 		}
+		fp_p->set_outline( _outline_whitespace);
 		fp_p->init();
 
 
@@ -1517,7 +2384,9 @@ void SFRA::search_n_fps_for_subfloorplan( B_Tree *fp_p,
 		sa_floorplanning.set_alpha( _alpha);
 		sa_floorplanning.set_fp_scale( _fp_scale);
 		sa_floorplanning.set_verbose(_verbose); // print detailed info?
-		sa_floorplanning.run_SA_Floorplaning(); // run floorplanner;
+		sa_floorplanning.set_replicas( _replicas, thread_pool());
+		sa_floorplanning.set_equilibrium( _equilibrium);
+		sa_floorplanning.run_floorplaning(); // run floorplanner;
 
 
 		// (3)
@@ -1529,8 +2398,10 @@ void SFRA::search_n_fps_for_subfloorplan( B_Tree *fp_p,
 		fp_aspect_ratio = ( fp_p->Height >= fp_p->Width) ?
 			( fp_p->Height / fp_p->Width) : ( fp_p->Width / fp_p->Height);
 
-		// if the aspect ratio is higher than 1.3 reject this floorplan;
-		if ( num_rejected_fps <= THRESHOLD_TRIALS_COUNT_PER_ATTEMPT && 
+		// if the aspect ratio is higher than 1.3 reject this floorplan,
+		// unless there is a fixed outline (see search_n_fps_floorplans);
+		if ( _outline_whitespace == 0 &&
+			num_rejected_fps <= THRESHOLD_TRIALS_COUNT_PER_ATTEMPT && 
 			fp_aspect_ratio > 1.3) {
 			num_rejected_fps ++;
 			if ( num_rejected_fps == _n_fps) {
@@ -1618,7 +2489,7 @@ void SFRA::search_n_fps_for_subfloorplan( B_Tree *fp_p,
 		}
 
 		if ( this_fp_is_better) {
-			printf("\nAttempt number %d goes to the list of best floorplans...\n" ,i);
+			fprintf( _out, "\nAttempt number %d goes to the list of best floorplans...\n" ,i);
 
 			// copy all the info from this floorplaning to a temporary container;
 			temp_best_floor_plan.attempt_n = i;
@@ -1643,7 +2514,7 @@ void SFRA::search_n_fps_for_subfloorplan( B_Tree *fp_p,
 			if ( pos_best == -1)
 				best_fps.push_back( temp_best_floor_plan);
 			else {
-				printf("\nRemoving attempt number %d from the bests list...\n",
+				fprintf( _out, "\nRemoving attempt number %d from the bests list...\n",
 					best_fps[pos_worst].attempt_n);
 				pos_Iterator = best_fps.begin(); // erase() requires an iterator;
 				erase_pos = 0;
@@ -1662,14 +2533,14 @@ void SFRA::search_n_fps_for_subfloorplan( B_Tree *fp_p,
 }
 
 bool SFRA::routers_assignment_and_vNOC_simulation_3D(
-	vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps1,
-	vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps2)
+	vector< vector <ONE_OF_THE_BEST_FLOOR_PLANS> > &best_fps_layers)
 {
-	// here we take every two best floorplans, overlap them and do 
-	// router assignment - using the Hungarian algo - and then simulate 
-	// it using the vNOC simulator;
+	// here we take every stack of best floorplans, one per layer, overlap
+	// them and do router assignment - using the Hungarian algo - and then
+	// simulate it using the vNOC simulator;
 	// the routers mesh NOC is created with dimensions given by maximum
-	// subfloorplan in x and y directions;
+	// subfloorplan in x and y directions; the cores of all layers are
+	// hooked up to it through TSVs;
 	bool result = true;
 
 	//###########################################################
@@ -1679,13 +2550,21 @@ bool SFRA::routers_assignment_and_vNOC_simulation_3D(
 	double square_side;	// physical size of the 2-cube mesh;
 	long sx, sy; // starting position of the 2-cube mesh;
 
-	int best_fps_count = best_fps1.size();
+	int best_fps_count = best_fps_layers[0].size();
 	
 	for ( int pos = 0; pos < best_fps_count; pos++) {
-		printf("\n\n\n\n\n\nSimulating attempt numbers: %d, %d.\n\n",
-			best_fps1[pos].attempt_n, best_fps2[pos].attempt_n);
+		vector<ONE_OF_THE_BEST_FLOOR_PLANS *> stack( _layers);
+		fprintf( _out, "\n\n\n\n\n\nSimulating attempt numbers:");
+		for ( int layer = 0; layer < _layers; layer++) {
+			stack[layer] = &best_fps_layers[layer][pos];
+			fprintf( _out, "%s %d", ( layer > 0) ? "," : "", stack[layer]->attempt_n);
+		}
+		fprintf( _out, ".\n\n");
 
-		_modules_N = best_fps1[pos].modules_N + best_fps2[pos].modules_N;
+		_modules_N = 0;
+		for ( int layer = 0; layer < _layers; layer++) {
+			_modules_N += stack[layer]->modules_N;
+		}
 
 
 		// PART A
@@ -1697,14 +2576,17 @@ bool SFRA::routers_assignment_and_vNOC_simulation_3D(
 
 		// (1) define a square mesh starting at (0,0)
 		sx = 0; sy = 0;
-		double max_width = fmax( best_fps1[pos].Width, best_fps2[pos].Width);
-		double max_height = fmax( best_fps1[pos].Height, best_fps2[pos].Height);
+		double max_width = 0, max_height = 0;
+		for ( int layer = 0; layer < _layers; layer++) {
+			max_width = fmax( max_width, stack[layer]->Width);
+			max_height = fmax( max_height, stack[layer]->Height);
+		}
 		square_side = fmin( max_width, max_height); // take max or min?
 		
 
 		// (2) this is a 2 cube, N ary mesh;
 		_ary = (int) ceil( sqrt( _modules_N)) + _x_ary;
-		printf("Mesh type: %dx%d\n\n", _ary, _ary);
+		fprintf( _out, "Mesh type: %dx%d\n\n", _ary, _ary);
 
 		ROUTERS_DISTRIBUTION router_distribution(
 			_ary, _ary, sx, sy, square_side/(_ary - 1));
@@ -1713,7 +2595,7 @@ bool SFRA::routers_assignment_and_vNOC_simulation_3D(
 		// (3) create an empty router assignment bidimensional table;
 		ROUTER_ASSIGNMENT router_assignment( _ary);
 
-		printf("Starting routers assignment...\n\n");
+		fprintf( _out, "Starting routers assignment...\n\n");
 	
 		// corners identification;
 		//		   NW---NE (rx,ry)
@@ -1724,10 +2606,7 @@ bool SFRA::routers_assignment_and_vNOC_simulation_3D(
 		// 0,0
 	
 		double dist_a, dist_b, dist_c, dist_d;
-		double min_dist_a, min_dist_b, min_dist_c, min_dist_d;
 		double min_dist;
-		long min_a_x, min_b_x, min_c_x, min_d_x;
-		long min_a_y, min_b_y, min_c_y, min_d_y;
 	
 
 
@@ -1736,108 +2615,30 @@ bool SFRA::routers_assignment_and_vNOC_simulation_3D(
 
 		// (a) create Hungarian object;
 		HUNGARIAN_ONE hungarian; // will solve the linear assignment problem;
-		int total_number_of_routers = _ary * _ary;
-		hungarian.initialize( _modules_N, total_number_of_routers); 
-
-
-		// (b) take each core of the two subfloorplans and construct
-		// the hungarian object;
 		int max_x = _ary - 1;
 		int max_y = _ary - 1;
 
-
-		// () process first the cores of subfloorplan 1;
-		int modules_N_1 = best_fps1[pos].modules_N;
-		for ( int id = 0; id < modules_N_1; id++) {
-			double dist_a, dist_b, dist_c, dist_d;
-			double min_dist;
-
-			// sweep through the routers...
-			min_dist_a = -1.0; min_dist_b = -1.0; 
-			min_dist_c = -1.0; min_dist_d = -1.0;
-			for ( int y = 0; y < _ary; y++) {
-				for ( int x = 0; x < _ary; x++) {
-					// router at (x,y) location/address now available here;
-					// Hungarian is looking at the corners of the cores, not
-					// their centers
-					dist_a = 
-						fabs( best_fps1[pos].modules_info[id].x - (sx+square_side*x/max_x) ) + 
-						fabs( best_fps1[pos].modules_info[id].y - (sy+square_side*y/max_y) );
-					dist_b = 
-						fabs( best_fps1[pos].modules_info[id].rx - (sx+square_side*x/max_x) ) +
-						fabs( best_fps1[pos].modules_info[id].y - (sy+square_side*y/max_y) );
-					dist_c =
-						fabs( best_fps1[pos].modules_info[id].x - (sx+square_side*x/max_x) ) +
-						fabs( best_fps1[pos].modules_info[id].ry - (sy+square_side*y/max_y) );
-					dist_d =
-						fabs( best_fps1[pos].modules_info[id].rx - (sx+square_side*x/max_x) ) +
-						fabs( best_fps1[pos].modules_info[id].ry - (sy+square_side*y/max_y) );
-
-					min_dist = min(dist_a, min(dist_b, min(dist_c, dist_d)));
-
-					int j = x + y * (max_x + 1);
-						
-					// min_dist plays the role of cost of assigning
-					// this router to this ip;
-					hungarian.set_cost( id, j, long(min_dist));
-				}
-			}
-		}
-		// () process first the cores of subfloorplan 2;
-		int modules_N_2 = best_fps2[pos].modules_N;
-		for ( int id = 0; id < modules_N_2; id++) {
-			double dist_a, dist_b, dist_c, dist_d;
-			double min_dist;
-
-			// sweep through the routers...
-			min_dist_a = -1.0; min_dist_b = -1.0; 
-			min_dist_c = -1.0; min_dist_d = -1.0;
-			for ( int y = 0; y < _ary; y++) {
-				for ( int x = 0; x < _ary; x++) {
-					// router at (x,y) location/address now available here;
-					// Hungarian is looking at the corners of the cores, not
-					// their centers
-					dist_a = 
-						fabs( best_fps2[pos].modules_info[id].x - (sx+square_side*x/max_x) ) + 
-						fabs( best_fps2[pos].modules_info[id].y - (sy+square_side*y/max_y) );
-					dist_b = 
-						fabs( best_fps2[pos].modules_info[id].rx - (sx+square_side*x/max_x) ) +
-						fabs( best_fps2[pos].modules_info[id].y - (sy+square_side*y/max_y) );
-					dist_c =
-						fabs( best_fps2[pos].modules_info[id].x - (sx+square_side*x/max_x) ) +
-						fabs( best_fps2[pos].modules_info[id].ry - (sy+square_side*y/max_y) );
-					dist_d =
-						fabs( best_fps2[pos].modules_info[id].rx - (sx+square_side*x/max_x) ) +
-						fabs( best_fps2[pos].modules_info[id].ry - (sy+square_side*y/max_y) );
-
-					min_dist = min(dist_a, min(dist_b, min(dist_c, dist_d)));
-
-					int j = x + y * (max_x + 1);
-						
-					// min_dist plays the role of cost of assigning
-					// this router to this ip;
-					// Note: the modules of this second subfloorplan will be indexed as
-					// their index + modules_N_1 in order to distinguish them from modules
-					// of the first subfloorplan; this biased indexing acts anyways inside
-					// the hungarian object;
-					hungarian.set_cost( (id + modules_N_1), j, long(min_dist));
-				}
+		// (b) take each core of all the subfloorplans, and (c) call the
+		// actual magyar man;
+		// Note: the modules of every subfloorplan will be indexed as their
+		// index + the modules count of the layers before it in order to
+		// distinguish them from modules of the other subfloorplans; this
+		// biased indexing acts anyways inside the hungarian object;
+		vector<const Module_Info *> cores;
+		vector<int> top_ids; // top-level id of every core;
+		for ( int layer = 0; layer < _layers; layer++) {
+			for ( int sub_id = 0; sub_id < stack[layer]->modules_N; sub_id++) {
+				cores.push_back( &stack[layer]->modules_info[sub_id]);
+				top_ids.push_back( _magic_subid_to_topid[ layer][ sub_id]);
 			}
 		}
-
-
-
-		// (c) call the actual magyar man;
-		//hungarian.print_hungarian_assignment(); // debug;
-		hungarian.run_hungarian();
-		//hungarian.print_hungarian_assignment(); // debug;
+		solve_routers_assignment( hungarian, cores, sx, sy, square_side);
 
 
 
 		// (d) get assignments;
-
-		// () process first the cores of subfloorplan 1;
-		for ( int id = 0; id < modules_N_1; id++) {
+		for ( int id = 0; id < _modules_N; id++) {
+			const Module_Info &mi = *cores[id];
 			long assigned_j = hungarian.report_assignment_of( id);
 			// hint: assigned_j = x + y * max_x;
 			int new_x = assigned_j % (max_x + 1);
@@ -1847,20 +2648,20 @@ bool SFRA::routers_assignment_and_vNOC_simulation_3D(
 			// (new_x and new_y) find the distances for each corner...
 			// corner "SW"
 			dist_a =
-				fabs( best_fps1[pos].modules_info[id].x - (sx+square_side*new_x/max_x) ) +
-				fabs( best_fps1[pos].modules_info[id].y - (sy+square_side*new_y/max_y) );
+				fabs( mi.x - (sx+square_side*new_x/max_x) ) +
+				fabs( mi.y - (sy+square_side*new_y/max_y) );
 			// corner "SE"
 			dist_b =
-				fabs( best_fps1[pos].modules_info[id].rx - (sx+square_side*new_x/max_x) ) +
-				fabs( best_fps1[pos].modules_info[id].y - (sy+square_side*new_y/max_y) );
+				fabs( mi.rx - (sx+square_side*new_x/max_x) ) +
+				fabs( mi.y - (sy+square_side*new_y/max_y) );
 			// corner "NW"
 			dist_c = 
-				fabs( best_fps1[pos].modules_info[id].x - (sx+square_side*new_x/max_x) ) +
-				fabs( best_fps1[pos].modules_info[id].ry - (sy+square_side*new_y/max_y) );
+				fabs( mi.x - (sx+square_side*new_x/max_x) ) +
+				fabs( mi.ry - (sy+square_side*new_y/max_y) );
 			// corner "NE"
 			dist_d =
-				fabs( best_fps1[pos].modules_info[id].rx - (sx+square_side*new_x/max_x) ) +
-				fabs( best_fps1[pos].modules_info[id].ry - (sy+square_side*new_y/max_y) );
+				fabs( mi.rx - (sx+square_side*new_x/max_x) ) +
+				fabs( mi.ry - (sy+square_side*new_y/max_y) );
 	
 			min_dist = ceil( min(dist_a, min(dist_b, min(dist_c, dist_d))));
 
@@ -1868,96 +2669,28 @@ bool SFRA::routers_assignment_and_vNOC_simulation_3D(
 			// Note: use the top-level id; will later be used inside vNOC to
 			// identify the tol-level core id, accordig to which the trace files,
 			// used to inject packets, were generated;
-			int top_id = _magic_subid1_to_topid[ id];
+			int top_id = top_ids[ id];
 			
 			if (dist_a <= dist_b && dist_a <= dist_c && dist_a <= dist_d ) {
-				printf("%d [%c] -> Corner 'SW' to router: %d,%d",
-					   top_id, 48+top_id, new_x, new_y);
-				router_assignment.assign(new_x, new_y, top_id, SW, min_dist);
-			} else { // else is needed because 2 or more equal distances might appear;
-
-				if (dist_b <= dist_a && dist_b <= dist_c && dist_b <= dist_d ) {
-					printf("%d [%c] -> Corner 'SE' to router: %d,%d",
-						   top_id, 48+top_id, new_x, new_y);
-					router_assignment.assign(new_x, new_y, top_id, SE, min_dist);
-				} else {
-
-					if (dist_c <= dist_a && dist_c <= dist_b && dist_c <= dist_d ) {
-						printf("%d [%c] -> Corner 'NW' to router: %d,%d",
-							   top_id, 48+top_id, new_x, new_y);
-						router_assignment.assign(new_x, new_y, top_id, NW, min_dist);
-					} else {
-
-						if (dist_d <= dist_a && dist_d <= dist_b && dist_d <= dist_c ) {
-							printf("%d [%c] -> Corner 'NE' to router: %d,%d",
-								   top_id, 48+top_id, new_x, new_y);
-							router_assignment.assign(new_x, new_y, top_id, NE, min_dist);
-						} else {
-							assert(0); 
-						}
-					}
-				}
-			}
-			printf(" Extra-link: %.01f\n", min_dist);			
-
-		} // for; get assignments;
-		// () process first the cores of subfloorplan 2;
-		for ( int id = modules_N_1; id < _modules_N; id++) {
-			long assigned_j = hungarian.report_assignment_of( id);
-			// hint: assigned_j = x + y * max_x;
-			int new_x = assigned_j % (max_x + 1);
-			int new_y = assigned_j / (max_x + 1);
-
-			// now that each core (id) already has a respective router
-			// (new_x and new_y) find the distances for each corner...
-			// corner "SW"
-			// Note: here we have to use the subfloorplan module id, derived from
-			// the index used inside the hungarian object;
-			int sub_id = id - modules_N_1;
-			dist_a =
-				fabs( best_fps2[pos].modules_info[sub_id].x - (sx+square_side*new_x/max_x) ) +
-				fabs( best_fps2[pos].modules_info[sub_id].y - (sy+square_side*new_y/max_y) );
-			// corner "SE"
-			dist_b =
-				fabs( best_fps2[pos].modules_info[sub_id].rx - (sx+square_side*new_x/max_x) ) +
-				fabs( best_fps2[pos].modules_info[sub_id].y - (sy+square_side*new_y/max_y) );
-			// corner "NW"
-			dist_c = 
-				fabs( best_fps2[pos].modules_info[sub_id].x - (sx+square_side*new_x/max_x) ) +
-				fabs( best_fps2[pos].modules_info[sub_id].ry - (sy+square_side*new_y/max_y) );
-			// corner "NE"
-			dist_d =
-				fabs( best_fps2[pos].modules_info[sub_id].rx - (sx+square_side*new_x/max_x) ) +
-				fabs( best_fps2[pos].modules_info[sub_id].ry - (sy+square_side*new_y/max_y) );
-	
-			min_dist = ceil( min(dist_a, min(dist_b, min(dist_c, dist_d))));
-
-			//...and finally assign this core to that router.
-			// Note: use the top-level id; will later be used inside vNOC to
-			// identify the tol-level core id, accordig to which the trace files,
-			// used to inject packets, were generated;
-			int top_id = _magic_subid2_to_topid[ sub_id];
-
-			if (dist_a <= dist_b && dist_a <= dist_c && dist_a <= dist_d ) {
-				printf("%d [%c] -> Corner 'SW' to router: %d,%d",
+				fprintf( _out, "%d [%c] -> Corner 'SW' to router: %d,%d",
 					   top_id, 48+top_id, new_x, new_y);
 				router_assignment.assign(new_x, new_y, top_id, SW, min_dist);
 			} else { // else is needed because 2 or more equal distances might appear;
 
 				if (dist_b <= dist_a && dist_b <= dist_c && dist_b <= dist_d ) {
-					printf("%d [%c] -> Corner 'SE' to router: %d,%d",
+					fprintf( _out, "%d [%c] -> Corner 'SE' to router: %d,%d",
 						   top_id, 48+top_id, new_x, new_y);
 					router_assignment.assign(new_x, new_y, top_id, SE, min_dist);
 				} else {
 
 					if (dist_c <= dist_a && dist_c <= dist_b && dist_c <= dist_d ) {
-						printf("%d [%c] -> Corner 'NW' to router: %d,%d",
+						fprintf( _out, "%d [%c] -> Corner 'NW' to router: %d,%d",
 							   top_id, 48+top_id, new_x, new_y);
 						router_assignment.assign(new_x, new_y, top_id, NW, min_dist);
 					} else {
 
 						if (dist_d <= dist_a && dist_d <= dist_b && dist_d <= dist_c ) {
-							printf("%d [%c] -> Corner 'NE' to router: %d,%d",
+							fprintf( _out, "%d [%c] -> Corner 'NE' to router: %d,%d",
 								   top_id, 48+top_id, new_x, new_y);
 							router_assignment.assign(new_x, new_y, top_id, NE, min_dist);
 						} else {
@@ -1966,7 +2699,7 @@ bool SFRA::routers_assignment_and_vNOC_simulation_3D(
 					}
 				}
 			}
-			printf(" Extra-link: %.01f\n", min_dist);			
+			fprintf( _out, " Extra-link: %.01f\n", min_dist);			
 
 		} // for; get assignments;
 
@@ -1977,14 +2710,14 @@ bool SFRA::routers_assignment_and_vNOC_simulation_3D(
 		
 	
 		// (e) printouts;
-		printf("\nRouter assignments summary:\n");
+		fprintf( _out, "\nRouter assignments summary:\n");
 		for ( int y = _ary - 1; y >= 0; y--) {
 			for ( int x = 0; x < _ary; x++) {
-				printf("\t%d", router_assignment.assigned(x,y));	
+				fprintf( _out, "\t%d", router_assignment.assigned(x,y));	
 			}
-			printf("\n");
+			fprintf( _out, "\n");
 		}
-		printf("Extra-links total: %.01f \n", router_assignment.total_extralinks());
+		fprintf( _out, "Extra-links total: %.01f \n", router_assignment.total_extralinks());
 
 		
 		// PART B
@@ -1996,69 +2729,23 @@ bool SFRA::routers_assignment_and_vNOC_simulation_3D(
 		// used only by TOPOLOGY objects;
 		double link_length = BASE_WIRE; // 1000 um;
 		//double link_length = (BTREE_TO_VNOC_SCALE_MULTIPLIER * square_side) / (_ary - 1);
-		printf("Link length: %.01f", link_length);
-		printf("\n\n");
+		fprintf( _out, "Link length: %.01f", link_length);
+		fprintf( _out, "\n\n");
 	
-		// initially use the original buffers size;
-		int buffer_multiplier = 1;
-		do {
-
-
-			RESULTS dummy_list;
-			// Note: I will record vNOC simulation results in the nest_fps1 objects;
-			// these results will represent the results of the 3D architecture 
-			// simulation for the top-level application with cores placed on 
-			// layers 1 and 3;
-			best_fps1[pos].results.push_back( dummy_list);
-			// get the injection load from the command line;
-			int load = _inj_load;
-			// if a load sweep is going to be done, start at 10%;
-			if ( _load_sweep == true) {
-				load = 20;
-			}
-
-
-			do {
-				printf("Starting NOC simulation of attempt: %d at load %d%%...\n\n",
-					   best_fps1[pos].attempt_n, load);
-
-				_skipped_packets = (100 - load) / 10; // with 100% load;
-				_max_skip_counter = (10 - _skipped_packets);
-
-				// ctor of VNOC_APPLICATION	does everythingl calls the vNOC
-				// simulator, etc.; also puts the final latency result in
-				// _sketch_latency of sfra;	
-				VNOC_APPLICATION vnoc_app(this, // pass the SFRA object as its host/owner;
-										  &router_assignment, _ary, 
-										  _inp_buf * buffer_multiplier,
-										  _out_buf * buffer_multiplier, 
-										  _vc_n, _flit_size, _link_bw, link_length, 
-										  _pipeline_in_link, _inputfile, _seed,
-										  _routing_a, _cycles, _warmup_cycles, _use_gui,
-										  &router_distribution, _gui_pauses,
-										  &best_fps1[pos], 
-										  &best_fps2[pos]); // default is null; only in 3D used;
-
-				RESULT temp_result;
-				temp_result.load = load;
-				// retrieve latency as final result of the vNOC simulator;
-				temp_result.latency = _sketch_latency;
-				temp_result.buffer_multiplier = buffer_multiplier;
-				// with a single injection load the latency will be stored at
-				// best_fps[pos].results[0].latency
-				// if a load sweep is done, we'll have results for 10% at results[0],
-				// 20% at results[1], 30% at results[2], ...
-				best_fps1[pos].results[buffer_multiplier-1].push_back( temp_result);
-
-				// prepare for the next simulation if a load sweep is being done;
-				load = load + 10;
-			} while ( _load_sweep && load <= 100);
-
-			// prepare for the next round if a buffer size sweep is being done also;
-			buffer_multiplier ++;
-
-		} while ( _buffer_sweep && buffer_multiplier <= 5);
-
+		vector< pair<int, int> > points = simulation_points();
+		for ( int j = 0; j < points.size(); j++) {
+			int buffer_multiplier = points[j].first;
+			RESULT temp_result = simulate_noc( router_assignment,
+				router_distribution, stack, buffer_multiplier, points[j].second, _out);
+			// Note: I will record vNOC simulation results in the best_fps
+			// objects of the first layer; these results will represent the
+			// results of the 3D architecture simulation for the top-level
+			// application with cores placed on all the layers;
+			if ( best_fps_layers[0][pos].results.size() < buffer_multiplier) {
+				best_fps_layers[0][pos].results.push_back( RESULTS());
+			}
+			best_fps_layers[0][pos].results[buffer_multiplier-1].push_back( temp_result);
+		}
 	}
 
 	return result;
@@ -2066,14 +2753,13 @@ bool SFRA::routers_assignment_and_vNOC_simulation_3D(
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// 3D floorplanning is done on the second layer considering the floorplanning
+// 3D floorplanning is done on the other layers considering the floorplanning
 // already done on the first layer;
 //
 ////////////////////////////////////////////////////////////////////////////////
 
 bool SFRA::search_n_fps_floorplans_3D_version2(
-	vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps1,
-	vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps2) 
+	vector< vector <ONE_OF_THE_BEST_FLOOR_PLANS> > &best_fps_layers) 
 {
 
 	bool result = true;
@@ -2088,35 +2774,43 @@ bool SFRA::search_n_fps_floorplans_3D_version2(
 	// (1) load the original floorplan testcase;
 	fp_p = new B_Tree( _alpha);
 	fp_p->set_sfra_host( this); // place a copy of this host in the fp object;
-	fp_p->read( _inputfile, _fp_scale);
+	fp_p->set_log( _out);
+	fp_p->set_netlist( testcase_netlist());
 
 	if ( _verbose) {
 		fp_p->show_modules(); // debug;
 	}
 	fp_p->init();
 
+	// every layer needs at least one core;
+	if ( _layers > fp_p->modules_N) {
+		printf("Error:\tlayers value must be between [2 %d] for this testcase.\n",
+			fp_p->modules_N);
+		exit(1);
+	}
+
 	// Note: in a one time action only create the _application_graph;
 	if ( _application_graph.nodes_count() <= 0) {
-		printf("\nCreate the application_graph...");
+		fprintf( _out, "\nCreate the application_graph...");
 		_application_graph.create_nodes_and_arcs( fp_p);
 		_application_graph.set_host( this);
 		if ( _verbose) {
 			_application_graph.print_application_graph(); // debug;
 		}
-		printf("\nDone create application_graph.\n");
+		fprintf( _out, "\nDone create application_graph.\n");
 	}
 
 
 	//###########################################
-	//# Partition and create 2 sub-floorplans   #
+	//# Partition and create k sub-floorplans   #
 	//###########################################
 	
 	vector<int> partition;
 	int appl_nodes_count = _application_graph.nodes_count();
 	bool use_hmetis = true;
 	if ( use_hmetis == true) {
-		// run hMetis partitioner;
-		_application_graph.run_partitioning( 2); // num_partitions = 2;
+		// run hMetis partitioner (or the built-in one, see config.h);
+		_application_graph.run_partitioning( _layers); // one partition per layer;
 		for ( int i = 0; i < appl_nodes_count; i ++) {
 			partition.push_back( _application_graph.get_node_partition( i));
 		}
@@ -2135,48 +2829,24 @@ bool SFRA::search_n_fps_floorplans_3D_version2(
 		sort( nodes_areas.begin(), nodes_areas.end()); // small->big;
 		for ( int i = 0; i < appl_nodes_count; i ++) {
 			int id = nodes_areas[i].id();
-			if ( (id % 2) > 0) {
-				partition[ id] = 1;
-				//printf("%d(%d): 1 ",id,_application_graph.get_node_area( id));
-			} else {
-				partition[ id] = 0;
-				//printf("%d(%d): 1 ",id,_application_graph.get_node_area( id));
-			}
+			partition[ id] = id % _layers;
+			//printf("%d(%d): %d ",id,_application_graph.get_node_area( id),partition[ id]);
 		}
 	}
 	
 
-	// () construct the magic mappings between top-level floorplan
-	// modules ids and the ids inside the subfloorplans; need these mappings
-	// to be able to jump from ones to the others for assignment and then for 
-	// vNOC simulation purposes;
-	// let's say that in the top level we have 10 and subfloorplan 1 has 5 
-	// cores out of the 10; 
-	// _magic_topid_to_subid = {0 -1 -1 1 2 -1 -1 -1 3 4}; top-level node
-	// id 9 corresponds to subfloorplan node id 4;
-	// _magic_subid_to_topid = {0 3 4 8 9};
-	int counter1_i = 0, counter2_i = 0;
-	for ( int i = 0; i < appl_nodes_count; i ++) {
-		if ( partition[i] == 0) {
-			_magic_topid_to_subid.push_back( counter1_i);
-			_magic_subid1_to_topid.push_back( i);
-			counter1_i ++;
-		} else { // partition[i] == 1;
-			_magic_topid_to_subid.push_back( counter2_i);
-			_magic_subid2_to_topid.push_back( i);
-			counter2_i ++;
-		}				
-	}
+	// () construct the magic mappings;
+	set_magic_mappings( partition);
 
 
 	//#########################################
 	//# Try a 'n_fps' number of subfloorplans #
 	//#########################################
 
-	search_n_fps_for_subfloorplans_layers_12(
+	search_n_fps_for_subfloorplans_layers(
 		fp_p, // toplevel floorplan;
 		partition,
-		best_fps1, best_fps2);
+		best_fps_layers);
 
 
 	// () clean-up;
@@ -2185,102 +2855,159 @@ bool SFRA::search_n_fps_floorplans_3D_version2(
 	return result;
 }
 
-void SFRA::search_n_fps_for_subfloorplans_layers_12(
+SA_FLOORPLANING *SFRA::new_subfloorplan_annealing( B_Tree *fp_p, int layer,
+	unsigned int seed)
+{
+	char debug_file[256];
+	snprintf( debug_file, sizeof( debug_file), "/tmp/btree_debug.%s.layer%d", _test_name, layer + 1);
+
+	fp_p->set_rand_seed( seed);
+	if ( _verbose) {
+		fp_p->show_modules(); // debug;
+	}
+	fp_p->set_outline( _outline_whitespace);
+	fp_p->init();
+
+	SA_FLOORPLANING *sa_floorplanning =
+		new SA_FLOORPLANING( fp_p, _times, _local, _term_temp);
+	sa_floorplanning->set_avg_ratio( _avg_ratio);
+	sa_floorplanning->set_lambda( _lambda);
+	sa_floorplanning->set_alpha( _alpha);
+	sa_floorplanning->set_fp_scale( _fp_scale);
+	sa_floorplanning->set_verbose(_verbose); // print detailed info?
+	sa_floorplanning->set_debug_file( debug_file);
+	sa_floorplanning->set_equilibrium( _equilibrium);
+	return sa_floorplanning;
+}
+
+void SFRA::anneal_subfloorplan( B_Tree *fp_p, int layer, unsigned int seed)
+{
+	// run floorplaning;
+	SA_FLOORPLANING *sa_floorplanning = new_subfloorplan_annealing( fp_p, layer, seed);
+	sa_floorplanning->set_replicas( _replicas, thread_pool());
+	sa_floorplanning->run_floorplaning(); // run floorplanner;
+	delete sa_floorplanning;
+
+	fp_p->list_information();
+	fp_p->show_tree();
+}
+
+void SFRA::coanneal_subfloorplans( vector<B_Tree *> &fp_layers,
+	int attempt, int trial)
+{
+	// the layers are annealed with the single-chain annealing, one
+	// temperature at a time, and exchange their outlines in between (see
+	// SA_FLOORPLANING::run_co_annealing()); the layers already run
+	// concurrently, so replicas do not apply;
+	vector<SA_FLOORPLANING *> annealings( _layers);
+	for ( int layer = 0; layer < _layers; layer++) {
+		annealings[layer] = new_subfloorplan_annealing( fp_layers[layer],
+			layer, attempt_seed( attempt, trial + layer));
+	}
+	SA_FLOORPLANING::run_co_annealing( annealings, _coanneal_weight, thread_pool());
+	for ( int layer = 0; layer < _layers; layer++) {
+		delete annealings[layer];
+		fp_layers[layer]->list_information();
+		fp_layers[layer]->show_tree();
+	}
+}
+
+void SFRA::search_n_fps_for_subfloorplans_layers(
 	FPlan *fp_toplevel, // top-level floorplan application;
 	vector<int> partition,
-	vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps1,
-	vector <ONE_OF_THE_BEST_FLOOR_PLANS> &best_fps2)
+	vector< vector <ONE_OF_THE_BEST_FLOOR_PLANS> > &best_fps_layers)
 {
 	// () run the floorplanner n_fps times and record n_best ones;
 	// actually it may be more than n_fps in order to seek aspect_ratio
 	// closer to 1;
-	vector<ONE_OF_THE_BEST_FLOOR_PLANS>::iterator pos_Iterator1, pos_Iterator2;
-	ONE_OF_THE_BEST_FLOOR_PLANS temp_best_floor_plan1, temp_best_floor_plan2;
-	Module_Info temp_module;
+	// every attempt floorplans layer 1 first; every other layer is then
+	// floorplanned with its nets to layer 1 anchored to the cores of
+	// layer 1, and without its nets to the other layers; hence, these
+	// layers are independent of each other and are annealed concurrently
+	// on the thread pool; each one prints into a log of its own, printed
+	// afterwards in layer order, so that the output and the results are
+	// the same no matter how many threads are used;
+	// with coanneal, all the layers are annealed at the same time, each
+	// one without its nets to the other layers, as layer 1 is not placed
+	// yet; the outline each one is pushed towards couples them instead;
 	double fp_aspect_ratio = 1.0;
 	int num_rejected_fps = 0;
 	int THRESHOLD_TRIALS_COUNT_PER_ATTEMPT = 6;
+	bool coanneal = ( _coanneal_weight > 0);
+	vector<B_Tree *> fp_layers( _layers, (B_Tree *)0);
+	vector<FILE *> logs( _layers, (FILE *)0);
+	char buffer[4096];
+
+	// a subfloorplan annealed concurrently prints into a log of its own;
+	function<void(int, int)> new_layer = [&]( int layer, int i) {
+		logs[layer] = tmpfile();
+		if ( logs[layer] == 0) {
+			printf("Error:\tCannot create the log of subfloorplan %d.\n", layer + 1);
+			exit(1);
+		}
+		fprintf( logs[layer], "\n\n\n\n\n\nSubFloorplan %d annealing attempt number: %d\n\n",
+			layer + 1, i);
+		fp_layers[layer] = new B_Tree( _alpha);
+		fp_layers[layer]->set_sfra_host( this);
+		fp_layers[layer]->set_log( logs[layer]);
+	};
+	function<void(int)> print_logs = [&]( int first_layer) {
+		for ( int layer = first_layer; layer < _layers; layer++) {
+			// print what the layer printed while annealing;
+			rewind( logs[layer]);
+			size_t n = 0;
+			while ( (n = fread( buffer, 1, sizeof( buffer), logs[layer])) > 0) {
+				fwrite( buffer, 1, n, _out);
+			}
+			fclose( logs[layer]);
+		}
+	};
+
+	best_fps_layers.resize( _layers);
 
 	// loop _n_fps times and run the BTree floorplanner; record the best ones;
 	for ( int i = 1; i <= _n_fps; i++) {
 
+		// seeds of this trial are attempt_seed( i, trial + layer);
+		int trial = _layers * num_rejected_fps;
 
-		// (0) create the subfloorplans on layers 1 and 2;
-
-		B_Tree *fp_p1;
-		fp_p1 = new B_Tree( _alpha);
-		fp_p1->set_sfra_host( this);
-
-		B_Tree *fp_p2;
-		fp_p2 = new B_Tree( _alpha);
-		fp_p2->set_sfra_host( this);
-
-
-		//###############################
-		//# Annealing of subfloorplan 1 #
-		//###############################
-
-		printf("\n\n\n\n\n\nSubFloorplan 1 annealing attempt number: %d\n\n", i);
-
-		// (1.a)
-		fp_p1->create_subfloorplan( 0, fp_toplevel, partition);
-
-		int modules_N_1 = fp_p1->modules_N; // modules count of subfloorplan 1;
-		if ( _verbose) {
-			fp_p1->show_modules(); // debug;
-		}
-		fp_p1->init();
+		if ( coanneal) {
 
-		// (2.a) run floorplaning;
-		SA_FLOORPLANING sa_floorplanning1( fp_p1, _times, _local, _term_temp);
-		sa_floorplanning1.set_avg_ratio( _avg_ratio);
-		sa_floorplanning1.set_lambda( _lambda);
-		sa_floorplanning1.set_alpha( _alpha);
-		sa_floorplanning1.set_fp_scale( _fp_scale);
-		sa_floorplanning1.set_verbose(_verbose); // print detailed info?
-		sa_floorplanning1.run_SA_Floorplaning(); // run floorplanner;
+			//##########################################
+			//# Co-annealing of all the subfloorplans  #
+			//##########################################
 
-		// (3.a)
-		fp_p1->list_information();
-		fp_p1->show_tree();
-
-		//###############################
-		//# Annealing of subfloorplan 2 #
-		//###############################
+			for ( int layer = 0; layer < _layers; layer++) {
+				new_layer( layer, i);
+				fp_layers[layer]->create_subfloorplan( layer, fp_toplevel, partition);
+			}
+			coanneal_subfloorplans( fp_layers, i, trial);
+			print_logs( 0);
+		} else {
 
-		printf("\n\n\n\n\n\nSubFloorplan 2 annealing attempt number: %d\n\n", i);
+			//###############################
+			//# Annealing of subfloorplan 1 #
+			//###############################
 
-		// (1.b)
-		fp_p2->create_subfloorplan_layer2( fp_toplevel, fp_p1, partition);
+			fprintf( _out, "\n\n\n\n\n\nSubFloorplan 1 annealing attempt number: %d\n\n", i);
 
-		int modules_N_2 = fp_p2->modules_N; // modules count of subfloorplan 2;
-		if ( _verbose) {
-			fp_p2->show_modules(); // debug;
+			fp_layers[0] = new B_Tree( _alpha);
+			fp_layers[0]->set_sfra_host( this);
+			fp_layers[0]->set_log( _out);
+			fp_layers[0]->create_subfloorplan( 0, fp_toplevel, partition);
+			anneal_subfloorplan( fp_layers[0], 0, attempt_seed( i, trial));
 		}
-		fp_p2->init();
-
-		// (2.b) run floorplaning;
-		SA_FLOORPLANING sa_floorplanning2( fp_p2, _times, _local, _term_temp);
-		sa_floorplanning2.set_avg_ratio( _avg_ratio);
-		sa_floorplanning2.set_lambda( _lambda);
-		sa_floorplanning2.set_alpha( _alpha);
-		sa_floorplanning2.set_fp_scale( _fp_scale);
-		sa_floorplanning2.set_verbose(_verbose); // print detailed info?
-		sa_floorplanning2.run_SA_Floorplaning(); // run floorplanner;
-
-		// (3.b)
-		fp_p2->list_information();
-		fp_p2->show_tree();
 
+		// compute aspect ratio of layer 1;
+		fp_aspect_ratio = ( fp_layers[0]->Height >= fp_layers[0]->Width) ?
+			( fp_layers[0]->Height / fp_layers[0]->Width) :
+			( fp_layers[0]->Width / fp_layers[0]->Height);
 
-
-
-		// (4) compute aspect ratio of fp_p1;
-		fp_aspect_ratio = ( fp_p1->Height >= fp_p1->Width) ?
-			( fp_p1->Height / fp_p1->Width) : ( fp_p1->Width / fp_p1->Height);
-
-		// if the aspect ratio is higher than 1.3 reject this subfloorplan;
-		if ( num_rejected_fps <= THRESHOLD_TRIALS_COUNT_PER_ATTEMPT && 
+		// if the aspect ratio is higher than 1.3 reject this subfloorplan,
+		// unless there is a fixed outline (see search_n_fps_floorplans);
+		// without coanneal, the other layers are not annealed at all then;
+		if ( _outline_whitespace == 0 &&
+			num_rejected_fps <= THRESHOLD_TRIALS_COUNT_PER_ATTEMPT && 
 			fp_aspect_ratio > 1.3) {
 			num_rejected_fps ++;
 			if ( num_rejected_fps == _n_fps) {
@@ -2293,166 +3020,69 @@ void SFRA::search_n_fps_for_subfloorplans_layers_12(
 			// cancel this attempt and do not count it as part of _n_fps;
 			// however, this should not be done too many (infinite) times;
 			i --;
-			delete fp_p1;
-			delete fp_p2;
+			for ( int layer = 0; layer < _layers; layer++) {
+				delete fp_layers[layer];
+				fp_layers[layer] = 0;
+			}
 			continue;
 		}
 		// reset num_rejected_fps so that during next "i" iteration we'll
 		// explore more floorplans until we get one with good aspect ratio;
 		num_rejected_fps = 0;
-		
 
-		//#################################################
-		//# Verify if the resulting FP is one of the best #
-		//#################################################
+		if ( !coanneal) {
 
-		bool this_fp_is_better = false; // should go into bests list;
-		double worst_crit = 0;
-		int pos_best, pos_worst, erase_pos;
-		double aspect_ratio = 1.0;
+			//#########################################
+			//# Annealing of the other subfloorplans  #
+			//#########################################
 
-		
-		// start filling the list...
-		if ( best_fps1.size() < _n_best) {
-			this_fp_is_better = true; // first three fp's go into list anyway;
-			pos_best = -1; // signals any position, just use push_back;
-		} else {
-			// if list has already a number of n_bests, find the 
-			// "worst of the best" to be potentially replaced with the new one;
-			for ( int pos = 0; pos < best_fps1.size(); pos++) {
-				aspect_ratio = 
-					( best_fps1[pos].Height >= best_fps1[pos].Width) ?
-					( best_fps1[pos].Height / best_fps1[pos].Width) :
-					( best_fps1[pos].Width / best_fps1[pos].Height);
-				switch ( _fp_criteria) {
-				case 'W':
-					if (aspect_ratio > 1.3 || best_fps1[pos].WireLength > worst_crit) {
-						worst_crit = best_fps1[pos].WireLength;
-						pos_worst = pos;
-					}
-					break;
-				case 'A':
-					if (aspect_ratio > 1.3 || best_fps1[pos].Area > worst_crit) {
-						worst_crit = best_fps1[pos].Area;
-						pos_worst = pos;
-					}
-					break;
-				default:
-					assert(false);
-				}
-			}
-			// compute also the aspect ratio of the worst floorplan in 
-			// current bests list;
-			aspect_ratio = 
-				( best_fps1[pos_worst].Height >= best_fps1[pos_worst].Width) ?
-				( best_fps1[pos_worst].Height / best_fps1[pos_worst].Width) :
-				( best_fps1[pos_worst].Width / best_fps1[pos_worst].Height);
-			// after scaning the whole bests list, if the actual is better than
-			// the "worst of the best", assign it to the list;
-			switch ( _fp_criteria) {
-			case 'W':
-				if ( (fp_p1->getWireLength() < best_fps1[pos_worst].WireLength) ||
-					(fp_p1->getWireLength() < 1.5*best_fps1[pos_worst].WireLength &&
-					fp_aspect_ratio < aspect_ratio) ) {
-					pos_best = pos_worst;
-				 	this_fp_is_better = true;
-				}
-				break;
-			case 'A':
-				if ( (fp_p1->getArea() < best_fps1[pos_worst].Area) ||
-					(fp_p1->getArea() < 1.5*best_fps1[pos_worst].Area &&
-					fp_aspect_ratio < aspect_ratio)) {
-					pos_best = pos_worst;
-					this_fp_is_better = true;
-				}
-				break;
-			}
+			thread_pool()->run( _layers - 1, [&]( int k) {
+				int layer = k + 1;
+				new_layer( layer, i);
+				fp_layers[layer]->create_subfloorplan_on_layer( layer,
+					fp_toplevel, fp_layers[0], partition);
+				anneal_subfloorplan( fp_layers[layer], layer,
+					attempt_seed( i, trial + layer));
+			});
+			print_logs( 1);
 		}
 
 
-		if ( this_fp_is_better) {
-			printf("\nAttempts number %d go to the list of best subfloorplans...\n",i);
-
-			// (fp_p1) copy all the info from subfloorplan 1 to a temporary container;
-			temp_best_floor_plan1.attempt_n = i;
-			temp_best_floor_plan1.Width = fp_p1->Width;
-			temp_best_floor_plan1.Height = fp_p1->Height;
-			temp_best_floor_plan1.Area = fp_p1->getArea();
-			temp_best_floor_plan1.WireLength = fp_p1->getWireLength();
-			temp_best_floor_plan1.modules_N = modules_N_1;
-			for ( int id = 0; id < modules_N_1; id++) {
-				// copy all info of each module to a temporary module;
-				temp_module.x = fp_p1->modules_info[id].x;
-				temp_module.y = fp_p1->modules_info[id].y;
-				temp_module.rx = fp_p1->modules_info[id].rx;
-				temp_module.ry = fp_p1->modules_info[id].ry;
-				temp_module.rotate = fp_p1->modules_info[id].rotate;
-				temp_module.flip = fp_p1->modules_info[id].flip;
-				// push that temp. module to the vector inside the temp. best fp;
-				temp_best_floor_plan1.modules_info.push_back( temp_module);
-			}
-			// add this temp. to the vector of best floorplans;
-			if ( pos_best == -1)
-				best_fps1.push_back( temp_best_floor_plan1);
-			else {
-				printf("\nRemoving attempt number %d from the bests list 1...\n",
-					best_fps1[pos_worst].attempt_n);
-				pos_Iterator1 = best_fps1.begin(); // erase() requires an iterator;
-				erase_pos = 0;
-				while ( erase_pos < pos_worst) {
-					erase_pos ++;
-					pos_Iterator1 ++;
-				}
-				best_fps1.erase( pos_Iterator1);
-				best_fps1.push_back( temp_best_floor_plan1);
-			}
-
-			// (fp_p2) copy all the info from subfloorplan 2 to a temporary container;
-			temp_best_floor_plan2.attempt_n = i;
-			temp_best_floor_plan2.Width = fp_p2->Width;
-			temp_best_floor_plan2.Height = fp_p2->Height;
-			temp_best_floor_plan2.Area = fp_p2->getArea();
-			temp_best_floor_plan2.WireLength = fp_p2->getWireLength();
-			temp_best_floor_plan2.modules_N = modules_N_2;
-			for ( int id = 0; id < modules_N_2; id++) {
-				// copy all info of each module to a temporary module;
-				temp_module.x = fp_p2->modules_info[id].x;
-				temp_module.y = fp_p2->modules_info[id].y;
-				temp_module.rx = fp_p2->modules_info[id].rx;
-				temp_module.ry = fp_p2->modules_info[id].ry;
-				temp_module.rotate = fp_p2->modules_info[id].rotate;
-				temp_module.flip = fp_p2->modules_info[id].flip;
-				// push that temp. module to the vector inside the temp. best fp;
-				temp_best_floor_plan2.modules_info.push_back( temp_module);
-			}
-			// add this temp. to the vector of best floorplans;
-			if ( pos_best == -1)
-				best_fps2.push_back( temp_best_floor_plan2);
-			else {
-				printf("\nRemoving attempt number %d from the bests list 2...\n",
-					best_fps2[pos_worst].attempt_n);
-				pos_Iterator2 = best_fps2.begin(); // erase() requires an iterator;
-				erase_pos = 0;
-				while ( erase_pos < pos_worst) {
-					erase_pos ++;
-					pos_Iterator2 ++;
+		//#################################################
+		//# Verify if the resulting FP is one of the best #
+		//#################################################
+
+		// the stacks of subfloorplans are ranked after their layer 1; the
+		// other layers follow it in and out of their bests lists;
+		vector<ONE_OF_THE_BEST_FLOOR_PLANS> stack( _layers);
+		for ( int layer = 0; layer < _layers; layer++) {
+			B_Tree *fp_p = fp_layers[layer];
+			stack[layer].attempt_n = i;
+			stack[layer].Width = fp_p->Width;
+			stack[layer].Height = fp_p->Height;
+			stack[layer].Area = fp_p->getArea();
+			stack[layer].WireLength = fp_p->getWireLength();
+			stack[layer].modules_N = fp_p->modules_N;
+			stack[layer].modules_info.assign( fp_p->modules_info.begin(),
+				fp_p->modules_info.begin() + fp_p->modules_N);
+			delete fp_p;
+			fp_layers[layer] = 0;
+		}
+		int replaced_pos = -1;
+		if ( update_bests_list( stack[0], best_fps_layers[0], &replaced_pos)) {
+			for ( int layer = 1; layer < _layers; layer++) {
+				if ( replaced_pos >= 0) {
+					best_fps_layers[layer].erase(
+						best_fps_layers[layer].begin() + replaced_pos);
 				}
-				best_fps2.erase( pos_Iterator2);
-				best_fps2.push_back( temp_best_floor_plan2);
+				best_fps_layers[layer].push_back( stack[layer]);
 			}
 		}
-
-
-		// prepare for the next floorplan
-		temp_best_floor_plan1.modules_info.clear();
-		temp_best_floor_plan2.modules_info.clear();
-		delete fp_p1;
-		delete fp_p2;
 	}
 }
 
 void SFRA::calculate_average_path_length(
-	ROUTER_ASSIGNMENT *router_assignment)
+	ROUTER_ASSIGNMENT *router_assignment, FILE *log)
 {
 	// () calculate the average path length among all communications;
 	// should not be normaly used because it adds extra CPU time;
@@ -2460,7 +3090,8 @@ void SFRA::calculate_average_path_length(
 
 	B_Tree *fp_p = new B_Tree( _alpha);
 	fp_p->set_sfra_host( this); // place a copy of this host in the fp object;
-	fp_p->read( _inputfile, _fp_scale);
+	fp_p->set_log( log);
+	fp_p->set_netlist( testcase_netlist());
 	fp_p->init();
 
 	pair <int, int> mesh_pos_src;
@@ -2481,7 +3112,7 @@ void SFRA::calculate_average_path_length(
 		}
 	}
 
-	printf("\nAvg. path length for %d communications: %.2f\n",no_commodity,
+	fprintf( log, "\nAvg. path length for %d communications: %.2f\n",no_commodity,
 		   double(total_paths_length)/no_commodity);
 	delete fp_p;
 }
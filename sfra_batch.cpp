@@ -0,0 +1,142 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+#include "sfra_batch.h"
+#include "sfra_threads.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// BATCH
+//
+////////////////////////////////////////////////////////////////////////////////
+
+BATCH::~BATCH()
+{
+	// only if exiting before all were reported;
+	for ( int k = 0; k < _experiments.size(); k++) {
+		if ( _experiments[k].sfra) delete _experiments[k].sfra;
+		if ( _experiments[k].log) fclose( _experiments[k].log);
+	}
+}
+
+void BATCH::read( const char *file_name, const char *program)
+{
+	FILE *fp = fopen( file_name, "r");
+	if ( fp == 0) {
+		printf("Error:\tCannot open the batch file: %s\n", file_name);
+		exit(1);
+	}
+	char line[BATCH_LINE_SIZE];
+	int line_number = 0;
+	while ( fgets( line, sizeof( line), fp) != 0) {
+		line_number ++;
+		char *word = strtok( line, " \t\r\n");
+		if ( word == 0 || word[0] == '#') {
+			continue;
+		}
+		BATCH_EXPERIMENT experiment;
+		experiment.line_number = line_number;
+		experiment.args.push_back( program);
+		// lines of the .run scripts start with ./sfra;
+		int length = strlen( word);
+		if ( length < 4 || strcmp( word + length - 4, "sfra") != 0) {
+			experiment.args.push_back( word);
+		}
+		while ( (word = strtok( 0, " \t\r\n")) != 0) {
+			experiment.args.push_back( word);
+		}
+		_experiments.push_back( experiment);
+	}
+	fclose( fp);
+	if ( _experiments.empty()) {
+		printf("Error:\tThe batch file %s has no experiments.\n", file_name);
+		exit(1);
+	}
+
+	// all the lines are parsed before any runs, so that a wrong one stops
+	// the batch right away;
+	for ( int k = 0; k < _experiments.size(); k++) {
+		BATCH_EXPERIMENT &experiment = _experiments[k];
+		for ( int i = 0; i < experiment.args.size(); i++) {
+			experiment.argv.push_back( &experiment.args[i][0]);
+		}
+		experiment.argv.push_back( 0);
+		experiment.sfra = new SFRA();
+		experiment.sfra->parse_command_arguments( experiment.args.size(),
+			&experiment.argv[0]);
+		if ( experiment.sfra->batch_file()[0] != '\0' ||
+			experiment.sfra->replay_file()[0] != '\0') {
+			printf("Error:\tLine %d of the batch file is not an experiment.\n",
+				experiment.line_number);
+			exit(1);
+		}
+		experiment.sfra->share_with_batch( *_sfra);
+	}
+}
+
+void BATCH::run()
+{
+	// the experiments are handed out in the order of the lines; every one
+	// runs its own annealing attempts and simulations on the same threads;
+	function<void(int)> experiment = [&]( int k) {
+		run_experiment( k);
+	};
+	_sfra->thread_pool()->run( _experiments.size(), experiment);
+	assert( _reported_count == _experiments.size());
+}
+
+void BATCH::run_experiment( int k)
+{
+	BATCH_EXPERIMENT &experiment = _experiments[k];
+	experiment.log = tmpfile();
+	if ( experiment.log == 0) {
+		printf("Error:\tCannot create the log of batch experiment %d.\n", k + 1);
+		exit(1);
+	}
+	SFRA *sfra = experiment.sfra;
+	sfra->set_out( experiment.log);
+	sfra->setup_seed();
+	sfra->print_setup_info();
+	sfra->run_experiment( experiment.best_fps);
+
+	lock_guard<mutex> lock( _mutex);
+	experiment.done = true;
+	report_done_experiments();
+}
+
+void BATCH::report_done_experiments()
+{
+	while ( _reported_count < _experiments.size() &&
+		_experiments[ _reported_count].done) {
+		BATCH_EXPERIMENT &experiment = _experiments[ _reported_count];
+		// results.txt and the excel files get the experiments in the
+		// order of the lines;
+		experiment.sfra->calculate_final_results_statistics(
+			experiment.args.size(), &experiment.argv[0], experiment.best_fps);
+
+		printf("\nBatch experiment %d of %d (line %d):", _reported_count + 1,
+			int( _experiments.size()), experiment.line_number);
+		for ( int i = 1; i < experiment.args.size(); i++) {
+			printf(" %s", experiment.args[i].c_str());
+		}
+		printf("\n");
+		char buffer[4096];
+		rewind( experiment.log);
+		size_t n = 0;
+		while ( (n = fread( buffer, 1, sizeof( buffer), experiment.log)) > 0) {
+			fwrite( buffer, 1, n, stdout);
+		}
+		fclose( experiment.log);
+		experiment.log = 0;
+		fflush( stdout);
+
+		delete experiment.sfra;
+		experiment.sfra = 0;
+		experiment.best_fps.clear();
+		_reported_count ++;
+	}
+}
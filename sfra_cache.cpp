@@ -0,0 +1,319 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "sfra_cache.h"
+
+using namespace std;
+
+// appends to text what printf would print;
+static void append_printf( string &text, const char *format, ...)
+{
+	char buffer[256];
+	va_list args;
+	va_start( args, format);
+	vsnprintf( buffer, sizeof( buffer), format, args);
+	va_end( args);
+	text += buffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// CACHE_KEY
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void CACHE_KEY::add_bytes( const void *bytes, size_t bytes_count)
+{
+	const unsigned char *b = (const unsigned char *) bytes;
+	for ( size_t i = 0; i < bytes_count; i++) {
+		_hash ^= b[i];
+		_hash *= 1099511628211ULL;
+	}
+}
+
+void CACHE_KEY::add_floorplan( const ONE_OF_THE_BEST_FLOOR_PLANS &fp)
+{
+	add_int( fp.modules_N);
+	add_double( fp.Width);
+	add_double( fp.Height);
+	for ( int i = 0; i < fp.modules_info.size(); i++) {
+		const Module_Info &mi = fp.modules_info[i];
+		add_int( mi.rotate);
+		add_int( mi.flip);
+		add_int( mi.x);
+		add_int( mi.y);
+		add_int( mi.rx);
+		add_int( mi.ry);
+	}
+}
+
+void CACHE_KEY::add_router_assignment( ROUTER_ASSIGNMENT &router_assignment,
+	int ary)
+{
+	// routers without a core have no corner;
+	add_int( ary);
+	for ( int x = 0; x < ary; x++) {
+		for ( int y = 0; y < ary; y++) {
+			int id = router_assignment.assigned( x, y);
+			add_int( id);
+			if ( id >= 0) {
+				add_int( router_assignment.corner_used( x, y));
+				add_double( router_assignment.extralink( x, y));
+			}
+		}
+	}
+}
+
+string CACHE_KEY::name() const
+{
+	char text[32];
+	sprintf( text, "%016llx", _hash);
+	return text;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// RESULTS_CACHE
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool RESULTS_CACHE::open( const char *directory)
+{
+	_directory = directory;
+	if ( mkdir( directory, 0777) != 0 && errno != EEXIST) {
+		printf("Error:\tCannot create the cache directory: %s\n", directory);
+		return false;
+	}
+	// a missing index is an empty cache;
+	string index_file = _directory + "/" + CACHE_INDEX_FILE;
+	FILE *index = fopen( index_file.c_str(), "r");
+	if ( index != 0) {
+		char line[BUFFER_SIZE];
+		char name[BUFFER_SIZE];
+		while ( fgets( line, sizeof( line), index) != 0) {
+			if ( sscanf( line, "%s", name) == 1) {
+				_entries.insert( name);
+			}
+		}
+		fclose( index);
+	}
+	return true;
+}
+
+void RESULTS_CACHE::add_file( CACHE_KEY &key, const string &file_name)
+{
+	lock_guard<mutex> lock( _mutex);
+	map<string, unsigned long long>::iterator it = _files_hashes.find( file_name);
+	if ( it == _files_hashes.end()) {
+		CACHE_KEY file_key( "file");
+		FILE *fp = fopen( file_name.c_str(), "rb");
+		if ( fp == 0) {
+			file_key.add_string( "missing");
+		} else {
+			char buffer[4096];
+			size_t n = 0;
+			while ( (n = fread( buffer, 1, sizeof( buffer), fp)) > 0) {
+				file_key.add_bytes( buffer, n);
+			}
+			fclose( fp);
+		}
+		it = _files_hashes.insert( make_pair( file_name, file_key.hash())).first;
+	}
+	key.add_int( it->second);
+}
+
+string RESULTS_CACHE::entry_file( const CACHE_KEY &key) const
+{
+	return _directory + "/" + key.name() + ".txt";
+}
+
+FILE *RESULTS_CACHE::open_entry( const CACHE_KEY &key, const char *kind)
+{
+	{
+		lock_guard<mutex> lock( _mutex);
+		if ( _entries.find( key.name()) == _entries.end()) {
+			return 0;
+		}
+	}
+	FILE *entry = fopen( entry_file( key).c_str(), "rb");
+	if ( entry == 0) {
+		return 0;
+	}
+	// the first line repeats the kind and the key;
+	char entry_kind[BUFFER_SIZE];
+	char entry_name[BUFFER_SIZE];
+	if ( fscanf( entry, "%s %s", entry_kind, entry_name) != 2 ||
+		strcmp( entry_kind, kind) != 0 || key.name() != entry_name) {
+		fclose( entry);
+		return 0;
+	}
+	return entry;
+}
+
+bool RESULTS_CACHE::load_log( FILE *entry, FILE *log)
+{
+	long bytes_count = 0;
+	if ( fscanf( entry, " log %ld", &bytes_count) != 1 || fgetc( entry) != '\n') {
+		return false;
+	}
+	string text( bytes_count, '\0');
+	if ( bytes_count > 0 && fread( &text[0], 1, bytes_count, entry) != bytes_count) {
+		return false;
+	}
+	fwrite( text.data(), 1, bytes_count, log);
+	lock_guard<mutex> lock( _mutex);
+	_hits_count ++;
+	return true;
+}
+
+void RESULTS_CACHE::store_entry( const CACHE_KEY &key, const char *kind,
+	const char *experiment, const string &value, FILE *log, long offset)
+{
+	// what was printed since offset;
+	fflush( log);
+	fseek( log, 0, SEEK_END);
+	long end = ftell( log);
+	string text( end - offset, '\0');
+	fseek( log, offset, SEEK_SET);
+	if ( end > offset && fread( &text[0], 1, end - offset, log) != end - offset) {
+		fseek( log, 0, SEEK_END);
+		return; // not worth an entry;
+	}
+	fseek( log, 0, SEEK_END);
+
+	string file_name = entry_file( key);
+	char suffix[64];
+	sprintf( suffix, ".%ld.%lx.tmp", (long) getpid(),
+		(unsigned long) hash<thread::id>()( this_thread::get_id()));
+	string temp_name = file_name + suffix;
+	FILE *entry = fopen( temp_name.c_str(), "wb");
+	if ( entry == 0) {
+		printf("Error:\tCannot write into the cache directory: %s\n",
+			_directory.c_str());
+		exit(1);
+	}
+	fprintf( entry, "%s %s\n%slog %ld\n", kind, key.name().c_str(),
+		value.c_str(), long( text.size()));
+	fwrite( text.data(), 1, text.size(), entry);
+	fclose( entry);
+	rename( temp_name.c_str(), file_name.c_str());
+
+	lock_guard<mutex> lock( _mutex);
+	if ( _entries.insert( key.name()).second) {
+		string index_file = _directory + "/" + CACHE_INDEX_FILE;
+		FILE *index = fopen( index_file.c_str(), "a");
+		if ( index != 0) {
+			fprintf( index, "%s %s %s\n", key.name().c_str(), kind, experiment);
+			fclose( index);
+		}
+	}
+	_stored_count ++;
+}
+
+bool RESULTS_CACHE::load_floorplan( const CACHE_KEY &key,
+	ONE_OF_THE_BEST_FLOOR_PLANS &attempt, FILE *log)
+{
+	FILE *entry = open_entry( key, "floorplan");
+	if ( entry == 0) {
+		return false;
+	}
+	ONE_OF_THE_BEST_FLOOR_PLANS loaded;
+	bool result = ( fscanf( entry, "%d %lf %lf %lf %ld %ld",
+		&loaded.attempt_n, &loaded.Width, &loaded.Height, &loaded.Area,
+		&loaded.WireLength, &loaded.modules_N) == 6);
+	for ( int i = 0; result && i < loaded.modules_N; i++) {
+		Module_Info mi;
+		int rotate = 0, flip = 0;
+		result = ( fscanf( entry, "%d %d %d %d %d %d",
+			&rotate, &flip, &mi.x, &mi.y, &mi.rx, &mi.ry) == 6);
+		mi.rotate = rotate;
+		mi.flip = flip;
+		loaded.modules_info.push_back( mi);
+	}
+	// the log goes last, only once the entry is known to be whole;
+	result = result && load_log( entry, log);
+	fclose( entry);
+	if ( result) {
+		attempt = loaded;
+	}
+	return result;
+}
+
+void RESULTS_CACHE::store_floorplan( const CACHE_KEY &key, const char *experiment,
+	const ONE_OF_THE_BEST_FLOOR_PLANS &attempt, FILE *log, long offset)
+{
+	// doubles with 17 digits read back the same;
+	string value;
+	append_printf( value, "%d %.17g %.17g %.17g %ld %ld\n",
+		attempt.attempt_n, attempt.Width, attempt.Height, attempt.Area,
+		attempt.WireLength, attempt.modules_N);
+	for ( int i = 0; i < attempt.modules_info.size(); i++) {
+		const Module_Info &mi = attempt.modules_info[i];
+		append_printf( value, "%d %d %d %d %d %d\n",
+			int( mi.rotate), int( mi.flip), mi.x, mi.y, mi.rx, mi.ry);
+	}
+	store_entry( key, "floorplan", experiment, value, log, offset);
+}
+
+bool RESULTS_CACHE::load_result( const CACHE_KEY &key, RESULT &result, FILE *log)
+{
+	FILE *entry = open_entry( key, "simulation");
+	if ( entry == 0) {
+		return false;
+	}
+	RESULT loaded;
+	long flows_count = 0, ports_count = 0;
+	bool ok = ( fscanf( entry, "%d %lf %lf %d %lf %lf %lf %lf %lf %lf %lf %d %ld",
+		&loaded.load, &loaded.latency, &loaded.packets_per_cycle,
+		&loaded.buffer_multiplier, &loaded.latency_p50, &loaded.latency_p95,
+		&loaded.latency_p99, &loaded.latency_max, &loaded.energy,
+		&loaded.energy_per_flit, &loaded.avg_power, &loaded.ports_count,
+		&flows_count) == 13);
+	for ( long i = 0; ok && i < flows_count; i++) {
+		FLOW_STATISTICS flow;
+		ok = ( fscanf( entry, "%d %d %d %ld %lf %lf", &flow.src_id, &flow.des_id,
+			&flow.hops, &flow.packets_count, &flow.latency_sum,
+			&flow.latency_max) == 6);
+		loaded.flows.push_back( flow);
+	}
+	ok = ok && ( fscanf( entry, "%ld", &ports_count) == 1);
+	for ( long i = 0; ok && i < ports_count; i++) {
+		double throughput = 0.0;
+		ok = ( fscanf( entry, "%lf", &throughput) == 1);
+		loaded.ports_throughput.push_back( throughput);
+	}
+	ok = ok && load_log( entry, log);
+	fclose( entry);
+	if ( ok) {
+		result = loaded;
+	}
+	return ok;
+}
+
+void RESULTS_CACHE::store_result( const CACHE_KEY &key, const char *experiment,
+	const RESULT &result, FILE *log, long offset)
+{
+	string value;
+	append_printf( value, "%d %.17g %.17g %d %.17g %.17g %.17g %.17g %.17g %.17g %.17g %d\n",
+		result.load, result.latency, result.packets_per_cycle,
+		result.buffer_multiplier, result.latency_p50, result.latency_p95,
+		result.latency_p99, result.latency_max, result.energy,
+		result.energy_per_flit, result.avg_power, result.ports_count);
+	append_printf( value, "%ld\n", long( result.flows.size()));
+	for ( int i = 0; i < result.flows.size(); i++) {
+		const FLOW_STATISTICS &flow = result.flows[i];
+		append_printf( value, "%d %d %d %ld %.17g %.17g\n", flow.src_id,
+			flow.des_id, flow.hops, flow.packets_count, flow.latency_sum,
+			flow.latency_max);
+	}
+	append_printf( value, "%ld\n", long( result.ports_throughput.size()));
+	for ( int i = 0; i < result.ports_throughput.size(); i++) {
+		append_printf( value, "%.17g\n", result.ports_throughput[i]);
+	}
+	store_entry( key, "simulation", experiment, value, log, offset);
+}
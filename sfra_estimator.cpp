@@ -0,0 +1,218 @@
+#include "config.h"
+#include "sfra.h"
+#include "sfra_estimator.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include <fstream>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// LATENCY_ESTIMATOR
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void LATENCY_ESTIMATOR::set_flows( FPlan *fp_p)
+{
+	// _connection is symmetric; every communication becomes two flows, one
+	// in each direction, both weighted by its communication volume;
+	_flows.clear();
+	_total_weight = 0.0;
+	for ( int i = 0; i < fp_p->modules_N; i++) {
+		for ( int j = 0; j < fp_p->modules_N; j++) {
+			if ( i != j && fp_p->get_connection(i,j) > 0) {
+				_flows.push_back( ESTIMATED_FLOW( i, j, fp_p->get_connection(i,j)));
+				_total_weight += fp_p->get_connection(i,j);
+			}
+		}
+	}
+}
+
+bool LATENCY_ESTIMATOR::calibrate_injection_rate( char *trace_file)
+{
+	// scan once the aggregate trace of the testcase (each line is: time src
+	// des packet_size) to find how many flits per cycle the application
+	// injects at 100% load; the communication volumes give only the split
+	// of this rate among flows;
+	string name_t = trace_file;
+	name_t.append(".trs");
+	ifstream trace( name_t.c_str());
+	if ( trace.fail()) {
+		printf("\nError: Cannot open trace file: %s\n", name_t.c_str());
+		exit(1);
+	}
+
+	double time = 0.0, first_time = -1.0, last_time = 0.0;
+	int src_id = 0, des_id = 0;
+	long packet_size = 0, packets_count = 0, flits_count = 0;
+	while ( trace >> time >> src_id >> des_id >> packet_size) {
+		if ( first_time < 0) {
+			first_time = time;
+		}
+		last_time = time;
+		packets_count ++;
+		flits_count += packet_size;
+	}
+	trace.close();
+
+	if ( packets_count == 0 || last_time <= first_time) {
+		return false;
+	}
+	_injection_rate = double(flits_count) / (last_time - first_time);
+	_avg_packet_size = double(flits_count) / packets_count;
+	return true;
+}
+
+double LATENCY_ESTIMATOR::estimate( ROUTER_ASSIGNMENT *router_assignment,
+	int ary, int load, double link_length)
+{
+	// returns the rate-weighted average latency of all flows; per-flow
+	// latencies and channel utilizations are kept for print_estimate();
+	assert( _sfra != 0);
+	_ary = ary;
+	_saturated = false;
+	_channel_load.resize( ary * ary * ESTIMATOR_CHANNELS_PER_ROUTER);
+	fill( _channel_load.begin(), _channel_load.end(), 0.0);
+
+	// same injection load control as in ROUTER::receive_packet_from_trace_file,
+	// where only max_skip_counter packets out of every 10 are injected;
+	double load_fraction = double(10 - (100 - load) / 10) / 10.0;
+	double packet_size = _avg_packet_size;
+	double link_delay = WIRE_DELAY * link_length / BASE_WIRE; // Linear_delay;
+	double extra_delay_per_unit =
+		WIRE_DELAY * _sfra->extra_links_timing_factor() / BASE_WIRE;
+	if ( _total_weight <= 0.0) {
+		_avg_latency = 0.0;
+		_max_utilization = 0.0;
+		_avg_utilization = 0.0;
+		return _avg_latency;
+	}
+
+
+	// (0) look up once where every core is hooked up; the by-id queries of
+	// ROUTER_ASSIGNMENT scan the whole mesh each time;
+	vector< pair<int, int> > core_xy;
+	vector<double> core_extralink;
+	for ( int y = 0; y < ary; y++) {
+		for ( int x = 0; x < ary; x++) {
+			int id = router_assignment->assigned( x, y);
+			if ( id < 0) {
+				continue;
+			}
+			if ( id >= core_xy.size()) {
+				core_xy.resize( id + 1, pair<int, int>(-1, -1));
+				core_extralink.resize( id + 1, 0.0);
+			}
+			core_xy[id] = pair<int, int>(x, y);
+			core_extralink[id] = router_assignment->extralink( x, y);
+		}
+	}
+
+
+	// (1) route every flow like vNOC's XY does (y dimension first, then x)
+	// and accumulate the flits/cycle demanded from every channel;
+	for ( long f = 0; f < _flows.size(); f++) {
+		ESTIMATED_FLOW &flow = _flows[f];
+		flow.rate = _injection_rate * load_fraction * flow.weight / _total_weight;
+		flow.channels.clear();
+
+		assert( flow.src_id < core_xy.size() && flow.des_id < core_xy.size());
+		pair<int, int> src = core_xy[ flow.src_id];
+		pair<int, int> des = core_xy[ flow.des_id];
+		assert( src.first != -1 && des.first != -1);
+		int x = src.first, y = src.second;
+		flow.channels.push_back( (x + y * ary) * ESTIMATOR_CHANNELS_PER_ROUTER + 5);
+		while ( y != des.second) {
+			int port = ( des.second < y) ? 3 : 4;
+			flow.channels.push_back( (x + y * ary) * ESTIMATOR_CHANNELS_PER_ROUTER + port);
+			y += ( port == 3) ? -1 : 1;
+		}
+		while ( x != des.first) {
+			int port = ( des.first < x) ? 1 : 2;
+			flow.channels.push_back( (x + y * ary) * ESTIMATOR_CHANNELS_PER_ROUTER + port);
+			x += ( port == 1) ? -1 : 1;
+		}
+		flow.channels.push_back( (x + y * ary) * ESTIMATOR_CHANNELS_PER_ROUTER + 0);
+		flow.hops = flow.channels.size() - 2; // minus injection and ejection;
+
+		for ( long k = 0; k < flow.channels.size(); k++) {
+			_channel_load[ flow.channels[k]] += flow.rate;
+		}
+	}
+
+
+	// (2) channel utilizations; link bandwidth is one flit per cycle;
+	_max_utilization = 0.0;
+	_avg_utilization = 0.0;
+	long used_channels_count = 0;
+	for ( long c = 0; c < _channel_load.size(); c++) {
+		if ( _channel_load[c] > 0.0) {
+			_max_utilization = max( _max_utilization, _channel_load[c]);
+			_avg_utilization += _channel_load[c];
+			used_channels_count ++;
+		}
+	}
+	_avg_utilization /= max( used_channels_count, long(1));
+	if ( _max_utilization >= 1.0) {
+		_saturated = true;
+	}
+
+
+	// (3) per flow latency; a channel is an M/D/1 server whose service time
+	// is the whole packet (wormhole); the waiting time seen by a flow is
+	// due only to the other flows sharing that channel, rho' = rho - own rate:
+	//   W = rho' * packet_size / (2 * (1 - rho))
+	double weighted_latency_sum = 0.0;
+	double rates_sum = 0.0;
+	for ( long f = 0; f < _flows.size(); f++) {
+		ESTIMATED_FLOW &flow = _flows[f];
+
+		double waiting = 0.0;
+		for ( long k = 0; k < flow.channels.size(); k++) {
+			double rho = _channel_load[ flow.channels[k]];
+			if ( rho >= 1.0) {
+				waiting = ESTIMATOR_SATURATED_LATENCY;
+				break;
+			}
+			waiting += (rho - flow.rate) * packet_size / (2.0 * (1.0 - rho));
+		}
+
+		double zero_load =
+			(flow.hops + 1) * ESTIMATOR_ROUTER_STAGES * PIPE_DELAY + // routers;
+			flow.hops * link_delay + // links;
+			(packet_size - 1.0); // serialization of the tail flit;
+		double extra_links = extra_delay_per_unit *
+			( core_extralink[ flow.src_id] + core_extralink[ flow.des_id]);
+		if ( _sfra->sim_mode() == SIMULATED_ARCH_25D ||
+			_sfra->sim_mode() == SIMULATED_ARCH_3D) {
+			extra_links += 2 * TSV_VIA_DELAY;
+		}
+
+		flow.latency = min( zero_load + extra_links + waiting,
+			ESTIMATOR_SATURATED_LATENCY);
+		weighted_latency_sum += flow.rate * flow.latency;
+		rates_sum += flow.rate;
+	}
+	_avg_latency = weighted_latency_sum / max( rates_sum, 1e-12);
+
+	return _avg_latency;
+}
+
+void LATENCY_ESTIMATOR::print_estimate( bool print_flows, FILE *fp)
+{
+	if ( print_flows) {
+		fprintf( fp, "\nEstimated flows (src -> des: rate[flits/cycle] hops latency[cycles]):\n");
+		for ( long f = 0; f < _flows.size(); f++) {
+			fprintf( fp, "%d -> %d:\t%.4f\t%d\t%.2f\n", _flows[f].src_id,
+				_flows[f].des_id, _flows[f].rate, _flows[f].hops, _flows[f].latency);
+		}
+	}
+	fprintf( fp, "Estimated average flit latency: %.2f%s\n", _avg_latency,
+		( _saturated ? " (saturated)" : ""));
+	fprintf( fp, "Estimated channel utilization: max %.3f, avg %.3f\n",
+		_max_utilization, _avg_utilization);
+}
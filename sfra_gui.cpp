@@ -62,8 +62,8 @@ void GUI_GRAPHICS::update_screen( int priority, char *msg,
 	// here, automatically save a snapshot of the current floorplaning;
 	char fname[281];
 	sprintf(fname, "results/%s-%.0fx%.0f-attempt%d.ps", &_testcase_name,
-		_bigger_side, _bigger_side, _best_fp1->attempt_n);
-	//sprintf(fname, "results/attempt%d.ps", _best_fp1->attempt_n);
+		_bigger_side, _bigger_side, _best_fps[0]->attempt_n);
+	//sprintf(fname, "results/attempt%d.ps", _best_fps[0]->attempt_n);
 	if (init_postscript(fname)) {
 		drawscreen();
 		close_postscript();
@@ -101,26 +101,14 @@ void GUI_GRAPHICS::redraw_screen (void)
 		// (a) first bring in the info about the occupancy of routers in the
 		// network;
 		long routers_count = _vnoc->routers_count();
-		long physical_ports_count = 1 + 2 * _topology->cube_size();
-		long vc_number = _topology->virtual_channel_number();
 
 		// (b) first go thru all routers and compute current_max_router_occupancy;
 		float current_max_router_occupancy = 0;
 		for ( long r_i = 0; r_i < routers_count; r_i++) {
 			ROUTER *this_router = _vnoc->router( r_i);
-			long this_router_occ = 0;
-
 			// calculate on the fly how many flits occupy currently this router;
-			for ( long i = 0; i < physical_ports_count; i ++) {
-				for ( long j = 0; j < vc_number; j ++) {
-					long this_r_input_occ =
-						this_router->input().input_buff(i,j).size();
-					this_router_occ += (this_r_input_occ > 0) ? this_r_input_occ : 0;
-				}
-				long this_r_output_occ =
-					this_router->output().out_buffer(i).size();
-				this_router_occ += (this_r_output_occ > 0) ? this_r_output_occ : 0;	
-			}
+			// same as recorded by FRAME_RECORDER in headless runs;
+			long this_router_occ = this_router->buffers_occupancy();
 			// record it as well;
 			_router_occupancy[ r_i] = this_router_occ;
 			if ( this_router_occ > current_max_router_occupancy) {
@@ -246,12 +234,15 @@ void GUI_GRAPHICS::init_draw_coords ( float router_width_val,
 	}
 
 	// determine the region that is displayed/seen;
-	_bigger_side = fmax( _best_fp1->Width, _best_fp1->Width);
-	// if sim_mode is 3D, then we also have subfloorplan 2 and have to 
-	// recompute and overwrite _bigger_side;
+	_bigger_side = fmax( _best_fps[0]->Width, _best_fps[0]->Width);
+	// if sim_mode is 3D, then we also have the subfloorplans of the other
+	// layers and have to recompute and overwrite _bigger_side;
 	if ( _vnoc->sfra()->sim_mode() == SIMULATED_ARCH_3D) {
-		double max_width  = fmax( _best_fp1->Width, _best_fp2->Width);
-		double max_height = fmax( _best_fp1->Height, _best_fp2->Height);
+		double max_width = 0, max_height = 0;
+		for ( int layer = 0; layer < _best_fps.size(); layer++) {
+			max_width  = fmax( max_width, _best_fps[ layer]->Width);
+			max_height = fmax( max_height, _best_fps[ layer]->Height);
+		}
 		_bigger_side = fmax( max_width, max_height);
 	}
 
@@ -284,11 +275,11 @@ void GUI_GRAPHICS::draw_routers (void)
 
 
 		// draw the cores;	
-		for (int n = 0; n < _best_fp1->modules_N; n++) {
-			x1 = _best_fp1->modules_info[n].x;
-			x2 = _best_fp1->modules_info[n].rx;
-			y1 = _best_fp1->modules_info[n].y;
-			y2 = _best_fp1->modules_info[n].ry;
+		for (int n = 0; n < _best_fps[0]->modules_N; n++) {
+			x1 = _best_fps[0]->modules_info[n].x;
+			x2 = _best_fps[0]->modules_info[n].rx;
+			y1 = _best_fps[0]->modules_info[n].y;
+			y2 = _best_fps[0]->modules_info[n].ry;
 
 			setlinestyle( SOLID);
 			setcolor ( LIGHTGREY);
@@ -302,7 +293,7 @@ void GUI_GRAPHICS::draw_routers (void)
 		}
 
 		// draw the assigned routers and the wires between them and the cores;
-		for ( int n = 0; n < _best_fp1->modules_N; n++) {
+		for ( int n = 0; n < _best_fps[0]->modules_N; n++) {
 			mesh_pos = _router_assignment->core_id_to_router_xy(n);
 			xr = mesh_pos.first * _router_distribution->link_length() +
 				_router_distribution->sx();
@@ -315,20 +306,20 @@ void GUI_GRAPHICS::draw_routers (void)
 				setcolor (BLUE);
 				switch (corner) {
 				case SW:
-					drawline(xr, yr, _best_fp1->modules_info[n].x,
-							 _best_fp1->modules_info[n].y);
+					drawline(xr, yr, _best_fps[0]->modules_info[n].x,
+							 _best_fps[0]->modules_info[n].y);
 					break;
 				case SE:
-					drawline(xr, yr, _best_fp1->modules_info[n].rx,
-							 _best_fp1->modules_info[n].y);
+					drawline(xr, yr, _best_fps[0]->modules_info[n].rx,
+							 _best_fps[0]->modules_info[n].y);
 					break;
 				case NW:
-					drawline(xr, yr, _best_fp1->modules_info[n].x,
-							 _best_fp1->modules_info[n].ry);
+					drawline(xr, yr, _best_fps[0]->modules_info[n].x,
+							 _best_fps[0]->modules_info[n].ry);
 					break;
 				case NE:
-					drawline(xr, yr, _best_fp1->modules_info[n].rx,
-							 _best_fp1->modules_info[n].ry);
+					drawline(xr, yr, _best_fps[0]->modules_info[n].rx,
+							 _best_fps[0]->modules_info[n].ry);
 					break;
 				}
 			}
@@ -354,137 +345,82 @@ void GUI_GRAPHICS::draw_routers (void)
 	// () version for 3D;
 	else if ( _vnoc->sfra()->sim_mode() == SIMULATED_ARCH_3D) {
 
+		// cores and links are colored by layer;
+		int core_colors[GUI_LAYER_COLORS] = { LIGHTGREY, YELLOW, CYAN, WHITE };
+		int link_colors[GUI_LAYER_COLORS] = { BLUE, GREEN, DARKGREY, BLACK };
 
 		// draw the cores;
-		for (int n = 0; n < _best_fp1->modules_N; n++) {
-			x1 = _best_fp1->modules_info[n].x;
-			x2 = _best_fp1->modules_info[n].rx;
-			y1 = _best_fp1->modules_info[n].y;
-			y2 = _best_fp1->modules_info[n].ry;
-
-			setlinestyle( SOLID);
-			setcolor ( LIGHTGREY);
-			fillrect ( x1,y1,x2,y2);
-			setcolor ( BLACK);
-			drawrect ( x1,y1,x2,y2);
-			int top_n = _vnoc->sfra()->magic_subid1_to_topid( n);
-			setcolor ( BLACK);
-			sprintf ( buf, "ID %d", top_n);
-			drawtext ( (x1 + x2)/2., (y1 + y2)/2., buf, 100*_scale);
-		}
-		for (int n = 0; n < _best_fp2->modules_N; n++) {
-			x1 = _best_fp2->modules_info[n].x;
-			x2 = _best_fp2->modules_info[n].rx;
-			y1 = _best_fp2->modules_info[n].y;
-			y2 = _best_fp2->modules_info[n].ry;
-
-			setlinestyle( SOLID);
-			setcolor ( YELLOW); // YELLOW
-			fillrect ( x1,y1,x2,y2);
-			setcolor ( BLACK);
-			drawrect ( x1,y1,x2,y2);
-
-			int top_n = _vnoc->sfra()->magic_subid2_to_topid( n);
-			setcolor ( BLACK);
-			sprintf ( buf, "ID %d", top_n);
-			drawtext ( (x1 + x2)/2., (y1 + y2)/2., buf, 100*_scale);
+		for ( int layer = 0; layer < _best_fps.size(); layer++) {
+			ONE_OF_THE_BEST_FLOOR_PLANS *best_fp = _best_fps[ layer];
+			for (int n = 0; n < best_fp->modules_N; n++) {
+				x1 = best_fp->modules_info[n].x;
+				x2 = best_fp->modules_info[n].rx;
+				y1 = best_fp->modules_info[n].y;
+				y2 = best_fp->modules_info[n].ry;
+
+				setlinestyle( SOLID);
+				setcolor ( core_colors[ layer % GUI_LAYER_COLORS]);
+				fillrect ( x1,y1,x2,y2);
+				setcolor ( BLACK);
+				drawrect ( x1,y1,x2,y2);
+				int top_n = _vnoc->sfra()->magic_subid_to_topid( layer, n);
+				setcolor ( BLACK);
+				sprintf ( buf, "ID %d", top_n);
+				drawtext ( (x1 + x2)/2., (y1 + y2)/2., buf, 100*_scale);
+			}
 		}
 
-		// links for modules of subfloorplan 1;
-		for ( int n = 0; n < _best_fp1->modules_N; n++) {
-			// get the top-level module id;
-			int top_n = _vnoc->sfra()->magic_subid1_to_topid( n);
+		// links for modules of every subfloorplan;
+		for ( int layer = 0; layer < _best_fps.size(); layer++) {
+			ONE_OF_THE_BEST_FLOOR_PLANS *best_fp = _best_fps[ layer];
+			int link_color = link_colors[ layer % GUI_LAYER_COLORS];
+			for ( int n = 0; n < best_fp->modules_N; n++) {
+				// get the top-level module id;
+				int top_n = _vnoc->sfra()->magic_subid_to_topid( layer, n);
 			
-			mesh_pos = _router_assignment->core_id_to_router_xy( top_n);
-			xr = mesh_pos.first * _router_distribution->link_length() +
-				_router_distribution->sx();
-			yr = mesh_pos.second * _router_distribution->link_length() +
-				_router_distribution->sy();
-
-			if (_show_links) {
-				corner = _router_assignment->corner_used_by_id( top_n);
-				setlinestyle(SOLID);
-				setcolor (BLUE);
-				switch (corner) {
-				case SW:
-					drawline(xr, yr, _best_fp1->modules_info[n].x,
-							 _best_fp1->modules_info[n].y);
-					break;
-				case SE:
-					drawline(xr, yr, _best_fp1->modules_info[n].rx,
-							 _best_fp1->modules_info[n].y);
-					break;
-				case NW:
-					drawline(xr, yr, _best_fp1->modules_info[n].x,
-							 _best_fp1->modules_info[n].ry);
-					break;
-				case NE:
-					drawline(xr, yr, _best_fp1->modules_info[n].rx,
-							 _best_fp1->modules_info[n].ry);
-					break;
+				mesh_pos = _router_assignment->core_id_to_router_xy( top_n);
+				xr = mesh_pos.first * _router_distribution->link_length() +
+					_router_distribution->sx();
+				yr = mesh_pos.second * _router_distribution->link_length() +
+					_router_distribution->sy();
+
+				if (_show_links) {
+					corner = _router_assignment->corner_used_by_id( top_n);
+					setlinestyle(SOLID);
+					setcolor ( link_color);
+					switch (corner) {
+					case SW:
+						drawline(xr, yr, best_fp->modules_info[n].x,
+								 best_fp->modules_info[n].y);
+						break;
+					case SE:
+						drawline(xr, yr, best_fp->modules_info[n].rx,
+								 best_fp->modules_info[n].y);
+						break;
+					case NW:
+						drawline(xr, yr, best_fp->modules_info[n].x,
+								 best_fp->modules_info[n].ry);
+						break;
+					case NE:
+						drawline(xr, yr, best_fp->modules_info[n].rx,
+								 best_fp->modules_info[n].ry);
+						break;
+					}
 				}
-			}
-			long this_router_id = mesh_pos.first * nx + mesh_pos.second;
-			setlinestyle(SOLID);
-			setcolor ( _router_color[this_router_id]);
-			fillrect ( xr-20*_scale, yr-20*_scale, xr+20*_scale, yr+20*_scale);
-			setcolor (BLUE);
-			drawrect ( xr-20*_scale, yr-20*_scale, xr+20*_scale, yr+20*_scale);
-			sprintf ( buf, "%d", top_n);
-			drawtext ( xr, yr, buf, 50*_scale);
-			if ( _show_congestion) {
-				setcolor (RED);
-				sprintf ( buf, "Occ: %.0f", _router_occupancy[this_router_id]);
-				drawtext ( xr+20*_scale, yr+40*_scale, buf, 200*_scale);
-			}
-		}
-		// links for modules of subfloorplan 2;
-		for ( int n = 0; n < _best_fp2->modules_N; n++) {
-			// get the top-level module id;
-			int top_n = _vnoc->sfra()->magic_subid2_to_topid( n);
-			
-			mesh_pos = _router_assignment->core_id_to_router_xy( top_n);
-			xr = mesh_pos.first * _router_distribution->link_length() +
-				_router_distribution->sx();
-			yr = mesh_pos.second * _router_distribution->link_length() +
-				_router_distribution->sy();
-
-			if (_show_links) {
-				corner = _router_assignment->corner_used_by_id( top_n);
+				long this_router_id = mesh_pos.first * nx + mesh_pos.second;
 				setlinestyle(SOLID);
-				setcolor (GREEN);
-				switch (corner) {
-				case SW:
-					drawline(xr, yr, _best_fp2->modules_info[n].x,
-							 _best_fp2->modules_info[n].y);
-					break;
-				case SE:
-					drawline(xr, yr, _best_fp2->modules_info[n].rx,
-							 _best_fp2->modules_info[n].y);
-					break;
-				case NW:
-					drawline(xr, yr, _best_fp2->modules_info[n].x,
-							 _best_fp2->modules_info[n].ry);
-					break;
-				case NE:
-					drawline(xr, yr, _best_fp2->modules_info[n].rx,
-							 _best_fp2->modules_info[n].ry);
-					break;
+				setcolor ( _router_color[this_router_id]);
+				fillrect ( xr-20*_scale, yr-20*_scale, xr+20*_scale, yr+20*_scale);
+				setcolor ( link_color);
+				drawrect ( xr-20*_scale, yr-20*_scale, xr+20*_scale, yr+20*_scale);
+				sprintf ( buf, "%d", top_n);
+				drawtext ( xr, yr, buf, 50*_scale);
+				if ( _show_congestion) {
+					setcolor (RED);
+					sprintf ( buf, "Occ: %.0f", _router_occupancy[this_router_id]);
+					drawtext ( xr+20*_scale, yr+40*_scale, buf, 200*_scale);
 				}
 			}
-			long this_router_id = mesh_pos.first * nx + mesh_pos.second;
-			setlinestyle(SOLID);
-			setcolor ( _router_color[this_router_id]);
-			fillrect ( xr-20*_scale, yr-20*_scale, xr+20*_scale, yr+20*_scale);
-			setcolor (GREEN);
-			drawrect ( xr-20*_scale, yr-20*_scale, xr+20*_scale, yr+20*_scale);
-			sprintf ( buf, "%d", top_n);
-			drawtext ( xr, yr, buf, 50*_scale);
-			if ( _show_congestion) {
-				setcolor (RED);
-				sprintf ( buf, "Occ: %.0f", _router_occupancy[this_router_id]);
-				drawtext ( xr+20*_scale, yr+40*_scale, buf, 200*_scale);
-			}
 		}
 
 	}
@@ -742,8 +678,7 @@ void GUI_GRAPHICS::quit ()
 
 GUI_GRAPHICS::GUI_GRAPHICS( TOPOLOGY *topology, VNOC *vnoc,
 	char *testcase_name,
-	ONE_OF_THE_BEST_FLOOR_PLANS *best_fp1,
-	ONE_OF_THE_BEST_FLOOR_PLANS *best_fp2,
+	const vector<ONE_OF_THE_BEST_FLOOR_PLANS *> &best_fps,
 	ROUTER_ASSIGNMENT *router_assignment,
 	ROUTERS_DISTRIBUTION *router_distribution)
 {
@@ -752,8 +687,7 @@ GUI_GRAPHICS::GUI_GRAPHICS( TOPOLOGY *topology, VNOC *vnoc,
 	_display_type = SCREEN;
 	_topology = topology;
 	_vnoc = vnoc;
-	_best_fp1 = best_fp1;
-	_best_fp2 = best_fp2;
+	_best_fps = best_fps;
 	_router_assignment = router_assignment;
 	_router_distribution = router_distribution;
 
@@ -791,7 +725,7 @@ bool GUI_GRAPHICS::build()
 	// window title shows the floorplaning attempt being depicted
 	// set up the display graphics;
 	sprintf(buf, "Attempt #%d - Simultaneous Floorplaning and Router Assignment",
-		_best_fp1->attempt_n);
+		_best_fps[0]->attempt_n);
 	init_graphics(buf);
 
 	// populate info on: _x_router_left, _y_router_bottom, _router_color,
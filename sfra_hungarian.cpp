@@ -3,6 +3,9 @@
 #include <stdlib.h>
 #include <iostream>
 #include <assert.h>
+#include <float.h>
+#include <algorithm>
+#include <functional>
 
 using namespace std;
 
@@ -16,208 +19,330 @@ void HUNGARIAN_ONE::initialize( int y, int x)
 {
 	_size1 = y;
 	_size2 = x;
+	_candidates_count = 0;
+	assert( _size1 <= _size2);
 	clear(); // clear storage from previous use;
 	
 	int array_count = _size1 * _size2;
-	int i = 0;
-	_array.resize(array_count);
-	for ( i = 0; i < array_count; i++) {
-		_array[i] = -1;
-	}
-	assert( _array.size() == array_count);
-	_result.resize( _size1);
-	_unchosen_row.resize( _size1);
-	_row_dec.resize( _size1);
-	for ( i = 0; i < _size1; i++) {
-		_result[i] = -1;
-		_unchosen_row[i] = 0;
-		_row_dec[i] = 0;
-	}
-	_row_mate.resize( _size2);
-	_col_inc.resize( _size2);
-	_parent_row.resize( _size2);
-	_slack.resize( _size2);
-	_slack_row.resize( _size2);
-	for ( i = 0; i < _size2; i++) {
-		_row_mate[i] = 0;
-		_col_inc[i] = 0;
-		_parent_row[i] = 0;
-		_slack[i] = 0;
-		_slack_row[i] = 0;
-	}
+	_array.assign( array_count, -1);
+	_result.assign( _size1, -1);
+	_row_dual.assign( _size1, 0);
+	_row_visited.assign( _size1, 0);
+	_row_mate.assign( _size2, -1);
+	_col_dual.assign( _size2, 0);
+	_path_cost.assign( _size2, 0);
+	_parent_row.assign( _size2, -1);
+	_remaining.assign( _size2, 0);
+	_col_visited.assign( _size2, 0);
+}
+
+void HUNGARIAN_ONE::initialize_sparse( int y, int x, int candidates_count)
+{
+	_size1 = y;
+	_size2 = x;
+	_candidates_count = candidates_count;
+	assert( _size1 <= _size2);
+	clear(); // clear storage from previous use;
+
+	// no candidate yet;
+	_candidates.assign( _size1 * _candidates_count, -1);
+	_array.assign( _size1 * _candidates_count, -1);
+	_result.assign( _size1, -1);
+	_row_dual.assign( _size1, 0);
+	_row_visited.assign( _size1, 0);
+	_row_mate.assign( _size2, -1);
+	_col_dual.assign( _size2, 0);
+	_path_cost.assign( _size2, DBL_MAX);
+	_parent_row.assign( _size2, -1);
+	_col_visited.assign( _size2, 0);
 }
 
 void HUNGARIAN_ONE::clear() 
 {
+	_candidates.clear();
 	_array.clear();
 	_result.clear();
-	_unchosen_row.clear();
 	_row_mate.clear();
-	_row_dec.clear();
-	_col_inc.clear();	
+	_row_dual.clear();
+	_col_dual.clear();
+	_path_cost.clear();
 	_parent_row.clear();
-	_slack.clear();
-	_slack_row.clear();
+	_remaining.clear();
+	_row_visited.clear();
+	_col_visited.clear();
+	_touched_cols.clear();
+	_touched_rows.clear();
+	_heap.clear();
 }
 
-void HUNGARIAN_ONE::print_hungarian_assignment()
+void HUNGARIAN_ONE::print_hungarian_assignment( FILE *fp)
 {
 	// debug;
-	cout << "\nTiles: ";
+	if ( sparse()) {
+		for ( int i = 0; i < _size1; i++) {
+			fprintf( fp, "\nIP: %d", i);
+			for ( int k = 0; k < _candidates_count; k++) {
+				int l = i * _candidates_count + k;
+				fprintf( fp, "\t %d:%g", _candidates[l], _array[l]);
+			}
+			fprintf( fp, "\nIP %d --> %d", i, _result[i]);
+		}
+		return;
+	}
+	fprintf( fp, "\nTiles: ");
 	for ( int j = 0; j < _size2; j++) {
-		cout << "\t " << j;
+		fprintf( fp, "\t %d", j);
 	}
 	for ( int i = 0; i < _size1; i++) {
-		cout << "\nIP: " << i;
+		fprintf( fp, "\nIP: %d", i);
 		for ( int j = 0; j < _size2; j++) {
-			cout << "\t " << get_array(i, j);
+			fprintf( fp, "\t %g", get_array(i, j));
 		}
 	}
-	cout << "\nResult: ";
+	fprintf( fp, "\nResult: ");
 	for ( int i = 0; i < _size1; i++) {
-		cout << "\nIP " << i << " --> " << _result[i];
+		fprintf( fp, "\nIP %d --> %d", i, _result[i]);
 	}
 }
 
-void HUNGARIAN_ONE::run_hungarian() 
+int HUNGARIAN_ONE::shortest_augmenting_path( int row, double &min_cost)
 {
-	// solver;
-	int j = 0, k = 0, l = 0, s = 0, t = 0, q = 0;
-	int m = _size1;
+	// Dijkstra from core "row"; the costs reduced by the dual variables
+	// are >= 0, and 0 along the current assignment; tiles are reached in
+	// increasing order of their path cost; the first free one ends it;
 	int n = _size2;
-	int unmatched = 0;
-	int cost = 0;
-
-	// begin subtract column minima in order to start with lots of zeroes 12;
-	for ( k = 0; k < m; k ++) {
-		s = get_array(k, 0);
-		for ( l = 1; l < n; l ++) {
-			if ( get_array(k, l) < s) s = get_array(k, l);
-		}
-		if ( s) {
-			for ( l = 0; l < n; l ++) {
-				set_array(k, l, (get_array(k, l) - s));
+	int remaining_count = n;
+	for ( int j = 0; j < n; j++) {
+		_remaining[j] = n - 1 - j;
+		_path_cost[j] = DBL_MAX;
+		_col_visited[j] = 0;
+	}
+	for ( int i = 0; i < _size1; i++) {
+		_row_visited[i] = 0;
+	}
+
+	min_cost = 0;
+	int i = row;
+	while ( true) {
+		_row_visited[i] = 1;
+		const double *costs = &_array[i * n];
+		double row_dual = _row_dual[i];
+		int index = -1;
+		double lowest = DBL_MAX;
+		for ( int k = 0; k < remaining_count; k++) {
+			int j = _remaining[k];
+			double r = min_cost + costs[j] - row_dual - _col_dual[j];
+			if ( r < _path_cost[j]) {
+				_parent_row[j] = i;
+				_path_cost[j] = r;
+			}
+			// on ties, prefer free tiles;
+			if ( _path_cost[j] < lowest ||
+				( _path_cost[j] == lowest && _row_mate[j] < 0)) {
+				lowest = _path_cost[j];
+				index = k;
 			}
-			cost += s;
 		}
+		assert( index >= 0);
+		min_cost = lowest;
+		int j = _remaining[index];
+		_col_visited[j] = 1;
+		_remaining[index] = _remaining[--remaining_count];
+		if ( _row_mate[j] < 0) {
+			return j;
+		}
+		i = _row_mate[j];
 	}
-	// begin initial state 16;
-	t = 0;
-	for ( l = 0; l < n; l ++) {
-		_row_mate[l] = -1;
-		_parent_row[l] = -1;
-		_col_inc[l] = 0;
-		_slack[l] = INFINITY_HUNGARIAN;
+}
+
+bool HUNGARIAN_ONE::run_hungarian() 
+{
+	// solver;
+	if ( sparse()) {
+		return run_sparse();
 	}
-	for ( k = 0; k < m; k ++) {
-		s = 0;
-		_row_dec[k] = s;
-		for ( l = 0; l < n; l ++)
-			if ((s == get_array(k, l)) && _row_mate[l] < 0) {
-				_result[k] = l;
-				_row_mate[l] = k;
-				goto row_done;
-			}
-		_result[k] = -1;
-		_unchosen_row[t++] = k;
-	  row_done:
-		;
+	int m = _size1;
+	int n = _size2;
+	assert( m <= n);
+
+	// (1) start with the minimum cost of every core as its dual variable;
+	// every core whose cheapest tile is still free just takes it;
+	for ( int j = 0; j < n; j++) {
+		_row_mate[j] = -1;
+		_col_dual[j] = 0;
 	}
-	
-	// begin Hungarian algorithm 18;
-	if ( !t)
-		goto done;
-	unmatched = t;
-	while ( 1) {
-		q = 0;
-		while ( 1) {
-			while ( q < t) {
-				// begin explore node q of the forest 19;
-				k = _unchosen_row[q];
-				s = _row_dec[k];
-				for ( l = 0; l < n; l ++) {
-					if ( _slack[l]) {
-						int del;
-						del = get_array(k, l) - s + _col_inc[l];
-						if ( del < _slack[l]) {
-							if ( !del) {
-								if (_row_mate[l] < 0) goto breakthru;
-								_slack[l] = 0;
-								_parent_row[l] = k;
-								_unchosen_row[t++] = _row_mate[l];
-							} else {
-								_slack[l] = del;
-								_slack_row[l] = k;
-							}
-						}
-					}
-				}
-				q++;
+	for ( int i = 0; i < m; i++) {
+		const double *costs = &_array[i * n];
+		int best_j = 0;
+		for ( int j = 1; j < n; j++) {
+			if ( costs[j] < costs[best_j]) best_j = j;
+		}
+		_row_dual[i] = costs[best_j];
+		_result[i] = -1;
+		if ( _row_mate[best_j] < 0) {
+			_result[i] = best_j;
+			_row_mate[best_j] = i;
+		}
+	}
+
+	// (2) assign every other core along its shortest augmenting path
+	// and update the dual variables, which keeps the reduced costs >= 0;
+	for ( int row = 0; row < m; row++) {
+		if ( _result[row] >= 0) {
+			continue;
+		}
+		double min_cost = 0;
+		int sink = shortest_augmenting_path( row, min_cost);
+
+		_row_dual[row] += min_cost;
+		for ( int i = 0; i < m; i++) {
+			if ( _row_visited[i] && i != row) {
+				_row_dual[i] += min_cost - _path_cost[ _result[i]];
 			}
-			// begin introduce a new zero into the matrix 21;	
-			s = INFINITY_HUNGARIAN;
-			for ( l = 0; l < n; l ++) {
-				if ( _slack[l] && _slack[l] < s) {
-					s = _slack[l];
-				}
+		}
+		for ( int j = 0; j < n; j++) {
+			if ( _col_visited[j]) {
+				_col_dual[j] -= min_cost - _path_cost[j];
 			}
-			for ( q = 0; q < t; q ++) {
-				_row_dec[_unchosen_row[q]] += s;
+		}
+
+		// flip the assignment along the path;
+		int j = sink;
+		while ( true) {
+			int i = _parent_row[j];
+			_row_mate[j] = i;
+			swap( _result[i], j);
+			if ( i == row) break;
+		}
+	}
+	return true;
+}
+
+int HUNGARIAN_ONE::sparse_shortest_augmenting_path( int row, double &min_cost)
+{
+	// as shortest_augmenting_path(), but the tiles reached and not yet
+	// visited are kept in a heap instead of being all looked at;
+	// _path_cost is DBL_MAX and _col_visited 0 for all tiles not touched;
+	int k_count = _candidates_count;
+	_heap.clear();
+	min_cost = 0;
+	int i = row;
+	while ( true) {
+		_row_visited[i] = 1;
+		_touched_rows.push_back( i);
+		double row_dual = _row_dual[i];
+		for ( int k = 0; k < k_count; k++) {
+			int j = _candidates[i * k_count + k];
+			if ( j < 0 || _col_visited[j]) {
+				continue;
 			}
-			for ( l = 0; l < n; l ++) {
-				if ( _slack[l]) {
-					_slack[l] -= s;
-					if ( !_slack[l]) {
-						// begin look at a new zero 22;
-						k = _slack_row[l];
-						if ( _row_mate[l] < 0) {
-							for ( j = l+1; j < n; j ++) {
-								if ( !_slack[j]) {
-									_col_inc[j] += s; 
-								}
-							}
-							goto breakthru;
-						}
-						else {
-							_parent_row[l] = k;
-							_unchosen_row[t++] = _row_mate[l];
-						}
-					}
-				} else {
-					_col_inc[l] += s;
+			double r = min_cost + _array[i * k_count + k] - row_dual - _col_dual[j];
+			if ( r < _path_cost[j]) {
+				if ( _path_cost[j] == DBL_MAX) {
+					_touched_cols.push_back( j);
 				}
+				_parent_row[j] = i;
+				_path_cost[j] = r;
+				_heap.push_back( make_pair( r, j));
+				push_heap( _heap.begin(), _heap.end(), greater< pair<double,int> >());
 			}
 		}
-	  breakthru:
-		// begin update the matching 20;
-		do {
-			j = _result[k];
-			_result[k] = l;
-			_row_mate[l] = k;
-			if (j < 0) break;
-			k = _parent_row[j];
-			l = j;
-		} while (1);
-
-		if ( --unmatched == 0) {
-			goto done;
-		}
-		// begin get ready for another stage 17;
-		t = 0;
-		for ( l = 0; l < n; l ++) {
-			_parent_row[l] =  -1;
-			_slack[l] = INFINITY_HUNGARIAN;
-		}
-		for ( k = 0; k < m; k ++) {
-			if ( _result[k] < 0) {
-				_unchosen_row[t++] = k;
+		// closest tile not yet visited; stale heap entries are skipped;
+		int j = -1;
+		while ( !_heap.empty()) {
+			pair<double,int> top = _heap.front();
+			pop_heap( _heap.begin(), _heap.end(), greater< pair<double,int> >());
+			_heap.pop_back();
+			if ( !_col_visited[top.second] && top.first == _path_cost[top.second]) {
+				j = top.second;
+				break;
 			}
 		}
+		if ( j < 0) {
+			return -1;
+		}
+		min_cost = _path_cost[j];
+		_col_visited[j] = 1;
+		if ( _row_mate[j] < 0) {
+			return j;
+		}
+		i = _row_mate[j];
 	}
-  done:
-	return;
 }
 
+bool HUNGARIAN_ONE::run_sparse()
+{
+	// same steps as the dense solver, over the candidates only;
+	int m = _size1;
+	int k_count = _candidates_count;
+	for ( int j = 0; j < _size2; j++) {
+		_row_mate[j] = -1;
+		_col_dual[j] = 0;
+	}
+	for ( int i = 0; i < m; i++) {
+		int best_k = -1;
+		for ( int k = 0; k < k_count; k++) {
+			if ( _candidates[i * k_count + k] >= 0 && ( best_k < 0 ||
+				_array[i * k_count + k] < _array[i * k_count + best_k])) {
+				best_k = k;
+			}
+		}
+		if ( best_k < 0) {
+			return false;
+		}
+		_row_dual[i] = _array[i * k_count + best_k];
+		_result[i] = -1;
+		int best_j = _candidates[i * k_count + best_k];
+		if ( _row_mate[best_j] < 0) {
+			_result[i] = best_j;
+			_row_mate[best_j] = i;
+		}
+	}
+
+	for ( int row = 0; row < m; row++) {
+		if ( _result[row] >= 0) {
+			continue;
+		}
+		double min_cost = 0;
+		int sink = sparse_shortest_augmenting_path( row, min_cost);
 
+		if ( sink >= 0) {
+			_row_dual[row] += min_cost;
+			for ( int t = 0; t < _touched_rows.size(); t++) {
+				int i = _touched_rows[t];
+				if ( i != row) {
+					_row_dual[i] += min_cost - _path_cost[ _result[i]];
+				}
+			}
+			for ( int t = 0; t < _touched_cols.size(); t++) {
+				int j = _touched_cols[t];
+				if ( _col_visited[j]) {
+					_col_dual[j] -= min_cost - _path_cost[j];
+				}
+			}
 
+			int j = sink;
+			while ( true) {
+				int i = _parent_row[j];
+				_row_mate[j] = i;
+				swap( _result[i], j);
+				if ( i == row) break;
+			}
+		}
 
+		// clean up after the search;
+		for ( int t = 0; t < _touched_rows.size(); t++) {
+			_row_visited[ _touched_rows[t]] = 0;
+		}
+		for ( int t = 0; t < _touched_cols.size(); t++) {
+			_path_cost[ _touched_cols[t]] = DBL_MAX;
+			_col_visited[ _touched_cols[t]] = 0;
+		}
+		_touched_rows.clear();
+		_touched_cols.clear();
+		if ( sink < 0) {
+			return false;
+		}
+	}
+	return true;
+}
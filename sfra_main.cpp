@@ -1,5 +1,9 @@
 #include <config.h>
 #include "sfra.h"
+#include "vnoc_frames.h"
+#include "sfra_cache.h"
+#include "sfra_batch.h"
+#include "sfra_threads.h"
 #include <stdio.h>
 #include <math.h>
 #include <sys/param.h>
@@ -47,38 +51,29 @@ int main( int argc,char **argv)
 	// create the main object SFRA inside which all AFRA experiments will be run;
 	SFRA sfra;
 	sfra.parse_command_arguments(argc, argv); // gets a "seed" too;
-	sfra.setup_seed(); // setup the seed for C++ RNG;
-	sfra.print_setup_info(); // entertain user;
-
-
-
-	// (A) in 2D and 25D simulation mode, things are simpler; this this 
-	// the way 25D framework was studied for ReConFig'09 paper;
-	if ( sfra.sim_mode() == SIMULATED_ARCH_25D ||
-		 sfra.sim_mode() == SIMULATED_ARCH_2D) {
-
-		// (2)
-		//#########################################
-		//# Try a 'n_fps' number of floorplanings #
-		//#########################################
-
-		// try 'n_fps' number of floorplanings; I should have "best_fps" as a 
-		// sketch array inside SFRA;
-
+	// offline rendering of a frame log only; no floorplanning, no simulation;
+	if ( sfra.replay_file()[0] != '\0') {
+		return ( FRAME_RECORDER::render_frames( sfra.replay_file()) ? 0 : 1);
+	}
+	// a batch of experiments, each with a command line of its own; they
+	// run concurrently, but are reported in order;
+	if ( sfra.batch_file()[0] != '\0') {
+		BATCH batch( &sfra);
+		batch.read( sfra.batch_file(), argv[0]);
+		printf("Batch file %s: %d experiments on %d threads.\n",
+			sfra.batch_file(), batch.experiments_count(),
+			sfra.thread_pool()->threads_count());
+		batch.run();
+	} else {
+		sfra.setup_seed(); // setup the seed for C++ RNG;
+		sfra.print_setup_info(); // entertain user;
+
+
+
+		// (2) search the floorplans, (3) assign routers to the best ones
+		// and simulate them, in the mode asked for;
 		vector <ONE_OF_THE_BEST_FLOOR_PLANS> best_fps;
-		sfra.search_n_fps_floorplans( best_fps);
-
-		// (3)
-		//###########################################################
-		//# Read the list of best FP's, assign routers and simulate #
-		//###########################################################
-
-		// next we simulate using vNOC all floorplans from the bests list;
-		// the result of each simulation is stored inside each fp object
-		// from the list;
-
-		printf("\nThe %d best floorplans will be simulated.\n\n", best_fps.size());
-		sfra.routers_assignment_and_vNOC_simulation( best_fps);
+		sfra.run_experiment( best_fps);
 
 		// (4)
 		//###################
@@ -89,33 +84,17 @@ int main( int argc,char **argv)
 
 		sfra.calculate_final_results_statistics( argc, argv, best_fps);
 	}
-	// (B) in 3D I partition the task graph into 2 using hMetis and 
-	// floorplan the partitions on layers 1 and 3; layer 2 is used
-	// for the homogeneous network;
-	else if ( sfra.sim_mode() == SIMULATED_ARCH_3D) {
-	
-		// (2)
-		// -- create top level application graph
-		// -- partition it into two
-		// -- create sub-floorplans and call floorplanner; do it for n_fps
-		//    and retain n_best;
-		vector <ONE_OF_THE_BEST_FLOOR_PLANS> best_fps1;
-		vector <ONE_OF_THE_BEST_FLOOR_PLANS> best_fps2;
-		//sfra.search_n_fps_floorplans_3D( best_fps1, best_fps2);
-		sfra.search_n_fps_floorplans_3D_version2( best_fps1, best_fps2);
-		
-		// (3) assign routers to the IP/core from both subfloorplans;
-		// simulated using vNOC;
-		printf("\nThe %d best floorplans will be simulated.\n\n", best_fps1.size());
-		sfra.routers_assignment_and_vNOC_simulation_3D( best_fps1, best_fps2);
-		
-		// (4) compute final results statistics and save in output files;
-
-		sfra.calculate_final_results_statistics( argc, argv, best_fps1);
-	}
 
 
 
+	// how much of this run came from the results cache;
+	if ( sfra.results_cache()) {
+		printf("Results cache %s: %ld results taken, %ld stored.\n",
+			sfra.results_cache()->directory(),
+			sfra.results_cache()->hits_count(),
+			sfra.results_cache()->stored_count());
+	}
+
 	// (5) runtime;
 	// cpu time;
 	end_clock = clock();
@@ -0,0 +1,539 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <algorithm>
+#include <functional>
+#include "sfra_partition.h"
+#include "sfra_threads.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// HYPERGRAPH
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void HYPERGRAPH::build_vertex_nets()
+{
+	vertex_start.assign( vertices_count + 1, 0);
+	for ( int k = 0; k < pins.size(); k++) {
+		vertex_start[ pins[k] + 1] ++;
+	}
+	for ( int v = 0; v < vertices_count; v++) {
+		vertex_start[v+1] += vertex_start[v];
+	}
+	vertex_nets.resize( pins.size());
+	vector<int> next( vertex_start.begin(), vertex_start.end() - 1);
+	for ( int e = 0; e < nets_count(); e++) {
+		for ( int k = net_start[e]; k < net_start[e+1]; k++) {
+			vertex_nets[ next[ pins[k]] ++] = e;
+		}
+	}
+}
+
+double HYPERGRAPH::total_weight() const
+{
+	double total = 0.0;
+	for ( int v = 0; v < vertices_count; v++) {
+		total += vertex_weight[v];
+	}
+	return total;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// MULTILEVEL_PARTITIONER
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void MULTILEVEL_PARTITIONER::initialize( int vertices_count, int parts_count)
+{
+	assert( parts_count >= 2);
+	_parts_count = parts_count;
+	_graph = HYPERGRAPH();
+	_graph.vertices_count = vertices_count;
+	_graph.vertex_weight.assign( vertices_count, 1.0);
+	_graph.fixed.assign( vertices_count, -1);
+	_part.assign( vertices_count, -1);
+	_cut = 0.0;
+	_overweight = 0.0;
+}
+
+void MULTILEVEL_PARTITIONER::add_net( int pins_count, const int *pins, double weight)
+{
+	// pins repeated and nets of a single vertex do not matter;
+	vector<int> net( pins, pins + pins_count);
+	sort( net.begin(), net.end());
+	net.erase( unique( net.begin(), net.end()), net.end());
+	if ( net.size() < 2) {
+		return;
+	}
+	_graph.pins.insert( _graph.pins.end(), net.begin(), net.end());
+	_graph.net_start.push_back( _graph.pins.size());
+	_graph.net_weight.push_back( weight);
+}
+
+double MULTILEVEL_PARTITIONER::max_part_weight( const HYPERGRAPH &graph) const
+{
+	return graph.total_weight() * ( 1 + _ubfactor / 50) / _parts_count;
+}
+
+double MULTILEVEL_PARTITIONER::cut_of( const HYPERGRAPH &graph,
+	const vector<int> &part) const
+{
+	double cut = 0.0;
+	vector<char> spanned( _parts_count);
+	for ( int e = 0; e < graph.nets_count(); e++) {
+		fill( spanned.begin(), spanned.end(), 0);
+		int parts = 0;
+		for ( int k = graph.net_start[e]; k < graph.net_start[e+1]; k++) {
+			int p = part[ graph.pins[k]];
+			if ( !spanned[p]) {
+				spanned[p] = 1;
+				parts ++;
+			}
+		}
+		cut += graph.net_weight[e] * ( parts - 1);
+	}
+	return cut;
+}
+
+double MULTILEVEL_PARTITIONER::overweight_of( const HYPERGRAPH &graph,
+	const vector<int> &part) const
+{
+	vector<double> part_weight( _parts_count, 0.0);
+	for ( int v = 0; v < graph.vertices_count; v++) {
+		part_weight[ part[v]] += graph.vertex_weight[v];
+	}
+	double max_weight = max_part_weight( graph);
+	double overweight = 0.0;
+	for ( int p = 0; p < _parts_count; p++) {
+		overweight += max( 0.0, part_weight[p] - max_weight);
+	}
+	return overweight;
+}
+
+bool MULTILEVEL_PARTITIONER::better( const HYPERGRAPH &graph,
+	const vector<int> &part1, const vector<int> &part2) const
+{
+	double overweight1 = overweight_of( graph, part1);
+	double overweight2 = overweight_of( graph, part2);
+	if ( overweight1 != overweight2) {
+		return ( overweight1 < overweight2);
+	}
+	return ( cut_of( graph, part1) < cut_of( graph, part2));
+}
+
+void MULTILEVEL_PARTITIONER::coarsen( const HYPERGRAPH &fine,
+	const vector<int> *part, HYPERGRAPH &coarse, vector<int> &coarse_of,
+	unsigned int &seed) const
+{
+	// (1) visit the vertices in random order; match every one that is
+	// not matched yet with the unmatched vertex with which it shares the
+	// heaviest nets, each net rated by weight / (pins - 1);
+	int n = fine.vertices_count;
+	double max_cluster_weight = fine.total_weight() /
+		( _parts_count * PARTITION_CLUSTERS_PER_PART);
+	vector<int> order( n);
+	for ( int v = 0; v < n; v++) {
+		order[v] = v;
+	}
+	for ( int i = n - 1; i > 0; i--) {
+		swap( order[i], order[ rand_r( &seed) % (i + 1)]);
+	}
+	vector<int> match( n, -1);
+	vector<double> rating( n, 0.0);
+	vector<int> rated;
+	for ( int i = 0; i < n; i++) {
+		int v = order[i];
+		if ( match[v] >= 0) {
+			continue;
+		}
+		for ( int t = fine.vertex_start[v]; t < fine.vertex_start[v+1]; t++) {
+			int e = fine.vertex_nets[t];
+			if ( fine.net_size( e) > PARTITION_LARGE_NET) {
+				continue;
+			}
+			double score = fine.net_weight[e] / ( fine.net_size( e) - 1);
+			for ( int k = fine.net_start[e]; k < fine.net_start[e+1]; k++) {
+				int u = fine.pins[k];
+				if ( u == v || match[u] >= 0 ||
+					( part && (*part)[u] != (*part)[v]) ||
+					( fine.fixed[u] >= 0 && fine.fixed[v] >= 0 && fine.fixed[u] != fine.fixed[v]) ||
+					fine.vertex_weight[u] + fine.vertex_weight[v] > max_cluster_weight) {
+					continue;
+				}
+				if ( rating[u] == 0.0) {
+					rated.push_back( u);
+				}
+				rating[u] += score;
+			}
+		}
+		int best_u = v;
+		for ( int r = 0; r < rated.size(); r++) {
+			int u = rated[r];
+			if ( best_u == v || rating[u] > rating[ best_u]) {
+				best_u = u;
+			}
+		}
+		for ( int r = 0; r < rated.size(); r++) {
+			rating[ rated[r]] = 0.0;
+		}
+		rated.clear();
+		match[v] = best_u;
+		match[ best_u] = v;
+	}
+
+	// (2) clusters, numbered in the order of their first vertex;
+	coarse = HYPERGRAPH();
+	coarse_of.assign( n, -1);
+	for ( int v = 0; v < n; v++) {
+		if ( coarse_of[v] >= 0) {
+			continue;
+		}
+		int c = coarse.vertices_count ++;
+		coarse_of[v] = c;
+		coarse_of[ match[v]] = c;
+		coarse.vertex_weight.push_back( fine.vertex_weight[v]);
+		coarse.fixed.push_back( fine.fixed[v]);
+		if ( match[v] != v) {
+			coarse.vertex_weight[c] += fine.vertex_weight[ match[v]];
+			coarse.fixed[c] = max( coarse.fixed[c], fine.fixed[ match[v]]);
+		}
+	}
+
+	// (3) nets, without the pins that became one, nor single pin nets;
+	vector<int> net;
+	for ( int e = 0; e < fine.nets_count(); e++) {
+		net.clear();
+		for ( int k = fine.net_start[e]; k < fine.net_start[e+1]; k++) {
+			net.push_back( coarse_of[ fine.pins[k]]);
+		}
+		sort( net.begin(), net.end());
+		net.erase( unique( net.begin(), net.end()), net.end());
+		if ( net.size() >= 2) {
+			coarse.pins.insert( coarse.pins.end(), net.begin(), net.end());
+			coarse.net_start.push_back( coarse.pins.size());
+			coarse.net_weight.push_back( fine.net_weight[e]);
+		}
+	}
+	coarse.build_vertex_nets();
+}
+
+void MULTILEVEL_PARTITIONER::initial_partition( const HYPERGRAPH &graph,
+	vector<int> &part, unsigned int &seed) const
+{
+	// the first trial puts every free vertex, heaviest first, into the
+	// lightest part; the others into a random part with room for it; all
+	// are refined and the best one is kept;
+	int n = graph.vertices_count;
+	double max_weight = max_part_weight( graph);
+	vector<int> order( n);
+	for ( int v = 0; v < n; v++) {
+		order[v] = v;
+	}
+	vector<int> trial( n);
+	vector<double> part_weight( _parts_count);
+	vector<int> fitting;
+	for ( int t = 0; t < PARTITION_INITIAL_TRIALS; t++) {
+		if ( t == 0) {
+			stable_sort( order.begin(), order.end(), [&]( int a, int b) {
+				return graph.vertex_weight[a] > graph.vertex_weight[b];
+			});
+		} else {
+			for ( int i = n - 1; i > 0; i--) {
+				swap( order[i], order[ rand_r( &seed) % (i + 1)]);
+			}
+		}
+		fill( part_weight.begin(), part_weight.end(), 0.0);
+		for ( int v = 0; v < n; v++) {
+			trial[v] = graph.fixed[v];
+			if ( trial[v] >= 0) {
+				part_weight[ trial[v]] += graph.vertex_weight[v];
+			}
+		}
+		for ( int i = 0; i < n; i++) {
+			int v = order[i];
+			if ( trial[v] >= 0) {
+				continue;
+			}
+			int lightest = 0;
+			fitting.clear();
+			for ( int p = 0; p < _parts_count; p++) {
+				if ( part_weight[p] < part_weight[ lightest]) {
+					lightest = p;
+				}
+				if ( part_weight[p] + graph.vertex_weight[v] <= max_weight) {
+					fitting.push_back( p);
+				}
+			}
+			int p = lightest;
+			if ( t > 0 && !fitting.empty()) {
+				p = fitting[ rand_r( &seed) % fitting.size()];
+			}
+			trial[v] = p;
+			part_weight[p] += graph.vertex_weight[v];
+		}
+		refine( graph, trial);
+		if ( t == 0 || better( graph, trial, part)) {
+			part = trial;
+		}
+	}
+}
+
+// a move of vertex v to part "to", with its gain when it was computed;
+struct PARTITION_MOVE {
+	double gain;
+	int v;
+	int to;
+	int stamp;
+	bool operator<( const PARTITION_MOVE &m) const {
+		// for the heap: the largest gain first, the lowest vertex among
+		// equal gains;
+		if ( gain != m.gain) {
+			return ( gain < m.gain);
+		}
+		return ( v > m.v);
+	}
+};
+
+void MULTILEVEL_PARTITIONER::refine( const HYPERGRAPH &graph,
+	vector<int> &part) const
+{
+	// k-way FM passes: every pass moves free vertices, the best gain
+	// first, each at most once, also if the cut gets worse; then goes back
+	// to the best partition seen during the pass; a move must not make
+	// its part heavier than the limit, unless it makes the partition less
+	// unbalanced; passes stop when one does not improve;
+	int n = graph.vertices_count;
+	int k = _parts_count;
+	double max_weight = max_part_weight( graph);
+
+	// (1) pins of every net in every part, and weight of every part;
+	vector<int> pins_in( graph.nets_count() * k, 0);
+	vector<double> part_weight( k, 0.0);
+	for ( int e = 0; e < graph.nets_count(); e++) {
+		for ( int t = graph.net_start[e]; t < graph.net_start[e+1]; t++) {
+			pins_in[ e * k + part[ graph.pins[t]]] ++;
+		}
+	}
+	for ( int v = 0; v < n; v++) {
+		part_weight[ part[v]] += graph.vertex_weight[v];
+	}
+	double cut = cut_of( graph, part);
+	double overweight = overweight_of( graph, part);
+
+	// best move of v to another part, within the balance; false if none;
+	vector<double> loss( k);
+	auto best_move = [&]( int v, PARTITION_MOVE &move) {
+		int from = part[v];
+		double w = graph.vertex_weight[v];
+		double gain_from = 0.0;
+		fill( loss.begin(), loss.end(), 0.0);
+		for ( int t = graph.vertex_start[v]; t < graph.vertex_start[v+1]; t++) {
+			int e = graph.vertex_nets[t];
+			if ( pins_in[ e * k + from] == 1) {
+				gain_from += graph.net_weight[e];
+			}
+			for ( int p = 0; p < k; p++) {
+				if ( pins_in[ e * k + p] == 0) {
+					loss[p] += graph.net_weight[e];
+				}
+			}
+		}
+		move.to = -1;
+		for ( int p = 0; p < k; p++) {
+			if ( p == from ||
+				( part_weight[p] + w > max_weight && part_weight[p] + w >= part_weight[ from])) {
+				continue;
+			}
+			if ( move.to < 0 || gain_from - loss[p] > move.gain) {
+				move.gain = gain_from - loss[p];
+				move.to = p;
+			}
+		}
+		move.v = v;
+		return ( move.to >= 0);
+	};
+	auto do_move = [&]( int v, int to) {
+		int from = part[v];
+		for ( int t = graph.vertex_start[v]; t < graph.vertex_start[v+1]; t++) {
+			int e = graph.vertex_nets[t];
+			pins_in[ e * k + from] --;
+			pins_in[ e * k + to] ++;
+		}
+		part_weight[ from] -= graph.vertex_weight[v];
+		part_weight[ to] += graph.vertex_weight[v];
+		part[v] = to;
+	};
+	auto overweight_now = [&]() {
+		double total = 0.0;
+		for ( int p = 0; p < k; p++) {
+			total += max( 0.0, part_weight[p] - max_weight);
+		}
+		return total;
+	};
+
+	vector<int> stamp( n, 0);
+	vector<char> locked( n);
+	vector<PARTITION_MOVE> heap;
+	vector< pair<int,int> > moves; // vertex and part it left;
+	for ( int pass = 0; pass < PARTITION_FM_PASSES; pass++) {
+		fill( locked.begin(), locked.end(), 0);
+		heap.clear();
+		moves.clear();
+		PARTITION_MOVE move;
+		for ( int v = 0; v < n; v++) {
+			if ( graph.fixed[v] < 0 && best_move( v, move)) {
+				move.stamp = ++stamp[v];
+				heap.push_back( move);
+			}
+		}
+		make_heap( heap.begin(), heap.end());
+
+		double best_cut = cut;
+		double best_overweight = overweight;
+		int best_moves = 0;
+		while ( !heap.empty()) {
+			pop_heap( heap.begin(), heap.end());
+			PARTITION_MOVE top = heap.back();
+			heap.pop_back();
+			int v = top.v;
+			if ( locked[v] || top.stamp != stamp[v]) {
+				continue;
+			}
+			// gains of pins of large nets are not updated; check it;
+			if ( !best_move( v, move)) {
+				continue;
+			}
+			if ( move.gain != top.gain || move.to != top.to) {
+				move.stamp = ++stamp[v];
+				heap.push_back( move);
+				push_heap( heap.begin(), heap.end());
+				continue;
+			}
+
+			moves.push_back( make_pair( v, part[v]));
+			do_move( v, move.to);
+			locked[v] = 1;
+			cut -= move.gain;
+			overweight = overweight_now();
+			if ( overweight < best_overweight ||
+				( overweight == best_overweight && cut < best_cut)) {
+				best_cut = cut;
+				best_overweight = overweight;
+				best_moves = moves.size();
+			}
+
+			// gains of the other pins of its nets changed;
+			for ( int t = graph.vertex_start[v]; t < graph.vertex_start[v+1]; t++) {
+				int e = graph.vertex_nets[t];
+				if ( graph.net_size( e) > PARTITION_LARGE_NET) {
+					continue;
+				}
+				for ( int p = graph.net_start[e]; p < graph.net_start[e+1]; p++) {
+					int u = graph.pins[p];
+					if ( locked[u] || graph.fixed[u] >= 0) {
+						continue;
+					}
+					stamp[u] ++;
+					if ( best_move( u, move)) {
+						move.stamp = stamp[u];
+						heap.push_back( move);
+						push_heap( heap.begin(), heap.end());
+					}
+				}
+			}
+		}
+
+		// (2) back to the best partition of this pass;
+		for ( int m = moves.size() - 1; m >= best_moves; m--) {
+			do_move( moves[m].first, moves[m].second);
+		}
+		cut = best_cut;
+		overweight = best_overweight;
+		if ( best_moves == 0) {
+			break;
+		}
+	}
+}
+
+void MULTILEVEL_PARTITIONER::multilevel( vector<int> &part, bool vcycle,
+	unsigned int &seed) const
+{
+	// (1) coarsen;
+	vector<HYPERGRAPH> levels( 1, _graph);
+	vector< vector<int> > coarse_of;
+	vector<int> level_part = part;
+	while ( levels.back().vertices_count > PARTITION_COARSEST_PER_PART * _parts_count) {
+		HYPERGRAPH coarse;
+		vector<int> map;
+		coarsen( levels.back(), vcycle ? &level_part : 0, coarse, map, seed);
+		if ( coarse.vertices_count > PARTITION_MIN_REDUCTION * levels.back().vertices_count) {
+			break;
+		}
+		if ( vcycle) {
+			vector<int> coarse_part( coarse.vertices_count);
+			for ( int v = 0; v < map.size(); v++) {
+				coarse_part[ map[v]] = level_part[v];
+			}
+			level_part.swap( coarse_part);
+		}
+		levels.push_back( coarse);
+		coarse_of.push_back( map);
+	}
+
+	// (2) partition the coarsest one;
+	if ( vcycle) {
+		refine( levels.back(), level_part);
+	} else {
+		initial_partition( levels.back(), level_part, seed);
+	}
+
+	// (3) uncoarsen and refine;
+	for ( int l = int(levels.size()) - 2; l >= 0; l--) {
+		vector<int> fine_part( levels[l].vertices_count);
+		for ( int v = 0; v < fine_part.size(); v++) {
+			fine_part[v] = level_part[ coarse_of[l][v]];
+		}
+		level_part.swap( fine_part);
+		refine( levels[l], level_part);
+	}
+	part.swap( level_part);
+}
+
+double MULTILEVEL_PARTITIONER::run( unsigned int seed, THREAD_POOL *pool)
+{
+	_graph.build_vertex_nets();
+	vector< vector<int> > parts( _runs);
+	function<void(int)> task = [&]( int r) {
+		unsigned int run_seed = seed + r;
+		multilevel( parts[r], false, run_seed);
+		for ( int c = 0; c < _vcycles; c++) {
+			vector<int> part = parts[r];
+			multilevel( part, true, run_seed);
+			if ( better( _graph, part, parts[r])) {
+				parts[r].swap( part);
+			}
+		}
+	};
+	if ( pool) {
+		pool->run( _runs, task);
+	} else {
+		for ( int r = 0; r < _runs; r++) {
+			task( r);
+		}
+	}
+	int best_r = 0;
+	for ( int r = 1; r < _runs; r++) {
+		if ( better( _graph, parts[r], parts[ best_r])) {
+			best_r = r;
+		}
+	}
+	_part = parts[ best_r];
+	_cut = cut_of( _graph, _part);
+	_overweight = overweight_of( _graph, _part);
+	return _cut;
+}
@@ -0,0 +1,206 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "sfra_refine.h"
+#include "sfra_threads.h"
+#include <float.h>
+#include <algorithm>
+
+using namespace std;
+
+// smaller changes of cost are taken as no change at all;
+#define REFINE_EPSILON 1e-9
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ROUTERS_REFINEMENT
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void ROUTERS_REFINEMENT::set_flows( const NETLIST *netlist)
+{
+	// every communication is listed with both of its cores, with the
+	// volumes of both directions;
+	int modules_N = netlist->modules_N;
+	double total_volume = 0.0;
+	_talks_start.assign( 1, 0);
+	_talks_to.clear();
+	_volume.clear();
+	for ( int i = 0; i < modules_N; i++) {
+		for ( int j = 0; j < modules_N; j++) {
+			double volume = netlist->_connection[i][j] + netlist->_connection[j][i];
+			if ( i != j && volume > 0) {
+				_talks_to.push_back( j);
+				_volume.push_back( volume);
+				total_volume += volume;
+			}
+		}
+		_talks_start.push_back( _talks_to.size());
+	}
+	if ( !_volume.empty()) {
+		double avg_volume = total_volume / _volume.size();
+		for ( int k = 0; k < _volume.size(); k++) {
+			_volume[k] /= avg_volume;
+		}
+	}
+}
+
+void ROUTERS_REFINEMENT::initialize( int cores_count, int ary)
+{
+	assert( cores_count + 1 == _talks_start.size());
+	assert( cores_count <= ary * ary);
+	_cores_count = cores_count;
+	_ary = ary;
+	_routers_count = ary * ary;
+	_extralinks.assign( long(_cores_count) * _routers_count, 0.0);
+}
+
+double ROUTERS_REFINEMENT::extralinks( const vector<int> &assignment)
+{
+	double total = 0.0;
+	for ( int id = 0; id < _cores_count; id++) {
+		total += extralink( id, assignment[id]);
+	}
+	return total;
+}
+
+double ROUTERS_REFINEMENT::weighted_hops( const vector<int> &assignment)
+{
+	double total = 0.0;
+	for ( int id = 0; id < _cores_count; id++) {
+		for ( int k = _talks_start[id]; k < _talks_start[id+1]; k++) {
+			total += _volume[k] * hops( assignment[id], assignment[ _talks_to[k]]);
+		}
+	}
+	return total / 2; // every communication was counted twice;
+}
+
+double ROUTERS_REFINEMENT::cost( const vector<int> &assignment, double weight)
+{
+	return extralinks( assignment) + weight * weighted_hops( assignment);
+}
+
+double ROUTERS_REFINEMENT::move_delta( const vector<int> &router_of,
+	int id, int from, int to, int skip) const
+{
+	double delta = extralink( id, to) - extralink( id, from);
+	if ( _weight > 0) {
+		for ( int k = _talks_start[id]; k < _talks_start[id+1]; k++) {
+			int other = _talks_to[k];
+			if ( other == skip) {
+				continue; // they swap routers; their hops do not change;
+			}
+			int r = router_of[ other];
+			delta += _weight * _volume[k] * ( hops( to, r) - hops( from, r));
+		}
+	}
+	return delta;
+}
+
+double ROUTERS_REFINEMENT::search( vector<int> &assignment, unsigned int seed) const
+{
+	// every iteration takes a random core and its best move among the
+	// routers up to REFINE_RADIUS away in x and y; improving moves are always done; after as many iterations
+	// as cores without any, the best move is done even if it is worse,
+	// and the cores moved become tabu for a while, to leave that local
+	// minimum; tabu moves are allowed only if they beat the best cost;
+	int n = _cores_count;
+	vector<int> router_of = assignment;
+	vector<int> core_at( _routers_count, -1);
+	for ( int id = 0; id < n; id++) {
+		core_at[ router_of[id]] = id;
+	}
+	vector<int> tabu_until( n, 0);
+	int tenure = 3 * n;
+	double current = 0.0; // relative to the starting assignment;
+	double best = 0.0;
+	int stalled = 0;
+	int iterations = REFINE_ITERATIONS_PER_CORE * n;
+	for ( int it = 0; it < iterations; it++) {
+		int a = rand_r( &seed) % n;
+		int from = router_of[a];
+		int from_x = from % _ary;
+		int from_y = from / _ary;
+		int best_to = -1;
+		double best_delta = DBL_MAX;
+		for ( int y = max( 0, from_y - REFINE_RADIUS); y <= min( _ary - 1, from_y + REFINE_RADIUS); y++) {
+			for ( int x = max( 0, from_x - REFINE_RADIUS); x <= min( _ary - 1, from_x + REFINE_RADIUS); x++) {
+				int to = x + y * _ary;
+				if ( to == from) {
+					continue;
+				}
+				int b = core_at[to];
+				double delta = move_delta( router_of, a, from, to, b);
+				if ( b >= 0) {
+					delta += move_delta( router_of, b, to, from, a);
+				}
+				bool tabu = ( tabu_until[a] > it || ( b >= 0 && tabu_until[b] > it));
+				if ( tabu && current + delta >= best - REFINE_EPSILON) {
+					continue;
+				}
+				if ( delta < best_delta) {
+					best_delta = delta;
+					best_to = to;
+				}
+			}
+		}
+		if ( best_to < 0) {
+			continue;
+		}
+		int b = core_at[ best_to];
+		if ( best_delta < -REFINE_EPSILON) {
+			stalled = 0;
+		} else if ( ++stalled < n) {
+			continue;
+		} else {
+			stalled = 0;
+			tabu_until[a] = it + tenure;
+			if ( b >= 0) {
+				tabu_until[b] = it + tenure;
+			}
+		}
+
+		// do the move;
+		router_of[a] = best_to;
+		core_at[ best_to] = a;
+		core_at[ from] = b;
+		if ( b >= 0) {
+			router_of[b] = from;
+		}
+		current += best_delta;
+		if ( current < best - REFINE_EPSILON) {
+			best = current;
+			assignment = router_of;
+		}
+	}
+	return best;
+}
+
+double ROUTERS_REFINEMENT::refine( vector<int> &assignment, double weight,
+	unsigned int seed, THREAD_POOL *pool)
+{
+	// REFINE_SEARCHES independent searches from the same assignment; the
+	// best one wins, the first one among equals;
+	_weight = weight;
+	vector< vector<int> > results( REFINE_SEARCHES, assignment);
+	vector<double> gains( REFINE_SEARCHES, 0.0);
+	function<void(int)> task = [&]( int k) {
+		gains[k] = search( results[k], seed + k);
+	};
+	if ( pool) {
+		pool->run( REFINE_SEARCHES, task);
+	} else {
+		for ( int k = 0; k < REFINE_SEARCHES; k++) {
+			task( k);
+		}
+	}
+	int best_k = 0;
+	for ( int k = 1; k < REFINE_SEARCHES; k++) {
+		if ( gains[k] < gains[ best_k]) {
+			best_k = k;
+		}
+	}
+	assignment = results[ best_k];
+	return cost( assignment, weight);
+}
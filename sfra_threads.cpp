@@ -0,0 +1,208 @@
+#include "config.h"
+#include "sfra_threads.h"
+#include <algorithm>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// THREAD_POOL
+//
+////////////////////////////////////////////////////////////////////////////////
+
+THREAD_POOL::THREAD_POOL( int threads_count)
+{
+	_stop = false;
+	if ( threads_count <= 0) {
+		threads_count = max( int(thread::hardware_concurrency()), 1);
+	}
+	for ( int i = 1; i < threads_count; i++) {
+		_workers.push_back( thread( &THREAD_POOL::worker, this));
+	}
+}
+
+THREAD_POOL::~THREAD_POOL()
+{
+	{
+		unique_lock<mutex> lock( _mutex);
+		_stop = true;
+	}
+	_job_added.notify_all();
+	for ( int i = 0; i < _workers.size(); i++) {
+		_workers[i].join();
+	}
+}
+
+int THREAD_POOL::take_task( JOB *job)
+{
+	int i = job->next_task++;
+	if ( job->next_task == job->tasks_count) {
+		// all handed out; nobody else should look at it anymore;
+		_jobs.erase( find( _jobs.begin(), _jobs.end(), job));
+	}
+	return i;
+}
+
+void THREAD_POOL::finish_task( JOB *job)
+{
+	unique_lock<mutex> lock( _mutex);
+	job->done_count ++;
+	if ( job->done_count == job->tasks_count) {
+		_task_done.notify_all();
+	}
+}
+
+void THREAD_POOL::worker()
+{
+	while ( true) {
+		JOB *job = 0;
+		int i = 0;
+		{
+			unique_lock<mutex> lock( _mutex);
+			while ( !_stop && _jobs.empty()) {
+				_job_added.wait( lock);
+			}
+			if ( _stop) {
+				return;
+			}
+			job = _jobs.front();
+			i = take_task( job);
+		}
+		(*job->task)( i);
+		finish_task( job);
+	}
+}
+
+void THREAD_POOL::run( int tasks_count, const function<void(int)> &task)
+{
+	if ( tasks_count <= 0) {
+		return;
+	}
+	JOB job;
+	job.task = &task;
+	job.tasks_count = tasks_count;
+	job.next_task = 0;
+	job.done_count = 0;
+	if ( !_workers.empty()) {
+		unique_lock<mutex> lock( _mutex);
+		_jobs.push_back( &job);
+	}
+	_job_added.notify_all();
+
+	// (1) work on own tasks too, until all are handed out;
+	while ( true) {
+		int i = 0;
+		{
+			unique_lock<mutex> lock( _mutex);
+			if ( job.next_task == job.tasks_count) {
+				break;
+			}
+			if ( _workers.empty()) {
+				i = job.next_task++;
+			} else {
+				i = take_task( &job);
+			}
+		}
+		task( i);
+		finish_task( &job);
+	}
+
+	// (2) wait for the tasks that workers are still running;
+	unique_lock<mutex> lock( _mutex);
+	while ( job.done_count < job.tasks_count) {
+		_task_done.wait( lock);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// TASK_GRAPH
+//
+////////////////////////////////////////////////////////////////////////////////
+
+TASK_GRAPH::~TASK_GRAPH()
+{
+	for ( int id = 0; id < _tasks.size(); id++) {
+		delete _tasks[id];
+	}
+}
+
+int TASK_GRAPH::add_task( const function<void()> &work,
+	const vector<int> &dependencies, long priority)
+{
+	unique_lock<mutex> lock( _mutex);
+	TASK *task = new TASK;
+	task->work = work;
+	task->priority = priority;
+	task->waiting_count = 0;
+	task->done = false;
+	task->cancelled = false;
+	int id = _tasks.size();
+	_tasks.push_back( task);
+	_not_done_count ++;
+	for ( int k = 0; k < dependencies.size(); k++) {
+		TASK *dependency = _tasks[ dependencies[k]];
+		if ( !dependency->done) {
+			dependency->dependents.push_back( id);
+			task->waiting_count ++;
+		}
+	}
+	if ( task->waiting_count == 0) {
+		_ready.insert( make_pair( priority, id));
+		_changed.notify_one();
+	}
+	return id;
+}
+
+void TASK_GRAPH::cancel( int id)
+{
+	unique_lock<mutex> lock( _mutex);
+	_tasks[id]->cancelled = true;
+}
+
+void TASK_GRAPH::finish( int id)
+{
+	TASK *task = _tasks[id];
+	task->done = true;
+	_not_done_count --;
+	for ( int k = 0; k < task->dependents.size(); k++) {
+		TASK *dependent = _tasks[ task->dependents[k]];
+		dependent->waiting_count --;
+		if ( dependent->waiting_count == 0) {
+			_ready.insert( make_pair( dependent->priority, task->dependents[k]));
+		}
+	}
+	// tasks may have become ready, or all may be done;
+	_changed.notify_all();
+}
+
+void TASK_GRAPH::work()
+{
+	unique_lock<mutex> lock( _mutex);
+	while ( true) {
+		if ( _ready.empty()) {
+			if ( _not_done_count == 0) {
+				return;
+			}
+			// wait for running tasks to release or add others;
+			_changed.wait( lock);
+			continue;
+		}
+		int id = _ready.begin()->second;
+		_ready.erase( _ready.begin());
+		TASK *task = _tasks[id];
+		if ( !task->cancelled) {
+			lock.unlock();
+			task->work();
+			lock.lock();
+		}
+		finish( id);
+	}
+}
+
+void TASK_GRAPH::run( THREAD_POOL *pool)
+{
+	// every thread of the pool takes ready tasks until all are done;
+	function<void(int)> task = [this]( int) { work(); };
+	pool->run( pool->threads_count(), task);
+}
@@ -3,6 +3,7 @@
 #include "sfra.h"
 #include "vnoc.h"
 #include "vnoc_event.h"
+#include "vnoc_frames.h"
 #include <math.h>
 #include <iomanip>
 #include <sstream>
@@ -143,7 +144,8 @@ ROUTER::ROUTER () :
 	_routing_algo( ROUTING_XY), // by default we do XY;
 	_local_injection_time(),
 	_packet_counter(0),
-	_local_injection_file()
+	_local_injection_trace(0),
+	_local_injection_next(0)
 {
 }
 
@@ -164,7 +166,9 @@ ROUTER::ROUTER( long physical_ports_count, long vc_number, long buffer_size,
 	_total_delay(0),
 	_local_injection_time(),
 	_packet_counter(0),
-	_local_injection_file()
+	_local_injection_trace(0),
+	_local_injection_next(0),
+	_port_flits_count(physical_ports_count, 0)
 {
 	_vnoc = owner_vnoc;
 
@@ -178,13 +182,57 @@ ROUTER::ROUTER( long physical_ports_count, long vc_number, long buffer_size,
 	for (long i = 0; i < flit_size; i++) {
 		_init_data[i] = _vnoc->topology()->rng().flat_ull(0, ULLONG_MAX);
 	}
-	// get and open the trace file name for this router;
+	// get the trace file of this router and its first packet;
 	init_local_injection_file();
-	local_injection_file() >> _local_injection_time;
+	if ( !_local_injection_trace->empty()) {
+		_local_injection_time = (*_local_injection_trace)[0].time;
+	}
 
 	// set the routing algo for this router as required thru the
 	// topology file from user;
 	_routing_algo = _vnoc->topology()->routing_algo();
+
+	init_activity_counters();
+}
+
+long ROUTER::buffers_occupancy() const
+{
+	long occupancy = 0;
+	for ( long i = 0; i < _physical_ports_count; i++) {
+		for ( long j = 0; j < _vc_number; j++) {
+			occupancy += _input.input_buff(i,j).size();
+		}
+		occupancy += _output.out_buffer(i).size();
+	}
+	return occupancy;
+}
+
+void ROUTER::init_activity_counters()
+{
+	_buffer_occupancy.resize( _physical_ports_count);
+	_crossbar_traversals.resize( _physical_ports_count);
+	_credit_stalls.resize( _physical_ports_count);
+	for ( long i = 0; i < _physical_ports_count; i++) {
+		_buffer_occupancy[i].assign( _vc_number, 0.0);
+		_crossbar_traversals[i].assign( _vc_number, 0);
+		_credit_stalls[i].assign( _vc_number, 0);
+	}
+	_input_arbitration_requests.assign( _physical_ports_count, 0);
+	_input_arbitration_conflicts.assign( _physical_ports_count, 0);
+	_output_arbitration_requests.assign( _physical_ports_count, 0);
+	_output_arbitration_conflicts.assign( _physical_ports_count, 0);
+	_buffer_writes.assign( _physical_ports_count, 0);
+}
+
+void ROUTER::update_buffer_occupancy()
+{
+	// called once per router cycle; the sum of the buffers sizes over 
+	// time is the occupancy integral (flits x cycles);
+	for ( long i = 0; i < _physical_ports_count; i++) {
+		for ( long j = 0; j < _vc_number; j++) {
+			_buffer_occupancy[i][j] += _input.input_buff(i,j).size() * PIPE_DELAY;
+		}
+	}
 }
 
 void ROUTER::init_local_injection_file()
@@ -199,10 +247,10 @@ void ROUTER::init_local_injection_file()
 	name_t.append(temp_str);
 	name_t.append(".trs");
 
-	_local_injection_file = new ifstream;
-	_local_injection_file->open( name_t.c_str());
-
-	if ( _local_injection_file->fail() ) {
+	// parsed once, then shared by all the routers of all the simulations
+	// injecting the same file;
+	_local_injection_trace = _vnoc->topology()->trace( name_t);
+	if ( _local_injection_trace == 0) {
 		printf("\nError: Cannot open trace file: %s\n", name_t.c_str());
 		exit(1);
 	}
@@ -227,11 +275,13 @@ void ROUTER::receive_packet_from_trace_file()
 
 		// translates a core id to a mesh XY address;
 		// read source;
-		local_injection_file() >> core_id;
-		//assert( !local_injection_file().eof());
-		if ( local_injection_file().eof()) {
+		if ( _local_injection_next >= _local_injection_trace->size()) {
 			return;
 		}
+		const TRACE_PACKET &packet =
+			(*_local_injection_trace)[ _local_injection_next];
+		_local_injection_next ++;
+		core_id = packet.src_id;
 
 		temp_pair = _router_assignment->core_id_to_router_xy(core_id);
 		src_addr.push_back(temp_pair.first);
@@ -239,16 +289,14 @@ void ROUTER::receive_packet_from_trace_file()
 		assert( src_addr[0] < _ary_size && src_addr[1] < _ary_size);
 	
 		// read destination;
-		local_injection_file() >> core_id;
-		assert( !local_injection_file().eof());
+		core_id = packet.des_id;
 		temp_pair = _router_assignment->core_id_to_router_xy(core_id);
 		des_addr.push_back(temp_pair.first);
 		des_addr.push_back(temp_pair.second);
 		assert( (des_addr[0] < _ary_size) && (des_addr[1] < _ary_size));
 
 		// read packet size;
-		local_injection_file() >> packet_size;
-		assert( !local_injection_file().eof());
+		packet_size = packet.packet_size;
 
 		// LANDMARK HERE 2
 
@@ -256,8 +304,7 @@ void ROUTER::receive_packet_from_trace_file()
 		// injection load control; in 10 by 10 cycles some packets are NOT
 		// going to be injected, but the events creation and files reading
 		// will be left untouched;
-		_vnoc->sfra()->set_skip_counter( (_vnoc->sfra()->skip_counter() + 1) % 10 );
-		if ( _vnoc->sfra()->skip_counter() < _vnoc->sfra()->max_skip_counter()) {
+		if ( _vnoc->injection_allowed()) {
 			inject_packet( _packet_counter,	src_addr, des_addr,
 				_local_injection_time, packet_size);
 			_packet_counter ++;
@@ -267,11 +314,11 @@ void ROUTER::receive_packet_from_trace_file()
 		}
 
 		// second, create next EVG_ event
-		if ( !local_injection_file().eof()) {
-			local_injection_file() >> _local_injection_time;
-
-			if ( local_injection_file().eof()) { return; }
+		if ( _local_injection_next >= _local_injection_trace->size()) {
+			return;
 		}
+		_local_injection_time =
+			(*_local_injection_trace)[ _local_injection_next].time;
 	}
 }
 
@@ -338,6 +385,7 @@ void ROUTER::inject_packet( long flit_id, ADDRESS &sor_addr, ADDRESS &des_addr,
 				FLIT(flit_id, FLIT::TAIL, sor_addr, des_addr, time, flit_data));
 		}
 		// power module writing here;
+		_buffer_writes[0] ++;
 	}
 }
 
@@ -347,6 +395,7 @@ void ROUTER::receive_flit_from_upstream(long port_id, long vc_id, FLIT &flit)
 	_input.add_flit( port_id, vc_id, flit);
 
 	// power module writing here;
+	_buffer_writes[port_id] ++;
 	if ( flit.type() == FLIT::HEADER) {
 		if ( _input.input_buff(port_id, vc_id).size() == 1) {
 			_input.vc_state_update( port_id, vc_id, ROUTING);
@@ -361,6 +410,7 @@ void ROUTER::receive_flit_from_upstream(long port_id, long vc_id, FLIT &flit)
 void ROUTER::consume_flit(double time, const FLIT &flit)
 {
 	// receive (i.e., consume) one flit at the destination router;
+	_port_flits_count[0] ++;
 	if ( flit.type() == FLIT::TAIL) {
 		_vnoc->event_queue()->inc_finished_count();
 		double delta_t = time - flit.start_time();
@@ -377,6 +427,7 @@ void ROUTER::consume_flit(double time, const FLIT &flit)
 		}
 
 		update_delay( delta_t);
+		_vnoc->record_packet_latency( flit, delta_t);
 	}
 }
 
@@ -424,6 +475,7 @@ void ROUTER::send_flit_to_out_buffer()
 				assert(in_size_t >= 1);
 				FLIT flit_t( _input.get_flit(i,j));
 				_input.remove_flit(i, j);
+				_crossbar_traversals[i][j] ++;
 				// power stuff here;
 				_output.add_flit(out_t.first, flit_t);
 				if ( i == 0) {
@@ -484,6 +536,7 @@ void ROUTER::send_flit_via_physical_link(long i)
 		}
 		FLIT flit_t( _output.get_flit(i));
 		VC_TYPE outadd_t = _output.get_addr(i);
+		_port_flits_count[i] ++;
 		// power stuff here;
 
 		_output.remove_flit(i);
@@ -513,6 +566,7 @@ void ROUTER::simulate_one_router()
 {
 	// LANDMARK HERE 5
 
+	update_buffer_occupancy();
 	// simulate all routing pipeline stages;
 	// stage 5: flit traversal;
 	send_flits_via_physical_link();
@@ -578,11 +632,16 @@ void ROUTER::sw_arbitration_stage()
 				if (( _output.counter_next_r(out_t.first, out_t.second) > 0) &&
 					( _output.local_counter(out_t.first) > 0)) {
 					vc_i_t.push_back(j);
+				} else {
+					_credit_stalls[i][j] ++;
 				}
 			}
 		}
 		long vc_size_t = vc_i_t.size();
+		_input_arbitration_requests[i] += vc_size_t;
 		if ( vc_size_t > 1) {
+			// vc's of the same input port compete for the crossbar input;
+			_input_arbitration_conflicts[i] += vc_size_t - 1;
 			long win_t = _vnoc->topology()->rng().flat_l(0, vc_size_t);
 			VC_TYPE r_t = _input.selected_routing(i, vc_i_t[win_t]);
 			vc_o_map[r_t.first].push_back(VC_TYPE(i, vc_i_t[win_t]));
@@ -598,9 +657,12 @@ void ROUTER::sw_arbitration_stage()
 
 	for ( long i = 0; i < _physical_ports_count; i++) {
 		long vc_size_t = vc_o_map[i].size();
+		_output_arbitration_requests[i] += vc_size_t;
 		if ( vc_size_t > 0) {
 			VC_TYPE vc_win = vc_o_map[i][0];
 			if ( vc_size_t > 1) {
+				// input ports compete for the same crossbar output;
+				_output_arbitration_conflicts[i] += vc_size_t - 1;
 				vc_win = vc_o_map[i][ _vnoc->topology()->rng().flat_l(0, vc_size_t) ];
 			}
 			_input.vc_state_update(vc_win.first, vc_win.second, SW_TR);
@@ -675,9 +737,12 @@ void ROUTER::vc_arbitration_stage()
 		for ( long j = 0; j < _vc_number; j++) {
 			if ( _output.vc_usage(i, j) == ROUTER_OUTPUT::FREE) {
 				long cont_temp = vc_o_i_map[VC_TYPE(i,j)].size();
+				_output_arbitration_requests[i] += cont_temp;
 				if ( cont_temp > 0) {
 					VC_TYPE vc_win = vc_o_i_map[VC_TYPE(i,j)][0];
 					if ( cont_temp > 1) {
+						// input vc's compete for the same output vc;
+						_output_arbitration_conflicts[i] += cont_temp - 1;
 						vc_win = vc_o_i_map[VC_TYPE(i,j)][
 							_vnoc->topology()->rng().flat_l(0, cont_temp)];
 					}
@@ -921,9 +986,16 @@ VNOC::VNOC( TOPOLOGY *topology, EVENT_QUEUE *event_queue,
 	_cube_size(0),
 	_routers_count(0),
 	_packets_count(0),
-	_input_file_st(),
+	_input_trace(0),
+	_input_next(0),
 	_verbose(verbose)
 {
+	_gui = 0;
+	_frame_recorder = 0;
+	_max_skip_counter = 10;
+	_skip_counter = 0;
+	_result = 0;
+	_cancel = 0;
 	_router_assignment = router_assignment;
 	_topology = topology;
 	_event_queue = event_queue;
@@ -973,15 +1045,14 @@ void VNOC::init_input_file()
 	string filename;
 	filename=_topology->trace_file().c_str();
 	filename.append(".trs");
-	_input_file_st.open( filename.c_str());
-	if ( !_input_file_st) {
+	_input_trace = _topology->trace( filename);
+	if ( _input_trace == 0) {
 		printf("\nError: Cannot open source file: %s\n",filename.c_str());
 		exit(1);
 	}
-	double event_time_t;
-	_input_file_st >> event_time_t;
-
-	_event_queue->add_event( EVENT(EVENT::PE, event_time_t));
+	if ( !_input_trace->empty()) {
+		_event_queue->add_event( EVENT(EVENT::PE, (*_input_trace)[0].time));
+	}
 }
 
 ROUTER & VNOC::router( const ADDRESS &a)
@@ -1032,37 +1103,32 @@ bool VNOC::receive_EVENT_PE()
 
 	// translates a core id to a mesh XY address;
 	// read source;
-	_input_file_st >> core_id;
-	assert( !_input_file_st.eof());
+	const TRACE_PACKET &packet = (*_input_trace)[ _input_next];
+	_input_next ++;
+	core_id = packet.src_id;
 	temp_pair = _router_assignment->core_id_to_router_xy(core_id);
 	src_addr_t.push_back(temp_pair.first);
 	src_addr_t.push_back(temp_pair.second);
 	assert( src_addr_t[0] < _ary_size && src_addr_t[1] < _ary_size);
 
 	// read destination;
-	_input_file_st >> core_id;
-	assert( !_input_file_st.eof());
+	core_id = packet.des_id;
 	temp_pair = _router_assignment->core_id_to_router_xy(core_id);
 	des_addr_t.push_back(temp_pair.first);
 	des_addr_t.push_back(temp_pair.second);
 	assert( (des_addr_t[0] < _ary_size) && (des_addr_t[1] < _ary_size));
 
-	_input_file_st >> pack_size_t;
-	assert( !_input_file_st.eof());
+	pack_size_t = packet.packet_size;
 
 	// LANDMARK HERE 1
 
 	router(src_addr_t).receive_packet_from_trace_file();
 
-    if ( !_input_file_st.eof()) {
-        double event_time_t;
-		_input_file_st >> event_time_t;
-		if ( !_input_file_st.eof()) {
-
-			_event_queue->add_event( EVENT(EVENT::PE, event_time_t));
-		}
+	if ( _input_next < _input_trace->size()) {
+		_event_queue->add_event(
+			EVENT(EVENT::PE, (*_input_trace)[ _input_next].time));
 	}
-
+	return true;
 }
 
 bool VNOC::receive_EVENT_ROUTER( EVENT this_event)
@@ -1080,6 +1146,7 @@ bool VNOC::receive_EVENT_ROUTER( EVENT this_event)
 	for ( long i = 0; i < _routers_count; i++) {
 		_routers[i].simulate_one_router(); // including power;
 	}
+	return true;
 }
 
 bool VNOC::receive_EVENT_LINK( EVENT this_event)
@@ -1089,6 +1156,7 @@ bool VNOC::receive_EVENT_LINK( EVENT this_event)
 	long vc_t = this_event.vc();
 	FLIT &flit = this_event.flit();
 	router(des_t).receive_flit_from_upstream(pc_t, vc_t, flit);
+	return true;
 }
 
 bool VNOC::receive_EVENT_CREDIT( EVENT this_event)
@@ -1097,6 +1165,7 @@ bool VNOC::receive_EVENT_CREDIT( EVENT this_event)
 	long pc_t = this_event.pc();
 	long vc_t = this_event.vc();
 	router(des_t).receive_credit(pc_t, vc_t);
+	return true;
 }
 
 void VNOC::check_simulation() 
@@ -1107,13 +1176,210 @@ void VNOC::check_simulation()
 	for (; first != last; first++) {
 		first->sanity_check(); // empty check;
 	}
-	printf("\nSuccess: check for routers cleaness is ok\n");
+	fprintf( log(), "\nSuccess: check for routers cleaness is ok\n");
 }
 
 void VNOC::print_network_routers() 
 {
 }
 
+void VNOC::record_packet_latency( const FLIT &flit, double latency)
+{
+	// called for every consumed tail flit; latency is the same delta_t 
+	// accumulated in the total delay of the destination router;
+	_latency_histogram.record( latency);
+
+	ROUTER &src_router = router( flit.src_addr());
+	ROUTER &des_router = router( flit.des_addr());
+	FLOW_STATISTICS &flow = 
+		_flows_statistics[ src_router.id() * _routers_count + des_router.id()];
+	if ( flow.packets_count == 0) {
+		flow.src_id = src_router._assigned_core;
+		flow.des_id = des_router._assigned_core;
+		for ( long i = 0; i < _cube_size; i++) {
+			flow.hops += abs( src_router.address()[i] - des_router.address()[i]);
+		}
+	}
+	flow.packets_count ++;
+	flow.latency_sum += latency;
+	if ( latency > flow.latency_max) {
+		flow.latency_max = latency;
+	}
+}
+
+void VNOC::sample_activity( double time)
+{
+	// append one sample to the activity time series; it stores, for every
+	// physical port of every router, what happened since the previous
+	// sample; per vc counters are summed over the vc's of the port (they
+	// are still available, cumulative, in the json export);
+	long physical_ports_count = _cube_size * 2 + 1;
+	long vc_number = _topology->virtual_channel_number();
+	long values_count = _routers_count * physical_ports_count * ACTIVITY_FIELDS_COUNT;
+	double last_time = 0.0;
+	if ( _activity_sample_times.size() > 0) {
+		last_time = _activity_sample_times.back();
+	}
+	if ( _activity_last.size() == 0) {
+		_activity_last.resize( values_count, 0.0);
+	}
+	double period = max( time - last_time, 1.0);
+
+	_activity_sample_times.push_back( time);
+	long k = 0;
+	for ( long r = 0; r < _routers_count; r++) {
+		ROUTER &router_t = _routers[r];
+		for ( long i = 0; i < physical_ports_count; i++) {
+			double values[ ACTIVITY_FIELDS_COUNT];
+			values[ ACTIVITY_LINK_FLITS] = router_t.port_flits_count(i);
+			values[ ACTIVITY_CROSSBAR_TRAVERSALS] = 0;
+			values[ ACTIVITY_BUFFER_OCCUPANCY] = 0;
+			values[ ACTIVITY_ARBITRATION_CONFLICTS] = router_t.output_arbitration_conflicts(i);
+			values[ ACTIVITY_CREDIT_STALLS] = 0;
+			for ( long j = 0; j < vc_number; j++) {
+				values[ ACTIVITY_CROSSBAR_TRAVERSALS] += router_t.crossbar_traversals(i,j);
+				values[ ACTIVITY_BUFFER_OCCUPANCY] += router_t.buffer_occupancy(i,j);
+				values[ ACTIVITY_CREDIT_STALLS] += router_t.credit_stalls(i,j);
+			}
+			for ( long f = 0; f < ACTIVITY_FIELDS_COUNT; f++, k++) {
+				double delta = values[f] - _activity_last[k];
+				_activity_last[k] = values[f];
+				if ( f == ACTIVITY_BUFFER_OCCUPANCY) {
+					delta /= period; // average flits in buffers;
+				}
+				_activity_samples.push_back( float(delta));
+			}
+		}
+	}
+}
+
+void VNOC::record_frame( double time)
+{
+	if ( _frame_recorder != 0) {
+		_frame_recorder->record_frame( this, time);
+	}
+}
+
+void VNOC::export_activity( const char *file_prefix)
+{
+	// writes three files:
+	// <file_prefix>.act - the time series in binary: an 8 chars "VNOCACT1"
+	//   tag, 5 ints (routers count, ports per router, fields per port,
+	//   samples count, ary size), a double (REPORT_STATS_PERIOD) and then,
+	//   for every sample, a double (time) and routers x ports x fields floats
+	//   ordered as in ACTIVITY_FIELD;
+	// <file_prefix>-activity.csv - same time series, one row per port;
+	// <file_prefix>-activity.json - per router/port/vc totals over the whole
+	//   simulation, ready to be drawn as heatmaps of the mesh;
+	// in all three, the arbitration conflicts of a port are those of its
+	// output side;
+	long physical_ports_count = _cube_size * 2 + 1;
+	long vc_number = _topology->virtual_channel_number();
+	long values_count = _routers_count * physical_ports_count * ACTIVITY_FIELDS_COUNT;
+	long samples_count = _activity_sample_times.size();
+	double curr_time = max( _event_queue->current_time(), 1.0);
+	char file_name[BUFFER_SIZE];
+	FILE *fp;
+
+	// (1) binary time series;
+	sprintf( file_name, "%s.act", file_prefix);
+	fp = fopen( file_name, "wb");
+	if ( fp == NULL) {
+		printf("Error:	Cannot open activity file: %s\n", file_name);
+		exit(1);
+	}
+	int header[5] = { int(_routers_count), int(physical_ports_count),
+		ACTIVITY_FIELDS_COUNT, int(samples_count), int(_ary_size) };
+	double period = REPORT_STATS_PERIOD;
+	fwrite( "VNOCACT1", 1, 8, fp);
+	fwrite( header, sizeof(int), 5, fp);
+	fwrite( &period, sizeof(double), 1, fp);
+	for ( long s = 0; s < samples_count; s++) {
+		fwrite( &_activity_sample_times[s], sizeof(double), 1, fp);
+		fwrite( &_activity_samples[s * values_count], sizeof(float), values_count, fp);
+	}
+	fclose( fp);
+
+	// (2) csv time series;
+	sprintf( file_name, "%s-activity.csv", file_prefix);
+	fp = fopen( file_name, "w");
+	if ( fp == NULL) {
+		printf("Error:	Cannot open activity file: %s\n", file_name);
+		exit(1);
+	}
+	fprintf( fp, "time,router,x,y,port,link_flits,crossbar_traversals,"
+		"buffer_occupancy,arbitration_conflicts,credit_stalls\n");
+	for ( long s = 0; s < samples_count; s++) {
+		long k = s * values_count;
+		for ( long r = 0; r < _routers_count; r++) {
+			for ( long i = 0; i < physical_ports_count; i++) {
+				fprintf( fp, "%.2f,%ld,%ld,%ld,%ld", _activity_sample_times[s], r,
+					_routers[r].address()[0], _routers[r].address()[1], i);
+				for ( long f = 0; f < ACTIVITY_FIELDS_COUNT; f++, k++) {
+					fprintf( fp, ",%g", _activity_samples[k]);
+				}
+				fprintf( fp, "\n");
+			}
+		}
+	}
+	fclose( fp);
+
+	// (3) json heatmaps; buffer occupancy is averaged over the simulation;
+	sprintf( file_name, "%s-activity.json", file_prefix);
+	fp = fopen( file_name, "w");
+	if ( fp == NULL) {
+		printf("Error:	Cannot open activity file: %s\n", file_name);
+		exit(1);
+	}
+	fprintf( fp, "{\n\"ary\": %ld,\n\"ports\": %ld,\n\"vcs\": %ld,\n"
+		"\"cycles\": %.2f,\n\"routers\": [\n",
+		_ary_size, physical_ports_count, vc_number, curr_time);
+	for ( long r = 0; r < _routers_count; r++) {
+		ROUTER &router_t = _routers[r];
+		fprintf( fp, "{\"id\": %ld, \"x\": %ld, \"y\": %ld, \"core\": %d,\n",
+			r, router_t.address()[0], router_t.address()[1], router_t._assigned_core);
+		fprintf( fp, " \"link_flits\": [");
+		for ( long i = 0; i < physical_ports_count; i++) {
+			fprintf( fp, "%s%ld", (i ? ", " : ""), router_t.port_flits_count(i));
+		}
+		fprintf( fp, "],\n \"arbitration_conflicts\": [");
+		for ( long i = 0; i < physical_ports_count; i++) {
+			fprintf( fp, "%s%ld", (i ? ", " : ""), router_t.output_arbitration_conflicts(i));
+		}
+		fprintf( fp, "],\n \"crossbar_traversals\": [");
+		for ( long i = 0; i < physical_ports_count; i++) {
+			fprintf( fp, "%s[", (i ? ", " : ""));
+			for ( long j = 0; j < vc_number; j++) {
+				fprintf( fp, "%s%ld", (j ? ", " : ""), router_t.crossbar_traversals(i,j));
+			}
+			fprintf( fp, "]");
+		}
+		fprintf( fp, "],\n \"buffer_occupancy\": [");
+		for ( long i = 0; i < physical_ports_count; i++) {
+			fprintf( fp, "%s[", (i ? ", " : ""));
+			for ( long j = 0; j < vc_number; j++) {
+				fprintf( fp, "%s%.4f", (j ? ", " : ""), 
+					router_t.buffer_occupancy(i,j) / curr_time);
+			}
+			fprintf( fp, "]");
+		}
+		fprintf( fp, "],\n \"credit_stalls\": [");
+		for ( long i = 0; i < physical_ports_count; i++) {
+			fprintf( fp, "%s[", (i ? ", " : ""));
+			for ( long j = 0; j < vc_number; j++) {
+				fprintf( fp, "%s%ld", (j ? ", " : ""), router_t.credit_stalls(i,j));
+			}
+			fprintf( fp, "]");
+		}
+		fprintf( fp, "]}%s\n", (r < _routers_count - 1 ? "," : ""));
+	}
+	fprintf( fp, "]\n}\n");
+	fclose( fp);
+
+	fprintf( log(), "Activity exported to %s.act, %s-activity.csv and %s-activity.json\n",
+		file_prefix, file_prefix, file_prefix);
+}
+
 void VNOC::print_simulation_results() 
 {
 	vector<ROUTER>::const_iterator first = _routers.begin();
@@ -1126,11 +1392,6 @@ void VNOC::print_simulation_results()
 	}
 	long tot_f_t = _event_queue->finished_count();
 
-	first = _routers.begin();
-	last = _routers.end();
-	for (; first != last; first++) {
-		// accumulate power stuff here;
-	}
 	double curr_time = _event_queue->current_time();
 	// compute averages here;
 
@@ -1140,17 +1401,75 @@ void VNOC::print_simulation_results()
 	// of the vNOC simulator; 
 	_latency = total_delay / max(tot_f_t, long(1));
 	_latency *= delay_scale_factor;
-	// in fact store it directly in its sketch counterpart of
-	// the sfra host object;
-	_sfra->set_sketch_latency( _latency);
+	// latency, its percentiles, flows and ports throughput go to the
+	// detailed result of this simulation, if any;
+	RESULT result;
+	RESULT &detailed_result = ( _result ? *_result : result);
+	detailed_result.latency = _latency;
 	// record also the avg. number of packets per cycle; used for plots;
-	_sfra->set_sketch_packets_per_cycle( double(_packets_count)/curr_time);
+	detailed_result.packets_per_cycle = double(_packets_count)/curr_time;
+	// the percentiles and the flows latencies are of the same delays as
+	// _latency, and are scaled alike;
+	detailed_result.latency_p50 =
+		_latency_histogram.percentile( 50) * delay_scale_factor;
+	detailed_result.latency_p95 =
+		_latency_histogram.percentile( 95) * delay_scale_factor;
+	detailed_result.latency_p99 =
+		_latency_histogram.percentile( 99) * delay_scale_factor;
+	detailed_result.latency_max =
+		_latency_histogram.max_value() * delay_scale_factor;
+	detailed_result.flows.clear();
+	map<long, FLOW_STATISTICS>::const_iterator flow_it;
+	for ( flow_it = _flows_statistics.begin();
+		  flow_it != _flows_statistics.end(); flow_it++) {
+		detailed_result.flows.push_back( flow_it->second);
+		detailed_result.flows.back().latency_sum *= delay_scale_factor;
+		detailed_result.flows.back().latency_max *= delay_scale_factor;
+	}
+	long physical_ports_count = _cube_size * 2 + 1;
+	detailed_result.ports_count = physical_ports_count;
+	detailed_result.ports_throughput.resize( _routers_count * physical_ports_count);
+	for ( long r = 0; r < _routers_count; r++) {
+		for ( long i = 0; i < physical_ports_count; i++) {
+			detailed_result.ports_throughput[ r * physical_ports_count + i] =
+				double( _routers[r].port_flits_count(i)) / max( curr_time, 1.0);
+		}
+	}
+
+	// energy is computed in one batch from the activity counters;
+	if ( _sfra->energy_model().enabled()) {
+		_sfra->energy_model().compute_energy( this, detailed_result, _verbose);
+	}
 
-	cout.precision(6);
-	cout << "--------------------------------------------------" << endl;
-	cout << "total number of flits delivered:		" << tot_f_t << endl;
-	cout << "average delay per flit:				" << _latency << endl;
-	cout << "--------------------------------------------------" << endl;
+	FILE *fp = log();
+	fprintf( fp, "--------------------------------------------------\n");
+	fprintf( fp, "total number of flits delivered:		%ld\n", tot_f_t);
+	fprintf( fp, "average delay per flit:				%g\n", _latency);
+	fprintf( fp, "delay per flit p50/p95/p99/max:			%.2f / %.2f / %.2f / %.2f\n",
+		detailed_result.latency_p50, detailed_result.latency_p95,
+		detailed_result.latency_p99, detailed_result.latency_max);
+	if ( _sfra->energy_model().enabled()) {
+		fprintf( fp, "energy per flit (pJ):				%.2f\n", detailed_result.energy_per_flit);
+		fprintf( fp, "average power (mW):				%.2f\n", detailed_result.avg_power);
+	}
+	if ( _verbose) {
+		fprintf( fp, "flows (src -> des: hops packets avg_delay max_delay):\n");
+		for ( long k = 0; k < detailed_result.flows.size(); k++) {
+			FLOW_STATISTICS &flow = detailed_result.flows[k];
+			fprintf( fp, "%d -> %d:\t%d\t%ld\t%.2f\t%.2f\n", flow.src_id, flow.des_id,
+				flow.hops, flow.packets_count, flow.avg_latency(), flow.latency_max);
+		}
+		fprintf( fp, "ports throughput (router: flits/cycle of ports 0..%ld):\n",
+			physical_ports_count - 1);
+		for ( long r = 0; r < _routers_count; r++) {
+			fprintf( fp, "%ld:", r);
+			for ( long i = 0; i < physical_ports_count; i++) {
+				fprintf( fp, "\t%.4f", detailed_result.ports_throughput[ r * physical_ports_count + i]);
+			}
+			fprintf( fp, "\n");
+		}
+	}
+	fprintf( fp, "--------------------------------------------------\n");
 }
 
 bool VNOC::run_simulation()
@@ -6,6 +6,7 @@
 #include "vnoc_topology.h"
 #include "vnoc_event.h"
 #include "vnoc.h"
+#include "vnoc_frames.h"
 #include <time.h>
 
 #ifdef BUILD_WITH_GUI
@@ -30,8 +31,9 @@ VNOC_APPLICATION::VNOC_APPLICATION( SFRA *sfra, // its owner;
 									double warmup_cycles, bool use_gui,
 									ROUTERS_DISTRIBUTION *r_distrib_p,
 									int gui_pauses,
-									ONE_OF_THE_BEST_FLOOR_PLANS *best_fp_p1,
-									ONE_OF_THE_BEST_FLOOR_PLANS *best_fp_p2)
+									const vector<ONE_OF_THE_BEST_FLOOR_PLANS *> &best_fps,
+									int load, RESULT &result, FILE *log,
+									const atomic<bool> *cancel)
 {
 	// this wrapper contains here basically what the vnoc code had in its
 	// main function; with additional floorplanning related args;
@@ -49,7 +51,10 @@ VNOC_APPLICATION::VNOC_APPLICATION( SFRA *sfra, // its owner;
 	// read-in the topology file and sanity checks;
 	TOPOLOGY topology( net_size, inp_buf, out_buf, vc_n, flit_size, link_bw,link_l,
 					   pipeline_in_link, trace_file, seed, routing_a, cycles,
-					   warmup_cycles, use_gui);
+					   warmup_cycles, use_gui, log);
+	// trace files are parsed once, for all the simulations of sfra (in a
+	// batch, of all the experiments);
+	topology.set_traces( sfra->traces());
 
 	EVENT_QUEUE event_queue( 0.0, &topology); // start time = 0.0;
 	VNOC vnoc(&topology, &event_queue, router_assignment, sfra->verbose()); // create network;
@@ -58,6 +63,9 @@ VNOC_APPLICATION::VNOC_APPLICATION( SFRA *sfra, // its owner;
 	// the host platform from where we call the vNOC simulator thru its
 	// wrapper;
 	vnoc.set_sfra_host( sfra);
+	vnoc.set_load( load);
+	vnoc.set_result( &result);
+	vnoc.set_cancel( cancel);
 	event_queue.set_vnoc(&vnoc);
 
 	// link_l is now known for this RxR reguar mesh; it will determine
@@ -75,8 +83,7 @@ VNOC_APPLICATION::VNOC_APPLICATION( SFRA *sfra, // its owner;
 	#ifdef BUILD_WITH_GUI
 	GUI_GRAPHICS gui( &topology, &vnoc,
 		_sfra->test_name(), // testcase name, displayed in postscript screenshots;
-		best_fp_p1,
-		best_fp_p2, // used only by 3D;
+		best_fps, // more than one only in 3D;
 		router_assignment, r_distrib_p);
 	vnoc.set_gui(&gui); // initially gui is empty;
 
@@ -92,8 +99,42 @@ VNOC_APPLICATION::VNOC_APPLICATION( SFRA *sfra, // its owner;
 	#endif
 
 
+	// activity files and frame logs are named after the attempt, load and 
+	// buffers size, so that sweeps do not overwrite each other;
+	char file_prefix[BUFFER_SIZE];
+	char frames_file[BUFFER_SIZE + 8];
+	_sfra->simulation_file_prefix( file_prefix, best_fps, load, inp_buf);
+
+	// headless recording of the routers usage; it works also when the
+	// gui is not built or not used;
+	FRAME_RECORDER frame_recorder;
+	if ( _sfra->record_frames()) {
+		sprintf( frames_file, "%s.frames", file_prefix);
+		if ( !frame_recorder.open( frames_file, &vnoc, best_fps,
+			router_assignment, r_distrib_p)) {
+			exit(1);
+		}
+		vnoc.set_frame_recorder( &frame_recorder);
+	}
+
 	vnoc.run_simulation();
+	if ( vnoc.cancelled()) {
+		// nobody wants its results; do not leave a partial frame log;
+		if ( _sfra->record_frames()) {
+			frame_recorder.close();
+			remove( frames_file);
+		}
+		return;
+	}
 	vnoc.print_simulation_results();
+	if ( _sfra->export_activity()) {
+		vnoc.export_activity( file_prefix);
+	}
+	if ( _sfra->record_frames()) {
+		frame_recorder.close();
+		fprintf( log, "Recorded %ld frames in %s.frames\n",
+			frame_recorder.frames_count(), file_prefix);
+	}
 
 	end_time = time(NULL);
 	end_clock = clock();
@@ -101,12 +142,12 @@ VNOC_APPLICATION::VNOC_APPLICATION( SFRA *sfra, // its owner;
 	assert(end_clock != (clock_t)(-1));
 	diff_time = end_time - start_time;
 	diff_clock = end_clock - start_clock;
-	printf("\n");
+	fprintf( log, "\n");
 	// printf ("cputime : start_clock = %lu units, end_clock = %lu units\n", start_clock, end_clock);
-	printf("cputime : processor time used = %.3f sec\n", (double)diff_clock/CLOCKS_PER_SEC);
+	fprintf( log, "cputime : processor time used = %.3f sec\n", (double)diff_clock/CLOCKS_PER_SEC);
 	// printf("walltime : start_time = %lu sec, end_time = %lu sec\n", start_time, end_time);
 	// printf("walltime : elapsed (wall clock) time = %lu sec\n", diff_time);
-	printf("\n");
+	fprintf( log, "\n");
 
 
 	#ifdef BUILD_WITH_GUI
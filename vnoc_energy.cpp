@@ -0,0 +1,139 @@
+#include "config.h"
+#include "sfra.h"
+#include "vnoc.h"
+#include "vnoc_event.h"
+#include "vnoc_energy.h"
+#include "sfra_cache.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ENERGY_MODEL
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool ENERGY_MODEL::read_technology_file( char *file_name)
+{
+	ifstream tech_file( file_name);
+	if ( tech_file.fail()) {
+		printf("\nError: Cannot open technology file: %s\n", file_name);
+		return false;
+	}
+
+	string line;
+	while ( getline( tech_file, line)) {
+		istringstream line_st( line);
+		string name;
+		double value = 0.0;
+		if ( !(line_st >> name) || name[0] == '#') {
+			continue;
+		}
+		if ( !(line_st >> value) || value < 0) {
+			printf("\nError: Wrong value of \"%s\" in technology file: %s\n",
+				name.c_str(), file_name);
+			return false;
+		}
+		if ( name == "buffer_write") _buffer_write = value;
+		else if ( name == "buffer_read") _buffer_read = value;
+		else if ( name == "crossbar") _crossbar = value;
+		else if ( name == "arbiter") _arbiter = value;
+		else if ( name == "link") _link = value;
+		else if ( name == "tsv") _tsv = value;
+		else if ( name == "leakage") _leakage = value;
+		else if ( name == "frequency") _frequency = value;
+		else {
+			printf("\nError: Unknown parameter \"%s\" in technology file: %s\n",
+				name.c_str(), file_name);
+			return false;
+		}
+	}
+	tech_file.close();
+	if ( _frequency <= 0) {
+		printf("\nError: frequency must be positive in technology file: %s\n",
+			file_name);
+		return false;
+	}
+
+	_enabled = true;
+	return true;
+}
+
+void ENERGY_MODEL::add_to_key( CACHE_KEY &key) const
+{
+	key.add_int( _enabled);
+	if ( _enabled) {
+		key.add_double( _buffer_write);
+		key.add_double( _buffer_read);
+		key.add_double( _crossbar);
+		key.add_double( _arbiter);
+		key.add_double( _link);
+		key.add_double( _tsv);
+		key.add_double( _leakage);
+		key.add_double( _frequency);
+	}
+}
+
+void ENERGY_MODEL::compute_energy( VNOC *vnoc, RESULT &result, bool print_it)
+{
+	// every flit ejected at its destination router is read from the input
+	// buffer without crossing the crossbar; injected flits are written into
+	// the buffers of port 0; cores are hooked up to routers through their
+	// extra-links and, in 2.5D and 3D, through one TSV at each end;
+	double buffer_energy = 0.0, crossbar_energy = 0.0, arbiter_energy = 0.0;
+	double link_energy = 0.0, tsv_energy = 0.0;
+	long ejected_flits_count = 0;
+	double extra_links_factor = vnoc->sfra()->extra_links_timing_factor();
+	bool with_tsvs = ( vnoc->sfra()->sim_mode() == SIMULATED_ARCH_25D ||
+		vnoc->sfra()->sim_mode() == SIMULATED_ARCH_3D);
+
+	for ( long r = 0; r < vnoc->routers_count(); r++) {
+		ROUTER &router_t = vnoc->routers()[r];
+		long buffer_reads_count = router_t.port_flits_count(0);
+		long crossbar_traversals_count = 0;
+		for ( long i = 0; i < router_t.physical_ports_count(); i++) {
+			for ( long j = 0; j < router_t.vc_number(); j++) {
+				crossbar_traversals_count += router_t.crossbar_traversals(i,j);
+			}
+			buffer_energy += _buffer_write * router_t.buffer_writes(i);
+			arbiter_energy += _arbiter * ( router_t.input_arbitration_requests(i) +
+				router_t.output_arbitration_requests(i));
+			if ( i > 0) {
+				link_energy += _link * router_t.port_flits_count(i) *
+					router_t.link_length() / BASE_WIRE;
+			}
+		}
+		buffer_reads_count += crossbar_traversals_count;
+		buffer_energy += _buffer_read * buffer_reads_count;
+		crossbar_energy += _crossbar * crossbar_traversals_count;
+
+		// core to router and router to core;
+		long core_flits_count = router_t.buffer_writes(0) + router_t.port_flits_count(0);
+		link_energy += _link * core_flits_count *
+			router_t.extra_length() * extra_links_factor / BASE_WIRE;
+		if ( with_tsvs) {
+			tsv_energy += _tsv * core_flits_count;
+		}
+		ejected_flits_count += router_t.port_flits_count(0);
+	}
+
+	// pJ over ns is mW;
+	double energy = buffer_energy + crossbar_energy + arbiter_energy +
+		link_energy + tsv_energy;
+	double time_ns = max( vnoc->event_queue()->current_time(), 1.0) / _frequency;
+	result.energy = energy;
+	result.energy_per_flit = energy / max( ejected_flits_count, long(1));
+	result.avg_power = energy / time_ns + _leakage * vnoc->routers_count();
+
+	if ( print_it) {
+		fprintf( vnoc->log(), "energy (pJ) buffers: %.1f  crossbar: %.1f  arbiters: %.1f  links: %.1f  tsvs: %.1f\n",
+			buffer_energy, crossbar_energy, arbiter_energy, link_energy, tsv_energy);
+	}
+}
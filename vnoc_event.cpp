@@ -52,7 +52,8 @@ bool EVENT_QUEUE::run_simulation()
 	// pick up events from queue and process as long as it's not empty or
 	// forced to stop;
 	double simulation_cycles_count = _topology->simulation_cycles_count();
-	while ( _events.size() > 0 && _current_time <= simulation_cycles_count) {
+	while ( _events.size() > 0 && _current_time <= simulation_cycles_count &&
+		!_vnoc->cancelled()) {
 
 		EVENT this_event = *get_event();
 		remove_top_event();
@@ -61,13 +62,17 @@ bool EVENT_QUEUE::run_simulation()
 
 		if ( _current_time > report_at_time) {
 			if ( _vnoc->verbose()) {
-				printf("Current time: %.2f  Remaining time %.2f\nInjected packets: %ld  Finished packets count: %ld\n",
+				fprintf( _vnoc->log(), "Current time: %.2f  Remaining time %.2f\nInjected packets: %ld  Finished packets count: %ld\n",
 					_current_time, (_topology->simulation_cycles_count() - _current_time),
 					_events_injected_count, _finished_count);
 		
 				_vnoc->print_simulation_results();
 			}
 
+			// routers activity counters go into the time series;
+			_vnoc->sample_activity( _current_time);
+			// headless recording of what the gui would show;
+			_vnoc->record_frame( _current_time);
 			report_at_time += REPORT_STATS_PERIOD;
 
 			// gui to be or not to be;
@@ -108,6 +113,9 @@ bool EVENT_QUEUE::run_simulation()
 				break;
 		} 
 	}
+	// last, possibly partial, sampling period;
+	_vnoc->sample_activity( _current_time);
+	_vnoc->record_frame( _current_time);
 
 	// gui to be or not to be;
 	#ifdef BUILD_WITH_GUI
@@ -118,4 +126,5 @@ bool EVENT_QUEUE::run_simulation()
 		_vnoc->gui()->update_screen( PRIORITY_MAJOR, msg, ROUTERS);
 	}
 	#endif
+	return true;
 }
@@ -0,0 +1,268 @@
+#include "config.h"
+#include "sfra.h"
+#include "vnoc.h"
+#include "vnoc_frames.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// FRAME_RECORDER
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void corner_of_core( CORNER_NAME corner, Module_Info &module_info,
+	float &x, float &y)
+{
+	// the corner of the core to which its router is hooked up;
+	switch ( corner) {
+	case SW: x = module_info.x; y = module_info.y; break;
+	case SE: x = module_info.rx; y = module_info.y; break;
+	case NW: x = module_info.x; y = module_info.ry; break;
+	case NE: x = module_info.rx; y = module_info.ry; break;
+	}
+}
+
+bool FRAME_RECORDER::open( char *file_name, VNOC *vnoc,
+	const vector<ONE_OF_THE_BEST_FLOOR_PLANS *> &best_fps,
+	ROUTER_ASSIGNMENT *router_assignment,
+	ROUTERS_DISTRIBUTION *router_distribution)
+{
+	_file = fopen( file_name, "wb");
+	if ( _file == NULL) {
+		printf("Error:\tCannot open frame log: %s\n", file_name);
+		return false;
+	}
+	_frames_count = 0;
+
+	// (1) cores and routers, as placed by GUI_GRAPHICS::draw_routers();
+	bool is_3D = ( vnoc->sfra()->sim_mode() == SIMULATED_ARCH_3D);
+	vector<FRAME_CORE> cores;
+	vector<int> module_index; // of each core in its (sub)floorplan;
+	for ( int layer = 0; layer < best_fps.size(); layer++) {
+		ONE_OF_THE_BEST_FLOOR_PLANS *best_fp = best_fps[ layer];
+		for ( int n = 0; n < best_fp->modules_N; n++) {
+			FRAME_CORE core;
+			core.x1 = best_fp->modules_info[n].x;
+			core.y1 = best_fp->modules_info[n].y;
+			core.x2 = best_fp->modules_info[n].rx;
+			core.y2 = best_fp->modules_info[n].ry;
+			core.id = n;
+			if ( is_3D) {
+				core.id = vnoc->sfra()->magic_subid_to_topid( layer, n);
+			}
+			core.layer = layer;
+			cores.push_back( core);
+			module_index.push_back( n);
+		}
+	}
+
+	long nx = router_distribution->nx();
+	long ny = router_distribution->ny();
+	vector<FRAME_ROUTER> routers( vnoc->routers_count());
+	for ( int y = 0; y < ny; y++) {
+		for ( int x = 0; x < nx; x++) {
+			FRAME_ROUTER &router_t = routers[ x * nx + y];
+			router_t.x = x * router_distribution->link_length() + router_distribution->sx();
+			router_t.y = y * router_distribution->link_length() + router_distribution->sy();
+		}
+	}
+	for ( long k = 0; k < cores.size(); k++) {
+		ONE_OF_THE_BEST_FLOOR_PLANS *best_fp = best_fps[ cores[k].layer];
+		pair<int, int> mesh_pos = router_assignment->core_id_to_router_xy( cores[k].id);
+		FRAME_ROUTER &router_t = routers[ mesh_pos.first * nx + mesh_pos.second];
+		router_t.core_id = cores[k].id;
+		router_t.layer = cores[k].layer;
+		corner_of_core( router_assignment->corner_used_by_id( cores[k].id),
+			best_fp->modules_info[ module_index[k]], router_t.link_x, router_t.link_y);
+	}
+
+	// (2) header;
+	float bigger_side = 0;
+	for ( int layer = 0; layer < best_fps.size(); layer++) {
+		bigger_side = max( bigger_side,
+			float( max( best_fps[ layer]->Width, best_fps[ layer]->Height)));
+	}
+	// same empirical scale as in the GUI;
+	float scale = router_distribution->link_length() / 250;
+	int header[3] = { int(cores.size()), int(routers.size()), int(nx) };
+	fwrite( "VNOCFRM1", 1, 8, _file);
+	fwrite( header, sizeof(int), 3, _file);
+	fwrite( &bigger_side, sizeof(float), 1, _file);
+	fwrite( &scale, sizeof(float), 1, _file);
+	for ( long k = 0; k < cores.size(); k++) {
+		fwrite( &cores[k].x1, sizeof(float), 4, _file);
+		fwrite( &cores[k].id, sizeof(int), 2, _file);
+	}
+	for ( long k = 0; k < routers.size(); k++) {
+		fwrite( &routers[k].x, sizeof(float), 2, _file);
+		fwrite( &routers[k].core_id, sizeof(int), 2, _file);
+		fwrite( &routers[k].link_x, sizeof(float), 2, _file);
+	}
+	_occupancy.resize( routers.size());
+	return true;
+}
+
+void FRAME_RECORDER::record_frame( VNOC *vnoc, double time)
+{
+	// one fwrite per frame; the file is buffered by stdio;
+	if ( _file == 0) {
+		return;
+	}
+	for ( long r = 0; r < _occupancy.size(); r++) {
+		_occupancy[r] = (unsigned short) min( vnoc->router( r)->buffers_occupancy(), long(65535));
+	}
+	fwrite( &time, sizeof(double), 1, _file);
+	fwrite( &_occupancy[0], sizeof(unsigned short), _occupancy.size(), _file);
+	_frames_count ++;
+}
+
+void FRAME_RECORDER::close()
+{
+	if ( _file != 0) {
+		fclose( _file);
+		_file = 0;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// FRAME_RECORDER: offline SVG renderer
+//
+////////////////////////////////////////////////////////////////////////////////
+
+bool FRAME_RECORDER::render_frames( char *file_name)
+{
+	FILE *fp = fopen( file_name, "rb");
+	if ( fp == NULL) {
+		printf("Error:\tCannot open frame log: %s\n", file_name);
+		return false;
+	}
+	char tag[8];
+	int header[3];
+	float bigger_side = 0, scale = 1;
+	if ( fread( tag, 1, 8, fp) != 8 || strncmp( tag, "VNOCFRM1", 8) != 0 ||
+		fread( header, sizeof(int), 3, fp) != 3 ||
+		fread( &bigger_side, sizeof(float), 1, fp) != 1 ||
+		fread( &scale, sizeof(float), 1, fp) != 1) {
+		printf("Error:\tNot a frame log: %s\n", file_name);
+		fclose( fp);
+		return false;
+	}
+	vector<FRAME_CORE> cores( header[0]);
+	vector<FRAME_ROUTER> routers( header[1]);
+	bool ok = true;
+	for ( long k = 0; k < cores.size() && ok; k++) {
+		ok = ( fread( &cores[k].x1, sizeof(float), 4, fp) == 4 &&
+			fread( &cores[k].id, sizeof(int), 2, fp) == 2);
+	}
+	for ( long k = 0; k < routers.size() && ok; k++) {
+		ok = ( fread( &routers[k].x, sizeof(float), 2, fp) == 2 &&
+			fread( &routers[k].core_id, sizeof(int), 2, fp) == 2 &&
+			fread( &routers[k].link_x, sizeof(float), 2, fp) == 2);
+	}
+	if ( !ok) {
+		printf("Error:\tTruncated frame log: %s\n", file_name);
+		fclose( fp);
+		return false;
+	}
+
+	// same colors as the GUI: grey nuances from white (empty) to black
+	// (as occupied as the most occupied router of the frame); blue borders
+	// for routers of layer 0, green of layer 1, and so on, and red for
+	// routers without a core;
+	const char *occupancy_colors[FRAME_OCCUPANCY_LEVELS] = { "white", "#bfbfbf",
+		"#8c8c8c", "#595959", "#262626", "black" };
+	const char *layer_colors[FRAME_LAYER_COLORS] = { "blue", "green", "purple", "orange" };
+	const char *core_colors[FRAME_LAYER_COLORS] = { "#bfbfbf", "yellow", "cyan", "pink" };
+	float margin = 60 * scale;
+	float side = bigger_side + 2 * margin;
+
+	double time = 0;
+	vector<unsigned short> occupancy( routers.size());
+	long frame = 0;
+	while ( fread( &time, sizeof(double), 1, fp) == 1 &&
+		fread( &occupancy[0], sizeof(unsigned short), occupancy.size(), fp) ==
+		occupancy.size()) {
+
+		char svg_name[BUFFER_SIZE];
+		sprintf( svg_name, "%s-%ld.svg", file_name, frame);
+		FILE *svg = fopen( svg_name, "w");
+		if ( svg == NULL) {
+			printf("Error:\tCannot open %s\n", svg_name);
+			fclose( fp);
+			return false;
+		}
+		// svg y axis points down; world y axis points up;
+		fprintf( svg, "<svg xmlns=\"http://www.w3.org/2000/svg\" "
+			"viewBox=\"%.1f %.1f %.1f %.1f\" font-family=\"Helvetica\">\n",
+			-margin, -margin, side, side + 30 * scale);
+		fprintf( svg, "<g transform=\"matrix(1 0 0 -1 0 %.1f)\">\n", bigger_side);
+
+		for ( long k = 0; k < cores.size(); k++) {
+			FRAME_CORE &core = cores[k];
+			fprintf( svg, "<rect x=\"%.1f\" y=\"%.1f\" width=\"%.1f\" height=\"%.1f\" "
+				"fill=\"%s\" stroke=\"black\"/>\n", core.x1, core.y1,
+				core.x2 - core.x1, core.y2 - core.y1,
+				core_colors[ core.layer % FRAME_LAYER_COLORS]);
+		}
+		unsigned short max_occupancy = 1;
+		for ( long r = 0; r < routers.size(); r++) {
+			max_occupancy = max( max_occupancy, occupancy[r]);
+		}
+		for ( long r = 0; r < routers.size(); r++) {
+			FRAME_ROUTER &router_t = routers[r];
+			float occupancy_fraction = float( occupancy[r]) / max_occupancy;
+			int level = 0;
+			if ( occupancy_fraction > 0.0) {
+				level = min( int( occupancy_fraction * 5) + 1, FRAME_OCCUPANCY_LEVELS - 1);
+			}
+			if ( router_t.core_id >= 0) {
+				fprintf( svg, "<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" "
+					"stroke=\"%s\"/>\n", router_t.x, router_t.y, router_t.link_x,
+					router_t.link_y, layer_colors[ router_t.layer % FRAME_LAYER_COLORS]);
+			}
+			fprintf( svg, "<rect x=\"%.1f\" y=\"%.1f\" width=\"%.1f\" height=\"%.1f\" "
+				"fill=\"%s\" stroke=\"%s\"/>\n", router_t.x - 20 * scale,
+				router_t.y - 20 * scale, 40 * scale, 40 * scale,
+				occupancy_colors[ level],
+				( router_t.core_id >= 0 ?
+				layer_colors[ router_t.layer % FRAME_LAYER_COLORS] : "red"));
+		}
+		fprintf( svg, "</g>\n");
+
+		// text is drawn outside the flipped group, so it is not mirrored;
+		for ( long k = 0; k < cores.size(); k++) {
+			FRAME_CORE &core = cores[k];
+			fprintf( svg, "<text x=\"%.1f\" y=\"%.1f\" font-size=\"%.1f\" "
+				"text-anchor=\"middle\">ID %d</text>\n", (core.x1 + core.x2) / 2,
+				bigger_side - (core.y1 + core.y2) / 2, 16 * scale, core.id);
+		}
+		for ( long r = 0; r < routers.size(); r++) {
+			FRAME_ROUTER &router_t = routers[r];
+			if ( router_t.core_id >= 0) {
+				fprintf( svg, "<text x=\"%.1f\" y=\"%.1f\" font-size=\"%.1f\" "
+					"text-anchor=\"middle\" fill=\"%s\">%d</text>\n", router_t.x,
+					bigger_side - router_t.y + 5 * scale, 14 * scale,
+					( occupancy[r] * 2 > max_occupancy ? "white" : "black"),
+					router_t.core_id);
+			}
+			fprintf( svg, "<text x=\"%.1f\" y=\"%.1f\" font-size=\"%.1f\" "
+				"fill=\"red\">Occ: %d</text>\n", router_t.x + 20 * scale,
+				bigger_side - router_t.y - 40 * scale, 12 * scale, occupancy[r]);
+		}
+		fprintf( svg, "<text x=\"%.1f\" y=\"%.1f\" font-size=\"%.1f\">Time: %.2f</text>\n",
+			-margin + 5 * scale, bigger_side + margin + 20 * scale, 16 * scale, time);
+		fprintf( svg, "</svg>\n");
+		fclose( svg);
+		frame ++;
+	}
+	fclose( fp);
+
+	printf("Rendered %ld frames of %s into %s-<frame>.svg\n", frame, file_name, file_name);
+	return true;
+}
@@ -18,8 +18,10 @@ TOPOLOGY::TOPOLOGY( long net_size, long inp_buf, long out_buf, long vc_n,
 					long flit_size, long link_bw, double link_l,
 					long pipeline_in_link, string trace_file, long seed,
 					ROUTING_ALGORITHM routing_a, double cycles,
-					double warmup_cycles, bool use_gui) : _rng()
+					double warmup_cycles, bool use_gui, FILE *log) : _rng()
 {
+	_log = log;
+	_traces = &_own_traces;
 	_use_gui = use_gui;
 	// reset NOC topology to defaults;
 	_cube_size = 2;
@@ -92,25 +94,25 @@ bool TOPOLOGY::check_topology()
 
 void TOPOLOGY::print_topology()
 {
-	printf("topology_file:            %s \n", _topology_file.c_str());
-	printf("network_size:             %d \n", _network_size);
-	printf("cube_size:                %d \n", _cube_size);
-	printf("input_buffer_size:        %d \n", _input_buffer_size );
-	printf("output_buffer_size:       %d \n", _output_buffer_size);
-	printf("virtual_channel_number:   %d \n", _vc_number);
-	printf("flit_size:                %d \n", _flit_size);
-	printf("link_bandwidth:           %d \n", _link_bandwidth);
-	printf("link_length [um]:         %e \n", _link_length);
-	printf("pipeline_stages_per_link: %d \n", _pipeline_stages_per_link);
-	printf("\n");
-	printf("trace_file:               %s \n", _trace_file.c_str());
-	printf("seed:                     %ld \n", _rng_seed);
+	fprintf( _log, "topology_file:            %s \n", _topology_file.c_str());
+	fprintf( _log, "network_size:             %d \n", _network_size);
+	fprintf( _log, "cube_size:                %d \n", _cube_size);
+	fprintf( _log, "input_buffer_size:        %d \n", _input_buffer_size );
+	fprintf( _log, "output_buffer_size:       %d \n", _output_buffer_size);
+	fprintf( _log, "virtual_channel_number:   %d \n", _vc_number);
+	fprintf( _log, "flit_size:                %d \n", _flit_size);
+	fprintf( _log, "link_bandwidth:           %d \n", _link_bandwidth);
+	fprintf( _log, "link_length [um]:         %e \n", _link_length);
+	fprintf( _log, "pipeline_stages_per_link: %d \n", _pipeline_stages_per_link);
+	fprintf( _log, "\n");
+	fprintf( _log, "trace_file:               %s \n", _trace_file.c_str());
+	fprintf( _log, "seed:                     %ld \n", _rng_seed);
 	if ( _routing_algo == ROUTING_XY) {
-		printf("routing_algo:             %s \n", "XY");
+		fprintf( _log, "routing_algo:             %s \n", "XY");
 	} else if ( _routing_algo == ROUTING_TXY) {
-		printf("routing_algo:             %s \n", "TXY");
+		fprintf( _log, "routing_algo:             %s \n", "TXY");
 	}
-	printf("simulation_cycles_count:  %.2f \n", _simulation_cycles_count);
-	printf("warmup_cycles_count:      %.2f \n", _warmup_cycles_count);
-	printf("\n");
+	fprintf( _log, "simulation_cycles_count:  %.2f \n", _simulation_cycles_count);
+	fprintf( _log, "warmup_cycles_count:      %.2f \n", _warmup_cycles_count);
+	fprintf( _log, "\n");
 }
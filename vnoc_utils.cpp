@@ -4,10 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-
-// tricks to accomodate compilation on Windowz;
-#define srandom srand
-#define random rand
+#include <fstream>
 
 ////////////////////////////////////////////////////////////////////////////////
 //
@@ -179,18 +176,26 @@ void *my_realloc(void *ptr, size_t size)
 
 RANDOM_NUMBER_GENERATOR::RANDOM_NUMBER_GENERATOR(long seed) :_seed(seed)
 {
-	srandom( _seed);
+	memset( &_random_data, 0, sizeof( _random_data));
+	initstate_r( _seed, _random_state, sizeof( _random_state), &_random_data);
+	_gauss_recalc = true;
+	_gauss_b = 0;
 }
 
 RANDOM_NUMBER_GENERATOR::RANDOM_NUMBER_GENERATOR() : _seed(1)
 {
-	srandom( _seed);
+	memset( &_random_data, 0, sizeof( _random_data));
+	initstate_r( _seed, _random_state, sizeof( _random_state), &_random_data);
+	_gauss_recalc = true;
+	_gauss_b = 0;
 }
 
 double RANDOM_NUMBER_GENERATOR::sflat01()
 {
 	// changed version for Windowz compilation issues;
-	double val = random() * 1.0 / (RAND_MAX + 1.0);
+	int32_t r = 0;
+	random_r( &_random_data, &r);
+	double val = r * 1.0 / (RAND_MAX + 1.0);
 	//double val = random() * 1.0 / RAND_MAX;
 	return val;
 }
@@ -198,7 +203,7 @@ double RANDOM_NUMBER_GENERATOR::sflat01()
 void RANDOM_NUMBER_GENERATOR::set_seed(long seed) 
 {
 	_seed = seed;
-	srandom( seed);
+	srandom_r( seed, &_random_data);
 }
 
 double RANDOM_NUMBER_GENERATOR::flat_d(double low, double high) 
@@ -240,10 +245,8 @@ double RANDOM_NUMBER_GENERATOR::gauss01()
 	double compile_b;
 	double in_a, in_b;
 	double out_a;
-	static double out_b;
-	static int recalc = 1;
 
-	if (recalc) {
+	if (_gauss_recalc) {
 		// Range from (0:1], not [0:1). Had to change this to prevent log(0).
 		in_a = 1.0 - sflat01();
 		in_b = sflat01();
@@ -252,14 +255,14 @@ double RANDOM_NUMBER_GENERATOR::gauss01()
 		compile_b = 2.0 * PI * in_b;
 
 		out_a = modifier * cos(compile_b);
-		out_b = modifier * sin(compile_b);
+		_gauss_b = modifier * sin(compile_b);
 
-		recalc = 0;
-		return out_b;
+		_gauss_recalc = false;
+		return _gauss_b;
 	}
 
-	recalc = 1;
-	return out_b;
+	_gauss_recalc = true;
+	return _gauss_b;
 }
 
 double RANDOM_NUMBER_GENERATOR::gauss_mean_d(double mean, double variance) 
@@ -285,3 +288,151 @@ unsigned long long RANDOM_NUMBER_GENERATOR::gauss_mean_ull(unsigned long long me
 	return ((unsigned long long)(gauss01() * variance + mean));
 }
 
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// LATENCY_HISTOGRAM
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void LATENCY_HISTOGRAM::clear()
+{
+	_buckets.resize( HISTOGRAM_BUCKETS_COUNT);
+	for ( int b = 0; b < HISTOGRAM_BUCKETS_COUNT; b++) {
+		_buckets[b] = 0;
+	}
+	_count = 0;
+	_sum = 0.0;
+	_min_value = 0.0;
+	_max_value = 0.0;
+}
+
+int LATENCY_HISTOGRAM::bucket_of( unsigned long long units) const
+{
+	// linear buckets for small values;
+	const unsigned long long linear_count = 1ULL << HISTOGRAM_SUB_BITS;
+	if ( units < linear_count) {
+		return int(units);
+	}
+	// then, m keeps the SUB_BITS most significant bits of units, and e 
+	// is the number of bits shifted out;
+	int e = 1;
+	while ( (units >> e) >= linear_count) {
+		e ++;
+	}
+	const unsigned long long half_count = linear_count >> 1;
+	unsigned long long m = units >> e;
+	return int( linear_count + (e - 1) * half_count + (m - half_count));
+}
+
+unsigned long long LATENCY_HISTOGRAM::bucket_upper_units( int b) const
+{
+	// largest value (in units) that still falls into bucket b;
+	const unsigned long long linear_count = 1ULL << HISTOGRAM_SUB_BITS;
+	if ( b < linear_count) {
+		return b;
+	}
+	const unsigned long long half_count = linear_count >> 1;
+	int e = int( (b - linear_count) / half_count) + 1;
+	unsigned long long m = (b - linear_count) % half_count + half_count;
+	return ((m + 1) << e) - 1;
+}
+
+void LATENCY_HISTOGRAM::record( double value)
+{
+	if ( value < 0.0) {
+		value = 0.0;
+	}
+	double units = value * HISTOGRAM_UNITS_PER_CYCLE + 0.5;
+	if ( units > 4.0e18) { // way beyond any simulation length;
+		units = 4.0e18;
+	}
+	_buckets[ bucket_of( (unsigned long long)(units))] ++;
+	if ( _count == 0 || value < _min_value) {
+		_min_value = value;
+	}
+	if ( _count == 0 || value > _max_value) {
+		_max_value = value;
+	}
+	_count ++;
+	_sum += value;
+}
+
+void LATENCY_HISTOGRAM::merge( const LATENCY_HISTOGRAM &histogram)
+{
+	if ( histogram._count == 0) {
+		return;
+	}
+	for ( int b = 0; b < HISTOGRAM_BUCKETS_COUNT; b++) {
+		_buckets[b] += histogram._buckets[b];
+	}
+	if ( _count == 0 || histogram._min_value < _min_value) {
+		_min_value = histogram._min_value;
+	}
+	if ( _count == 0 || histogram._max_value > _max_value) {
+		_max_value = histogram._max_value;
+	}
+	_count += histogram._count;
+	_sum += histogram._sum;
+}
+
+double LATENCY_HISTOGRAM::percentile( double p) const
+{
+	// smallest recorded value such that p% of all values are not larger;
+	// what is returned is the upper edge of its bucket, clamped to the
+	// exact min and max that are tracked separately;
+	if ( _count == 0) {
+		return 0.0;
+	}
+	long target = long( ceil( p / 100.0 * _count));
+	if ( target < 1) target = 1;
+	if ( target > _count) target = _count;
+
+	long cumulated = 0;
+	for ( int b = 0; b < HISTOGRAM_BUCKETS_COUNT; b++) {
+		cumulated += _buckets[b];
+		if ( cumulated >= target) {
+			double value = double( bucket_upper_units( b)) / HISTOGRAM_UNITS_PER_CYCLE;
+			if ( value > _max_value) value = _max_value;
+			if ( value < _min_value) value = _min_value;
+			return value;
+		}
+	}
+	return _max_value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// TRACES
+//
+////////////////////////////////////////////////////////////////////////////////
+
+TRACES::~TRACES()
+{
+	map<string, TRACE *>::iterator it;
+	for ( it = _traces.begin(); it != _traces.end(); it++) {
+		delete it->second;
+	}
+}
+
+const TRACE *TRACES::get( const string &file_name)
+{
+	lock_guard<mutex> lock( _mutex);
+	map<string, TRACE *>::iterator it = _traces.find( file_name);
+	if ( it != _traces.end()) {
+		return it->second;
+	}
+	ifstream trace_file( file_name.c_str());
+	if ( trace_file.fail()) {
+		return 0;
+	}
+	// a last line cut short is not a packet;
+	TRACE *trace = new TRACE();
+	TRACE_PACKET packet;
+	while ( trace_file >> packet.time >> packet.src_id >> packet.des_id >>
+		packet.packet_size) {
+		trace->push_back( packet);
+	}
+	_traces[ file_name] = trace;
+	return trace;
+}